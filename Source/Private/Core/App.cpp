@@ -24,6 +24,7 @@ namespace aby {
 
     App::App(const AppInfo& app_info, const WindowInfo& window_info) :
         m_Info(app_info),
+        m_Jobs(create_unique<JobSystem>()),
         m_Window(Window::create(WindowInfo{
             .size = window_info.size,
             .flags = window_info.flags,
@@ -41,13 +42,14 @@ namespace aby {
     }
 
     App::~App() {
+        m_Ctx->loader().sync();
         m_Renderer->destroy();
         m_Ctx->destroy();
     }
 
     void App::run() {
-        m_Ctx->load_thread().sync();
-
+        // Resources keep loading in the background, the renderer substitutes
+        // fallbacks until they are ready.
         auto object_cache = cache() / "Objects";
         for (auto& obj : m_Objects) {
             obj->on_create(this, false);
@@ -122,6 +124,10 @@ namespace aby {
         return *m_Renderer;
     }
 
+    JobSystem& App::jobs() {
+        return *m_Jobs;
+    }
+
     std::span<Ref<Object>> App::objects() {
         return std::span(m_Objects.begin(), m_Objects.size());
     }
@@ -0,0 +1,215 @@
+#include "Core/JobSystem.h"
+#include "Core/Thread.h"
+#include "Core/Log.h"
+
+namespace aby {
+
+    static constexpr u32 NOT_A_WORKER = UINT32_MAX;
+
+    static thread_local const JobSystem* t_Owner  = nullptr;
+    static thread_local u32              t_Worker = NOT_A_WORKER;
+
+}
+
+// WaitGroup
+namespace aby {
+
+    WaitGroup::WaitGroup() :
+        m_Count(0)
+    {
+    }
+
+    void WaitGroup::add(std::size_t count) {
+        m_Count.fetch_add(count, std::memory_order_acq_rel);
+    }
+
+    void WaitGroup::done() {
+        // Decremented under the lock, whoever sees zero through is_done() may destroy the group right after.
+        std::lock_guard lock(m_Mutex);
+        if (m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_CondVar.notify_all();
+        }
+    }
+
+    void WaitGroup::wait() {
+        std::unique_lock lock(m_Mutex);
+        m_CondVar.wait(lock, [this]() { return m_Count.load(std::memory_order_acquire) == 0; });
+    }
+
+    bool WaitGroup::is_done() const {
+        if (m_Count.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+        // The last done() may still hold the mutex, wait for it to let go.
+        std::lock_guard lock(m_Mutex);
+        return true;
+    }
+
+    std::size_t WaitGroup::count() const {
+        return m_Count.load(std::memory_order_acquire);
+    }
+
+}
+
+// JobSystem
+namespace aby {
+
+    JobSystem::JobSystem(u32 workers) :
+        m_Pending(0),
+        m_NextQueue(0),
+        m_Stop(false)
+    {
+        if (workers == 0) {
+            u32 hw  = std::thread::hardware_concurrency();
+            workers = hw > 1 ? hw - 1 : 1;
+        }
+        m_Queues.reserve(workers);
+        for (u32 i = 0; i < workers; i++) {
+            m_Queues.push_back(create_unique<Queue>());
+        }
+        m_Workers.reserve(workers);
+        for (u32 i = 0; i < workers; i++) {
+            m_Workers.push_back(create_unique<Thread>([this, i]() {
+                work(i);
+            }, std::format("Worker Thread {}", i)));
+        }
+        ABY_LOG("JobSystem::JobSystem: {} workers", workers);
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard lock(m_WakeMutex);
+            m_Stop.store(true, std::memory_order_release);
+        }
+        m_Wake.notify_all();
+        m_Workers.clear();
+    }
+
+    void JobSystem::submit(Job&& job, EJobPriority priority, WaitGroup* wg) {
+        ABY_ASSERT(priority < EJobPriority::MAX_ENUM, "Invalid job priority");
+        if (wg) {
+            wg->add();
+        }
+        // Counted before the entry is visible, execute() decrements as soon as it pops one.
+        {
+            std::lock_guard lock(m_WakeMutex);
+            m_Pending.fetch_add(1, std::memory_order_release);
+        }
+        // Workers push onto their own deque so nested work stays hot in cache,
+        // everyone else distributes round robin.
+        u32 index = is_worker() ? t_Worker : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<u32>(m_Queues.size());
+        {
+            auto& queue = *m_Queues[index];
+            std::lock_guard lock(queue.mutex);
+            queue.entries[static_cast<std::size_t>(priority)].push_back(Entry{ std::move(job), wg });
+        }
+        m_Wake.notify_one();
+    }
+
+    void JobSystem::wait(WaitGroup& wg) {
+        u32 index = is_worker() ? t_Worker : NOT_A_WORKER;
+        while (!wg.is_done()) {
+            if (try_run(index)) {
+                continue;
+            }
+            // Nothing to help with, the remaining jobs are running elsewhere.
+            std::unique_lock lock(wg.m_Mutex);
+            wg.m_CondVar.wait_for(lock, std::chrono::microseconds(200), [&wg]() { return wg.m_Count.load(std::memory_order_acquire) == 0; });
+        }
+    }
+
+    bool JobSystem::help() {
+        return try_run(is_worker() ? t_Worker : NOT_A_WORKER);
+    }
+
+    u32 JobSystem::workers() const {
+        return static_cast<u32>(m_Workers.size());
+    }
+
+    std::size_t JobSystem::pending() const {
+        return m_Pending.load(std::memory_order_acquire);
+    }
+
+    bool JobSystem::is_worker() const {
+        return t_Owner == this;
+    }
+
+    void JobSystem::work(u32 index) {
+        t_Owner  = this;
+        t_Worker = index;
+        while (true) {
+            if (try_run(index)) {
+                continue;
+            }
+            std::unique_lock lock(m_WakeMutex);
+            m_Wake.wait(lock, [this]() {
+                return m_Pending.load(std::memory_order_acquire) > 0 || m_Stop.load(std::memory_order_acquire);
+            });
+            if (m_Stop.load(std::memory_order_acquire) && m_Pending.load(std::memory_order_acquire) == 0) {
+                break;
+            }
+        }
+        t_Owner  = nullptr;
+        t_Worker = NOT_A_WORKER;
+    }
+
+    bool JobSystem::try_run(u32 index) {
+        Entry entry;
+        if ((index != NOT_A_WORKER && pop(index, entry)) || steal(index, entry)) {
+            execute(entry);
+            return true;
+        }
+        return false;
+    }
+
+    bool JobSystem::pop(u32 index, Entry& out) {
+        auto& queue = *m_Queues[index];
+        std::lock_guard lock(queue.mutex);
+        for (auto& entries : queue.entries) {
+            if (!entries.empty()) {
+                out = std::move(entries.back());
+                entries.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool JobSystem::steal(u32 thief, Entry& out) {
+        const u32 count = static_cast<u32>(m_Queues.size());
+        const u32 start = thief == NOT_A_WORKER ? 0 : thief + 1;
+        // Higher priorities are drained across every queue before lower ones.
+        for (std::size_t priority = 0; priority < static_cast<std::size_t>(EJobPriority::MAX_ENUM); priority++) {
+            for (u32 i = 0; i < count; i++) {
+                u32 victim = (start + i) % count;
+                if (victim == thief) continue;
+                auto& queue = *m_Queues[victim];
+                std::lock_guard lock(queue.mutex);
+                auto& entries = queue.entries[priority];
+                if (!entries.empty()) {
+                    out = std::move(entries.front());
+                    entries.pop_front();
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void JobSystem::execute(Entry& entry) {
+        m_Pending.fetch_sub(1, std::memory_order_acq_rel);
+        try {
+            entry.job();
+        }
+        catch (const std::exception& e) {
+            ABY_ERR("JobSystem::execute: Uncaught exception: {}", e.what());
+        }
+        catch (...) {
+            ABY_ERR("JobSystem::execute: Uncaught exception of unknown type");
+        }
+        if (entry.wg) {
+            entry.wg->done();
+        }
+    }
+
+}
@@ -0,0 +1,112 @@
+#include "Core/Simd.h"
+#include "Core/Log.h"
+#include <algorithm>
+#include <atomic>
+
+#ifdef ABY_SIMD_X86
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+namespace aby {
+
+#ifdef ABY_SIMD_X86
+    static void cpuid(u32 out[4], u32 leaf, u32 subleaf) {
+    #ifdef _MSC_VER
+        int regs[4];
+        __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; i++) {
+            out[i] = static_cast<u32>(regs[i]);
+        }
+    #else
+        __cpuid_count(leaf, subleaf, out[0], out[1], out[2], out[3]);
+    #endif
+    }
+
+    static u64 xgetbv0() {
+    #ifdef _MSC_VER
+        return _xgetbv(0);
+    #else
+        u32 lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return (static_cast<u64>(hi) << 32) | lo;
+    #endif
+    }
+#endif
+
+    static ESimd detect() {
+#ifdef ABY_SIMD_X86
+        u32 regs[4] = {};
+        cpuid(regs, 0, 0);
+        const u32 max_leaf = regs[0];
+
+        cpuid(regs, 1, 0);
+        const bool sse4_1  = regs[2] & (1u << 19);
+        const bool osxsave = regs[2] & (1u << 27);
+        const bool avx     = regs[2] & (1u << 28);
+        const bool f16c    = regs[2] & (1u << 29);
+        if (!sse4_1) {
+            return ESimd::SCALAR;
+        }
+        // AVX registers are only usable if the OS saves the upper halves (XCR0 bits 1 and 2).
+        // The AVX2 kernels also convert half floats (F16C), every AVX2 CPU has it.
+        if (max_leaf >= 7 && osxsave && avx && f16c && (xgetbv0() & 0x6) == 0x6) {
+            cpuid(regs, 7, 0);
+            if (regs[1] & (1u << 5)) {
+                return ESimd::AVX2;
+            }
+        }
+        return ESimd::SSE4_1;
+#else
+        return ESimd::SCALAR;
+#endif
+    }
+
+    // MAX_ENUM until first use, detection logs and must not run during static initialization.
+    static std::atomic<ESimd> s_Level{ ESimd::MAX_ENUM };
+
+    ESimd simd_support() {
+        static const ESimd support = []() {
+            ESimd simd = detect();
+            ABY_LOG("SIMD: {}", std::to_string(simd));
+            return simd;
+        }();
+        return support;
+    }
+
+    ESimd simd_level() {
+        ESimd level = s_Level.load(std::memory_order_relaxed);
+        if (level == ESimd::MAX_ENUM) {
+            level = simd_support();
+            s_Level.store(level, std::memory_order_relaxed);
+        }
+        return level;
+    }
+
+    void set_simd_level(ESimd level) {
+        ABY_ASSERT(level < ESimd::MAX_ENUM, "Invalid SIMD level");
+        s_Level.store(std::min(level, simd_support()), std::memory_order_relaxed);
+    }
+
+}
+
+namespace std {
+    string to_string(aby::ESimd simd) {
+        switch (simd) {
+            using enum aby::ESimd;
+            case SCALAR:
+                return "Scalar";
+            case SSE4_1:
+                return "SSE4.1";
+            case AVX2:
+                return "AVX2";
+            default:
+                ABY_ASSERT(false, "ESimd out of bounds");
+                break;
+        }
+        return "UNREACHABLE";
+    }
+}
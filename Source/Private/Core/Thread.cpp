@@ -3,10 +3,6 @@
 #include "Core/App.h"
 #include "Platform/Platform.h"
 
-
-//#define ASYNC_RESOURCE_LOADING
-
-
 namespace aby {
 
     Thread::~Thread() {
@@ -31,84 +27,168 @@ namespace aby {
         m_Thread.detach();
     }
 
-    LoadThread::LoadThread(QueryResourceNextHandle query_next_handle) :
-        Thread([this]() { 
-            load();
-        }, "Load Thread"),
-        m_QueryNextHandle(std::move(query_next_handle)),
-        m_FinishState(EFinishState::CONTINUE) 
+    ResourceLoader::ResourceLoader(JobSystem& jobs, ReserveHandle reserve_handle, OnFailed on_failed) :
+        m_Jobs(jobs),
+        m_ReserveHandle(std::move(reserve_handle)),
+        m_OnFailed(std::move(on_failed))
     {
-    #ifndef ASYNC_RESOURCE_LOADING
-        m_FinishState.store(EFinishState::FINISH);
-        m_Thread.join();
-    #endif
     }
 
-    LoadThread::~LoadThread() {
-    #ifdef ASYNC_RESOURCE_LOADING
-        m_FinishState.store(EFinishState::FINISH, std::memory_order_release);
-        m_Thread.detach();
-    #endif
+    ResourceLoader::~ResourceLoader() {
+        sync();
     }
 
-    Resource LoadThread::add_task(EResource type, Task&& task) {
-        Resource::Handle next_handle   = m_QueryNextHandle(type);
-        std::size_t      next_position = m_Tasks.count(type);
-        Resource::Handle handle        = static_cast<Resource::Handle>(next_position + next_handle);
-    #ifdef ASYNC_RESOURCE_LOADING
-        std::lock_guard  lock_guard(m_Mutex);
-        m_Tasks.emplace(type, std::move(task));
-        ABY_DBG("LoadThread::add_task(...) Resource[ type: {}, handle: {} ]", static_cast<int>(type), handle);
-        return Resource{ type, handle };
-    #else     
-        task();
-        return Resource(type, handle);
-    #endif
+    Resource ResourceLoader::reserve(EResource type) {
+        return Resource(type, m_ReserveHandle(type));
     }
 
-    std::size_t LoadThread::tasks() const {
-        return m_Tasks.size();
+    Resource ResourceLoader::add_task(EResource type, Task&& task, const std::vector<Resource>& dependencies) {
+        return add_task(reserve(type), std::move(task), dependencies);
     }
 
-    void LoadThread::sync() {
-    #ifdef ASYNC_RESOURCE_LOADING
-        if (m_Tasks.empty() || m_FinishState.load(std::memory_order_acquire) == EFinishState::FINISH) return; 
-        std::lock_guard lock(m_Mutex);
-        while (!m_Tasks.empty()) {
-            auto it = m_Tasks.begin();
-            Task task = it->second;
-            m_Tasks.erase(it);
-            task();
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    Resource ResourceLoader::add_task(Resource reserved, Task&& task, const std::vector<Resource>& dependencies) {
+        return add_async_task(reserved, [task = std::move(task)](Resource resource, Done done) {
+            task(resource);
+            done(true);
+        }, dependencies);
+    }
+
+    Resource ResourceLoader::add_async_task(EResource type, AsyncTask&& task, const std::vector<Resource>& dependencies) {
+        return add_async_task(reserve(type), std::move(task), dependencies);
+    }
+
+    Resource ResourceLoader::add_async_task(Resource reserved, AsyncTask&& task, const std::vector<Resource>& dependencies) {
+        ABY_DBG("ResourceLoader::add_task(...) Resource[ type: {}, handle: {} ] Dependencies: {}", static_cast<int>(reserved.type()), reserved.handle(), dependencies.size());
+        auto node      = create_ref<Node>();
+        node->resource = reserved;
+        node->task     = std::move(task);
+        node->future   = node->promise.get_future().share();
+        // Counted now rather than when the node is queued, so sync() also covers blocked tasks.
+        m_Tasks.add();
+        {
+            std::lock_guard lock(m_Mutex);
+            // One extra count keeps the node from starting while its dependencies are registered.
+            u32 remaining = 1;
+            for (auto& dependency : dependencies) {
+                auto it = m_Nodes.find(key(dependency));
+                if (it == m_Nodes.end()) {
+                    // Finished already, or not loaded through the loader and nothing to wait for.
+                    auto done = m_Finished.find(key(dependency));
+                    if (done != m_Finished.end() && done->second == EResourceState::FAILED) {
+                        node->dependency_failed.store(true, std::memory_order_relaxed);
+                    }
+                    continue;
+                }
+                it->second->dependents.push_back(node);
+                remaining++;
+            }
+            node->remaining.store(remaining, std::memory_order_release);
+            m_Finished.erase(key(reserved));
+            m_Nodes.insert_or_assign(key(reserved), node);
+        }
+        release(node);
+        return reserved;
+    }
+
+    void ResourceLoader::release(const Ref<Node>& node) {
+        if (node->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_Jobs.submit([this, node]() {
+                run(node);
+            }, EJobPriority::HIGH);
+        }
+    }
+
+    void ResourceLoader::run(const Ref<Node>& node) {
+        const Resource resource = node->resource;
+        if (node->dependency_failed.load(std::memory_order_acquire)) {
+            ABY_ERR("ResourceLoader: Resource[ type: {}, handle: {} ] skipped, a dependency failed to load", static_cast<int>(resource.type()), resource.handle());
+            finish(node, EResourceState::FAILED);
+            return;
+        }
+        try {
+            node->task(resource, [this, node](bool ok) {
+                finish(node, ok ? EResourceState::READY : EResourceState::FAILED);
+            });
+        }
+        catch (const std::exception& e) {
+            ABY_ERR("ResourceLoader: Resource[ type: {}, handle: {} ] failed to load: {}", static_cast<int>(resource.type()), resource.handle(), e.what());
+            finish(node, EResourceState::FAILED);
+        }
+        catch (...) {
+            ABY_ERR("ResourceLoader: Resource[ type: {}, handle: {} ] failed to load: unknown exception", static_cast<int>(resource.type()), resource.handle());
+            finish(node, EResourceState::FAILED);
         }
-        m_FinishState.store(EFinishState::FINISH, std::memory_order_release);
-        m_Tasks.clear();
-    #endif
+        node->task = nullptr; // Release the captures, done may still be pending.
     }
 
-    void LoadThread::load() {
-    #ifdef ASYNC_RESOURCE_LOADING
-        while (m_FinishState.load(std::memory_order_acquire) != EFinishState::FINISH) {
+    void ResourceLoader::finish(const Ref<Node>& node, EResourceState state) {
+        if (node->finished.exchange(true, std::memory_order_acq_rel)) {
+            return; // Already completed, e.g. the task threw after calling done.
+        }
+        const Resource resource = node->resource;
+        if (state == EResourceState::FAILED) {
+            m_OnFailed(resource);
+        }
+
+        std::vector<Ref<Node>> dependents;
+        {
+            // Only the state outlives the load, waiters keep their copy of the future.
             std::lock_guard lock(m_Mutex);
-            if (!m_Tasks.empty()) {
-                auto it = m_Tasks.begin();
-                Task task = std::move(it->second);
-                m_Tasks.erase(it);
-                task();
+            dependents.swap(node->dependents);
+            if (auto it = m_Nodes.find(key(resource)); it != m_Nodes.end() && it->second == node) {
+                m_Nodes.erase(it);
+                m_Finished.insert_or_assign(key(resource), state);
             }
-            switch (m_FinishState.load(std::memory_order_acquire)) {
-                using enum EFinishState;
-                case FINISH: 
-                    return;
-                case CONTINUE:
-                    continue;
-                default:
-                    ABY_WARN("Load Thread was left an invalid state.");
-                    m_FinishState.store(EFinishState::CONTINUE, std::memory_order_release);
-                    break;
+        }
+        node->promise.set_value(state);
+        for (auto& dependent : dependents) {
+            if (state == EResourceState::FAILED) {
+                dependent->dependency_failed.store(true, std::memory_order_release);
             }
+            release(dependent);
         }
-    #endif
+        m_Tasks.done();
+    }
+
+    ResourceLoader::Future ResourceLoader::future(Resource resource) const {
+        std::lock_guard lock(m_Mutex);
+        if (auto it = m_Nodes.find(key(resource)); it != m_Nodes.end()) {
+            return it->second->future;
+        }
+        if (auto it = m_Finished.find(key(resource)); it != m_Finished.end()) {
+            std::promise<EResourceState> promise;
+            promise.set_value(it->second);
+            return promise.get_future().share();
+        }
+        return {};
+    }
+
+    EResourceState ResourceLoader::wait(Resource resource) {
+        Future fut = future(resource);
+        if (!fut.valid()) {
+            return EResourceState::NONE;
+        }
+        while (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (m_Jobs.help()) {
+                continue;
+            }
+            // Nothing to help with, the load runs elsewhere (or waits on the GPU). Sleep until it finishes,
+            // waking now and then in case a job it depends on gets queued.
+            fut.wait_for(std::chrono::microseconds(200));
+        }
+        return fut.get();
+    }
+
+    std::size_t ResourceLoader::tasks() const {
+        return m_Tasks.count();
+    }
+
+    void ResourceLoader::sync() {
+        m_Jobs.wait(m_Tasks);
+    }
+
+    u64 ResourceLoader::key(Resource resource) {
+        return (static_cast<u64>(resource.type()) << 32) | resource.handle();
     }
 
 }
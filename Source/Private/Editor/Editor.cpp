@@ -141,8 +141,8 @@ namespace aby::editor {
 
 
 		ImGui::SameLine();
-		auto plus = m_App->ctx().textures().at(m_Icons.plus);
-		auto minus = m_App->ctx().textures().at(m_Icons.minimize);
+		auto plus = m_App->ctx().textures().at_or_fallback(m_Icons.plus);
+		auto minus = m_App->ctx().textures().at_or_fallback(m_Icons.minimize);
 		if (ImGui::ImageButton("AddTheme", plus->imgui_id(), ImVec2(16, 16))) {
 			auto it = std::filesystem::directory_iterator(theme_dir);
 			std::size_t new_themes = 0;
@@ -382,9 +382,9 @@ namespace aby::editor {
 		auto  button_size = ImVec2(button_dim, button_dim);
 		float right_edge  = ImGui::GetWindowContentRegionMax().x;
 		auto& textures    = m_App->ctx().textures();
-		auto  minimize    = textures.at(m_Icons.minimize);
-		auto  maximize    = textures.at(m_Icons.maximize);
-		auto  exit        = textures.at(m_Icons.exit);
+		auto  minimize    = textures.at_or_fallback(m_Icons.minimize);
+		auto  maximize    = textures.at_or_fallback(m_Icons.maximize);
+		auto  exit        = textures.at_or_fallback(m_Icons.exit);
 
 
 		ImGui::SetCursorPosX(right_edge - bttn_width - padding);
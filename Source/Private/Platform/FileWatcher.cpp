@@ -0,0 +1,83 @@
+#include "Platform/FileWatcher.h"
+#include "Core/Thread.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#ifdef __linux__
+    #include "Platform/posix/FileWatcherPosix.h"
+#endif
+
+namespace aby::sys {
+
+    /**
+    * @brief Compares write times twice a second, for platforms without a native watcher here.
+    */
+    class PollingFileWatcher : public FileWatcher {
+    public:
+        explicit PollingFileWatcher(OnChange on_change) :
+            FileWatcher(std::move(on_change)),
+            m_Stop(false)
+        {
+            m_Thread = create_unique<Thread>([this]() { run(); }, "FileWatcher");
+        }
+
+        ~PollingFileWatcher() final {
+            m_Stop.store(true, std::memory_order_relaxed);
+            m_Thread.reset(); // Joins
+        }
+
+        bool watch(const fs::path& file) override {
+            std::error_code ec;
+            fs::path path = fs::weakly_canonical(file, ec);
+            auto     time = ec ? fs::file_time_type{} : fs::last_write_time(path, ec);
+            if (ec) {
+                return false;
+            }
+            std::lock_guard lock(m_Mutex);
+            m_Files.try_emplace(path, time);
+            return true;
+        }
+    private:
+        void run() {
+            while (!m_Stop.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                std::vector<fs::path> changed;
+                {
+                    std::lock_guard lock(m_Mutex);
+                    for (auto& [path, time] : m_Files) {
+                        std::error_code ec;
+                        auto now = fs::last_write_time(path, ec);
+                        if (!ec && now != time) {
+                            time = now;
+                            changed.push_back(path);
+                        }
+                    }
+                }
+                for (const auto& path : changed) {
+                    m_OnChange(path);
+                }
+            }
+        }
+    private:
+        std::atomic<bool> m_Stop;
+        std::mutex m_Mutex;
+        std::map<fs::path, fs::file_time_type> m_Files;
+        Unique<Thread> m_Thread;
+    };
+
+    Unique<FileWatcher> FileWatcher::create(OnChange on_change) {
+    #ifdef __linux__
+        return create_unique<posix::FileWatcher>(std::move(on_change));
+    #else
+        return create_unique<PollingFileWatcher>(std::move(on_change));
+    #endif
+    }
+
+    FileWatcher::FileWatcher(OnChange on_change) :
+        m_OnChange(std::move(on_change))
+    {
+    }
+
+}
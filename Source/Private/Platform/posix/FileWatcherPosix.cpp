@@ -0,0 +1,96 @@
+#ifdef __linux__
+#include "Platform/posix/FileWatcherPosix.h"
+#include "Core/Log.h"
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace aby::sys::posix {
+
+	FileWatcher::FileWatcher(OnChange on_change) :
+		sys::FileWatcher(std::move(on_change)),
+		m_Inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+		m_Wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+	{
+		if (m_Inotify < 0 || m_Wake < 0) {
+			throw std::runtime_error(std::format("[inotify_init1]: {}", std::strerror(errno)));
+		}
+		m_Thread = create_unique<Thread>([this]() { run(); }, "FileWatcher");
+	}
+
+	FileWatcher::~FileWatcher() {
+		u64 one = 1;
+		[[maybe_unused]] auto written = ::write(m_Wake, &one, sizeof(one));
+		m_Thread.reset(); // Joins
+		::close(m_Inotify);
+		::close(m_Wake);
+	}
+
+	bool FileWatcher::watch(const fs::path& file) {
+		std::error_code ec;
+		fs::path path = fs::weakly_canonical(file, ec);
+		if (ec) {
+			return false;
+		}
+		fs::path dir = path.parent_path();
+
+		std::lock_guard lock(m_Mutex);
+		if (!m_Files.insert(path).second) {
+			return true;
+		}
+		// Adding the same directory again returns its existing descriptor.
+		int wd = inotify_add_watch(m_Inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0) {
+			ABY_WARN("FileWatcher: cannot watch {} ({})", dir, std::strerror(errno));
+			m_Files.erase(path);
+			return false;
+		}
+		m_Dirs.insert_or_assign(wd, dir);
+		return true;
+	}
+
+	void FileWatcher::run() {
+		alignas(inotify_event) std::array<char, 4096> buffer;
+		std::array<pollfd, 2> fds{ pollfd{ m_Inotify, POLLIN, 0 }, pollfd{ m_Wake, POLLIN, 0 } };
+		while (true) {
+			if (poll(fds.data(), fds.size(), -1) < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				ABY_ERR("FileWatcher: poll failed ({})", std::strerror(errno));
+				return;
+			}
+			if (fds[1].revents & POLLIN) {
+				return;
+			}
+
+			std::vector<fs::path> changed;
+			ssize_t bytes = 0;
+			while ((bytes = ::read(m_Inotify, buffer.data(), buffer.size())) > 0) {
+				std::lock_guard lock(m_Mutex);
+				for (ssize_t offset = 0; offset < bytes;) {
+					const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+					offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+					auto dir = m_Dirs.find(event->wd);
+					if (event->len == 0 || dir == m_Dirs.end()) {
+						continue;
+					}
+					fs::path path = dir->second / event->name;
+					if (m_Files.contains(path)) {
+						changed.push_back(std::move(path));
+					}
+				}
+			}
+			// Outside the lock, the callback may watch more files.
+			for (const auto& path : changed) {
+				m_OnChange(path);
+			}
+		}
+	}
+
+}
+#endif
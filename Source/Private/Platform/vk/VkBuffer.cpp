@@ -1,13 +1,17 @@
 #include "Platform/vk/VkBuffer.h"
 #include "Platform/vk/VkAllocator.h"
 #include "Core/Log.h"
+#include <glm/packing.hpp>
+#include <algorithm>
+#include <limits>
 
 namespace aby::vk {
 
     Buffer::Buffer(std::size_t bytes, VkBufferUsageFlags flags, DeviceManager& manager) : 
         m_Logical(manager.logical()),
         m_Buffer(VK_NULL_HANDLE),
-        m_Memory(VK_NULL_HANDLE),
+        m_Memory(&manager.memory()),
+        m_Allocation{},
         m_Flags(flags),
         m_Size(bytes)
     {
@@ -17,7 +21,8 @@ namespace aby::vk {
     Buffer::Buffer(const void* data, std::size_t bytes, VkBufferUsageFlags flags, DeviceManager& manager) :
         m_Logical(manager.logical()),
         m_Buffer(VK_NULL_HANDLE),
-        m_Memory(VK_NULL_HANDLE),
+        m_Memory(&manager.memory()),
+        m_Allocation{},
         m_Flags(flags),
         m_Size(bytes)
     {
@@ -35,26 +40,7 @@ namespace aby::vk {
         bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
         VK_CHECK(vkCreateBuffer(manager.logical(), &bufferCreateInfo, IAllocator::get(), &m_Buffer));
-        VkMemoryRequirements memoryRequirements;
-        vkGetBufferMemoryRequirements(manager.logical(), m_Buffer, &memoryRequirements);
-
-        VkMemoryAllocateInfo allocInfo = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = nullptr,
-            .allocationSize = memoryRequirements.size,
-            .memoryTypeIndex = helper::find_mem_type(
-                memoryRequirements.memoryTypeBits,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                manager.physical()
-            )
-        };
-
-        if (allocInfo.memoryTypeIndex == UINT32_MAX) {
-            throw std::runtime_error("Out of memory!");
-        }
-
-        VK_CHECK(vkAllocateMemory(manager.logical(), &allocInfo, IAllocator::get(), &m_Memory));
-        VK_CHECK(vkBindBufferMemory(manager.logical(), m_Buffer, m_Memory, 0));
+        m_Allocation = m_Memory->bind(m_Buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
     }
 
     void Buffer::clear() {
@@ -64,13 +50,12 @@ namespace aby::vk {
     }
 
     void* Buffer::map(std::size_t size, std::size_t offset) {
-        void* mapped;
-        VK_CHECK(vkMapMemory(m_Logical, m_Memory, offset, size, 0, &mapped));
-        return mapped;
+        // Blocks are mapped once by the MemoryAllocator, several buffers can share a block.
+        ABY_ASSERT(offset + size <= m_Allocation.size, "Buffer::map out of range");
+        return static_cast<std::byte*>(m_Allocation.mapped) + offset;
     }
 
     void Buffer::unmap(void* mapped) {
-        vkUnmapMemory(m_Logical, m_Memory);
     }
 
     void Buffer::set_data(const void* data, std::size_t bytes, DeviceManager& manager) {
@@ -90,15 +75,16 @@ namespace aby::vk {
             vkDestroyBuffer(m_Logical, m_Buffer, IAllocator::get());
             m_Buffer = VK_NULL_HANDLE;
         }
-        if (m_Memory) {
-            vkFreeMemory(m_Logical, m_Memory, IAllocator::get());
-            m_Memory = VK_NULL_HANDLE;
-        }
+        m_Memory->free(m_Allocation);
     }
 
     
     VkDeviceMemory Buffer::memory() {
-        return m_Memory;
+        return m_Allocation.memory;
+    }
+
+    const Allocation& Buffer::allocation() const {
+        return m_Allocation;
     }
 
     std::size_t Buffer::size() const {
@@ -112,6 +98,77 @@ namespace aby::vk {
 
 }
 
+namespace aby::vk {
+
+    StagingBuffer::StagingBuffer(std::size_t bytes, DeviceManager& manager) :
+        Buffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, manager),
+        m_Mapped(nullptr)
+    {
+    }
+
+    std::span<std::byte> StagingBuffer::map() {
+        if (!m_Mapped) {
+            m_Mapped = Buffer::map(m_Size, 0);
+        }
+        return std::span(static_cast<std::byte*>(m_Mapped), m_Size);
+    }
+
+    void StagingBuffer::unmap() {
+        if (m_Mapped) {
+            Buffer::unmap(m_Mapped);
+            m_Mapped = nullptr;
+        }
+    }
+
+}
+
+namespace aby::vk {
+
+    RingBuffer::RingBuffer(std::size_t frame_bytes, u32 frames, VkBufferUsageFlags flags, DeviceManager& manager) :
+        Buffer(frame_bytes * frames, flags, manager),
+        m_FrameSize(frame_bytes),
+        m_Frames(frames),
+        m_Frame(0),
+        m_Head(0)
+    {
+        ABY_ASSERT(frames > 0, "RingBuffer requires at least one frame");
+    }
+
+    void RingBuffer::begin_frame(u32 frame) {
+        ABY_ASSERT(frame < m_Frames, "Frame {} out of range ({})", frame, m_Frames);
+        m_Frame = frame;
+        m_Head  = 0;
+    }
+
+    RingBuffer::Slice RingBuffer::alloc(std::size_t bytes, std::size_t alignment) {
+        std::size_t offset = (m_Head + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes > m_FrameSize) {
+            return {};
+        }
+        m_Head = offset + bytes;
+        VkDeviceSize absolute = static_cast<VkDeviceSize>(m_Frame) * m_FrameSize + offset;
+        auto* mapped = static_cast<std::byte*>(map(bytes, absolute));
+        return Slice{ absolute, std::span<std::byte>(mapped, bytes) };
+    }
+
+    u32 RingBuffer::frame() const {
+        return m_Frame;
+    }
+
+    u32 RingBuffer::frames() const {
+        return m_Frames;
+    }
+
+    std::size_t RingBuffer::frame_size() const {
+        return m_FrameSize;
+    }
+
+    std::size_t RingBuffer::used() const {
+        return m_Head;
+    }
+
+}
+
 namespace aby::vk {
 
     VertexBuffer::VertexBuffer(const void* data, std::size_t bytes, VkDeviceSize vertex_size, DeviceManager& manager) :
@@ -156,8 +213,7 @@ namespace aby::vk {
     }
 
     void VertexBuffer::print(std::ostream& os, const VertexClass& vertex_class, const ShaderDescriptor& descriptor) const {
-        void* mapped_memory;
-        vkMapMemory(m_Logical, m_Memory, 0, m_VertexSize, 0, &mapped_memory);
+        void* mapped_memory = m_Allocation.mapped;
 
         os << "{";
         size_t vertex_offset = 0;  // Tracks the current offset within the vertex buffer.
@@ -257,6 +313,20 @@ namespace aby::vk {
                             vertex_offset += sizeof(uint32_t) * 4;
                             break;
                         }
+                        case VK_FORMAT_R8G8B8A8_UNORM:
+                        {
+                            glm::vec4 data = glm::unpackUnorm4x8(*static_cast<uint32_t*>(current_data));
+                            os << data[0] << ", " << data[1] << ", " << data[2] << ", " << data[3];
+                            vertex_offset += sizeof(uint32_t);
+                            break;
+                        }
+                        case VK_FORMAT_R16G16_SFLOAT:
+                        {
+                            glm::vec2 data = glm::unpackHalf2x16(*static_cast<uint32_t*>(current_data));
+                            os << data[0] << ", " << data[1];
+                            vertex_offset += sizeof(uint32_t);
+                            break;
+                        }
                         default:
                             os << "Unsupported format";
                             break;
@@ -267,7 +337,6 @@ namespace aby::vk {
             os << "}";  // End of vertex
         }
         os << "\n}\n";  // End of all vertices
-        vkUnmapMemory(m_Logical, m_Memory);
     }
 
     void VertexBuffer::clear() {
@@ -285,7 +354,8 @@ namespace aby::vk {
         m_Capacity(0),
         m_VertexSize(0),
         m_Ptr(nullptr),
-        m_Base(nullptr) {
+        m_Base(nullptr),
+        m_Owned(false) {
     }
 
     VertexAccumulator::VertexAccumulator(const VertexClass& vertex_class) :
@@ -293,20 +363,41 @@ namespace aby::vk {
         m_Capacity(vertex_class.max_vertices()),
         m_VertexSize(vertex_class.vertex_size()),
         m_Ptr(new std::byte[m_Capacity * m_VertexSize]),
-        m_Base(m_Ptr) {
+        m_Base(m_Ptr),
+        m_Owned(true) {
     }
 
     VertexAccumulator::~VertexAccumulator() {
-        delete[] m_Base;
+        if (m_Owned) {
+            delete[] m_Base;
+        }
     }
 
     void VertexAccumulator::set_class(const VertexClass& vertex_class) {
         this->reset();
         m_Capacity = vertex_class.max_vertices();
         m_VertexSize = vertex_class.vertex_size();
-        delete[] m_Base;
+        if (m_Owned) {
+            delete[] m_Base;
+        }
         m_Ptr = new std::byte[m_Capacity * m_VertexSize];
         m_Base = m_Ptr;
+        m_Owned = true;
+    }
+
+    void VertexAccumulator::map(std::span<std::byte> memory) {
+        ABY_ASSERT(m_VertexSize > 0, "VertexAccumulator has no vertex class");
+        if (m_Owned) {
+            delete[] m_Base;
+        }
+        m_Base     = memory.data();
+        m_Capacity = memory.size() / m_VertexSize;
+        m_Owned    = false;
+        this->reset();
+    }
+
+    bool VertexAccumulator::is_mapped() const {
+        return !m_Owned && m_Base != nullptr;
     }
 
     void VertexAccumulator::reset() {
@@ -314,6 +405,14 @@ namespace aby::vk {
         m_Ptr = m_Base;
     }
 
+    std::span<std::byte> VertexAccumulator::push(std::size_t count) {
+        count = std::min(count, m_Capacity - m_Count);
+        std::span<std::byte> claimed(m_Base + offset(), count * m_VertexSize);
+        m_Count += count;
+        m_Ptr   += count * m_VertexSize;
+        return claimed;
+    }
+
     std::size_t VertexAccumulator::offset() const {
         return m_VertexSize * m_Count;
     }
@@ -396,6 +495,12 @@ namespace aby::vk {
                 case VK_FORMAT_R32G32B32A32_UINT:
                     os << *reinterpret_cast<const glm::uvec4*>(data.data());
                     break;
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                    os << glm::unpackUnorm4x8(*reinterpret_cast<const uint32_t*>(data.data()));
+                    break;
+                case VK_FORMAT_R16G16_SFLOAT:
+                    os << glm::unpackHalf2x16(*reinterpret_cast<const uint32_t*>(data.data()));
+                    break;
                 default:
                     ABY_ASSERT(false, "Unsupported VkFormat");
                     break;
@@ -412,19 +517,46 @@ namespace aby::vk {
 
 namespace aby::vk {
 
-    IndexBuffer::IndexBuffer(const void* data, size_t bytes, DeviceManager& manager) :
-        Buffer(data, bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, manager)
+    IndexBuffer::IndexBuffer(const void* data, size_t bytes, DeviceManager& manager, VkIndexType type) :
+        Buffer(data, bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, manager),
+        m_Type(type)
     {
 
     }
-    IndexBuffer::IndexBuffer(std::size_t bytes, DeviceManager& manager) :
-        Buffer(bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, manager)
+    IndexBuffer::IndexBuffer(std::size_t count, VkIndexType type, DeviceManager& manager) :
+        Buffer(count * index_size(type), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, manager),
+        m_Type(type)
     {
 
     }
 
+    VkIndexType IndexBuffer::fitting_type(std::size_t max_vertices) {
+        return max_vertices <= std::numeric_limits<u16>::max() + 1ull ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+
+    std::size_t IndexBuffer::index_size(VkIndexType type) {
+        return type == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32);
+    }
+
+    void IndexBuffer::set_indices(std::span<const u32> indices, DeviceManager& manager) {
+        if (m_Type == VK_INDEX_TYPE_UINT32) {
+            set_data(indices.data(), indices.size_bytes(), manager);
+            return;
+        }
+        std::vector<u16> narrowed(indices.size());
+        std::transform(indices.begin(), indices.end(), narrowed.begin(), [](u32 index) {
+            ABY_ASSERT(index <= std::numeric_limits<u16>::max(), "Index {} does not fit a 16 bit index buffer", index);
+            return static_cast<u16>(index);
+        });
+        set_data(narrowed, manager);
+    }
+
     void IndexBuffer::bind(VkCommandBuffer cmd) {
-        vkCmdBindIndexBuffer(cmd, m_Buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindIndexBuffer(cmd, m_Buffer, 0, m_Type);
+    }
+
+    VkIndexType IndexBuffer::type() const {
+        return m_Type;
     }
 
 }
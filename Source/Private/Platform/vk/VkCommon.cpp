@@ -209,9 +209,10 @@ namespace aby::vk::helper {
     void create_img(
         uint32_t width, uint32_t height, 
         VkFormat format, VkImageTiling tiling, 
-        VkImageUsageFlags usage, VkMemoryPropertyFlags properties, 
-        VkImage& image, VkDeviceMemory& imageMemory, 
-        VkDevice device, VkPhysicalDevice physicalDevice)
+        VkImageUsageFlags usage,
+        VkImage& image,
+        VkDevice device,
+        std::span<const u32> queue_families)
     {
         // Step 1: Create the Vulkan Image
         VkImageCreateInfo imageCreateInfo = {};
@@ -226,27 +227,20 @@ namespace aby::vk::helper {
         imageCreateInfo.tiling = tiling;
         imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;  // undefined layout at creation
         imageCreateInfo.usage = usage;  // e.g., transfer destination, sampled
-        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;  // not sharing between queues
+        if (queue_families.size() > 1) {
+            // Written on the transfer queue, sampled on the graphics queue, no ownership transfer needed.
+            imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            imageCreateInfo.queueFamilyIndexCount = static_cast<u32>(queue_families.size());
+            imageCreateInfo.pQueueFamilyIndices = queue_families.data();
+        }
+        else {
+            imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;  // not sharing between queues
+        }
         imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;  // no multisampling
         imageCreateInfo.flags = 0;  // no flags
 
         // Create the image in Vulkan
         VK_CHECK(vkCreateImage(device, &imageCreateInfo, IAllocator::get(), &image));
-
-        // Step 2: Allocate Memory for the Image
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = helper::find_mem_type(memRequirements.memoryTypeBits, properties, physicalDevice);
-
-        // Allocate memory for the image
-        VK_CHECK(vkAllocateMemory(device, &allocInfo, IAllocator::get(), &imageMemory));
-
-        // Step 3: Bind the Image Memory
-        vkBindImageMemory(device, image, imageMemory, 0);
     }
 
     void copy_buffer_to_img(VkCommandBuffer cmd, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
@@ -271,6 +265,28 @@ namespace aby::vk::helper {
         );
     }
 
+    void copy_buffer_to_img(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize buffer_offset, VkImage image, VkOffset2D offset, VkExtent2D extent) {
+        VkBufferImageCopy region{};
+        region.bufferOffset = buffer_offset;
+        region.bufferRowLength = 0; // Tightly packed
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { offset.x, offset.y, 0 };
+        region.imageExtent = { extent.width, extent.height, 1 };
+
+        vkCmdCopyBufferToImage(
+            cmd,
+            buffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &region
+        );
+    }
+
     void create_img_view(VkDevice device, VkImage image, VkFormat format, VkImageView& view) {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
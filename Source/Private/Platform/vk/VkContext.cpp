@@ -59,6 +59,8 @@ namespace aby::vk {
         m_Debugger.create(m_Instance);
         m_Surface.create(m_Instance, window);
         m_Devices.create(m_Instance, m_Surface, device_extensions);
+        m_Devices.pipeline_cache().create(m_Devices.physical(), m_Devices.logical(), app->cache() / "Pipelines.bin");
+        m_Uploader.create(m_Devices);
     }
 
     Ref<Context> Context::create(App* app, Window* window) {
@@ -69,6 +71,7 @@ namespace aby::vk {
         ImGui_ImplVulkan_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
+        m_Uploader.destroy();
         m_Shaders.clear();
         m_Textures.clear();
         m_Devices.destroy();
@@ -101,7 +104,7 @@ namespace aby::vk {
         init_info.QueueFamily        = m_Devices.graphics().FamilyIdx;
         init_info.Queue              = m_Devices.graphics().Queue;
         init_info.DescriptorPool     = static_cast<vk::Renderer&>(m_App->renderer()).rm2d().module()->pool();
-        init_info.PipelineCache      = {};
+        init_info.PipelineCache      = m_Devices.pipeline_cache();
         init_info.RenderPass         = nullptr;
         init_info.Subpass            = 0;
         init_info.MinImageCount      = 2; // ?
@@ -128,6 +131,7 @@ namespace aby::vk {
         ImGui::EndFrame();
         if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
             ImGui::UpdatePlatformWindows();
+            std::lock_guard lock(m_Devices.queue_mutex());
             ImGui::RenderPlatformWindowsDefault();
         }
     }
@@ -202,4 +206,8 @@ namespace aby::vk {
     Surface& Context::surface() {
         return m_Surface;
     }
+
+    Uploader& Context::uploader() {
+        return m_Uploader;
+    }
 }
\ No newline at end of file
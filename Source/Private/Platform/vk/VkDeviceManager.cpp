@@ -1,6 +1,7 @@
 #include "Platform/vk/VkDeviceManager.h"
 #include "Platform/vk/VkAllocator.h"
 #include "Core/Log.h"
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -10,7 +11,9 @@ namespace aby::vk {
         m_Physical(VK_NULL_HANDLE),
         m_Logical(VK_NULL_HANDLE),
         m_Graphics{},
-        m_MaxTextureSlots(0)
+        m_Transfer{},
+        m_MaxTextureSlots(0),
+        m_MinUniformAlignment(1)
     {
 
     }
@@ -19,7 +22,9 @@ namespace aby::vk {
         m_Physical(VK_NULL_HANDLE),
         m_Logical(VK_NULL_HANDLE),
         m_Graphics{},
-        m_MaxTextureSlots(0)
+        m_Transfer{},
+        m_MaxTextureSlots(0),
+        m_MinUniformAlignment(1)
     {
         create(inst, surface, extensions);
     }
@@ -44,6 +49,24 @@ namespace aby::vk {
 
         ABY_ASSERT(m_Graphics.FamilyIdx != UINT32_MAX, "Required queue family not found!");
 
+        // Prefer a transfer only family (DMA engine), then any non graphics family with transfer support.
+        for (uint32_t i = 0; i < queue_families.size(); i++) {
+            auto flags = queue_families[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT)) {
+                m_Transfer.FamilyIdx = i;
+                break;
+            }
+        }
+        if (m_Transfer.FamilyIdx == UINT32_MAX) {
+            for (uint32_t i = 0; i < queue_families.size(); i++) {
+                auto flags = queue_families[i].queueFlags;
+                if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                    m_Transfer.FamilyIdx = i;
+                    break;
+                }
+            }
+        }
+
         // Query required device features
 
         VkPhysicalDeviceFeatures2 query_device_features2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
@@ -100,27 +123,42 @@ namespace aby::vk {
             .features = base_features
         };
 
+        // Optional, lets the memory allocator report the driver's per heap budget.
+        std::vector<const char*> device_extensions = extensions;
+        std::vector<VkExtensionProperties> available_extensions;
+        VK_ENUMERATE(available_extensions, vkEnumerateDeviceExtensionProperties, m_Physical, nullptr);
+        bool memory_budget = std::any_of(available_extensions.begin(), available_extensions.end(), [](const VkExtensionProperties& ext) {
+            return std::strcmp(ext.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+        });
+        if (memory_budget) {
+            device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
         float priority = 1.0f;
-        VkDeviceQueueCreateInfo queue_create_info{
-            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .queueFamilyIndex = m_Graphics.FamilyIdx,
-            .queueCount = 1,
-            .pQueuePriorities = &priority
-        };
+        std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+        for (u32 family : { m_Graphics.FamilyIdx, m_Transfer.FamilyIdx }) {
+            if (family == UINT32_MAX) continue;
+            queue_create_infos.push_back(VkDeviceQueueCreateInfo{
+                .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                .pNext = nullptr,
+                .flags = 0,
+                .queueFamilyIndex = family,
+                .queueCount = 1,
+                .pQueuePriorities = &priority
+            });
+        }
 
 
         VkDeviceCreateInfo dci = {
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
             .pNext = &enable_device_features2,
             .flags = 0,
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &queue_create_info,
+            .queueCreateInfoCount = static_cast<u32>(queue_create_infos.size()),
+            .pQueueCreateInfos = queue_create_infos.data(),
             .enabledLayerCount = 0,
             .ppEnabledLayerNames = nullptr,
-            .enabledExtensionCount = static_cast<u32>(extensions.size()),
-            .ppEnabledExtensionNames = extensions.data(),
+            .enabledExtensionCount = static_cast<u32>(device_extensions.size()),
+            .ppEnabledExtensionNames = device_extensions.data(),
             .pEnabledFeatures = nullptr,
         };
 
@@ -130,15 +168,38 @@ namespace aby::vk {
 
         // Get the graphics and present queue handles
         vkGetDeviceQueue(m_Logical, m_Graphics.FamilyIdx, 0, &m_Graphics.Queue);
+        if (m_Transfer.FamilyIdx != UINT32_MAX) {
+            vkGetDeviceQueue(m_Logical, m_Transfer.FamilyIdx, 0, &m_Transfer.Queue);
+        }
+        else {
+            m_Transfer = m_Graphics;
+        }
 
-        VkPhysicalDeviceProperties props = {};
-        vkGetPhysicalDeviceProperties(m_Physical, &props);
-        m_MaxTextureSlots = props.limits.maxPerStageDescriptorSampledImages;
+        m_Memory.create(m_Physical, m_Logical, memory_budget);
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexing_props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES,
+            .pNext = nullptr,
+        };
+        VkPhysicalDeviceProperties2 props2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &indexing_props,
+        };
+        vkGetPhysicalDeviceProperties2(m_Physical, &props2);
+        const VkPhysicalDeviceProperties& props = props2.properties;
+        // The bindless array lives in an update after bind layout, so only the update after bind limits apply.
+        m_MaxTextureSlots     = std::min({
+            indexing_props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexing_props.maxPerStageDescriptorUpdateAfterBindSamplers,
+            MAX_BINDLESS_RESOURCES
+        });
+        m_MinUniformAlignment = props.limits.minUniformBufferOffsetAlignment;
 
         ABY_DBG("vk::DeviceManager::create");
         ABY_DBG("  Physical Device {}", props.deviceName);
         ABY_DBG("  Type            {}", helper::to_string(props.deviceType));
         ABY_DBG("  Driver Version: {}", props.driverVersion);
+        ABY_DBG("  Transfer Queue: {}", has_dedicated_transfer() ? "Dedicated" : "Graphics");
         ABY_DBG("  Enabled Feature(s) 10");
         ABY_DBG("  ({})   -- ({})", 1, "shaderSampledImageArrayNonUniformIndexing");
         ABY_DBG("  ({})   -- ({})", 2, "descriptorBindingUniformBufferUpdateAfterBind");
@@ -157,6 +218,10 @@ namespace aby::vk {
         return m_MaxTextureSlots;
     }
 
+    VkDeviceSize DeviceManager::min_uniform_alignment() const {
+        return m_MinUniformAlignment;
+    }
+
 
     Ref<CmdPool> DeviceManager::create_cmd_pool() {
         return create_ref<CmdPool>(m_Logical, m_Graphics.FamilyIdx);
@@ -168,6 +233,8 @@ namespace aby::vk {
 
 
     void DeviceManager::destroy() {
+        m_PipelineCache.destroy();
+        m_Memory.destroy();
         vkDestroyDevice(m_Logical, IAllocator::get());
     }
 
@@ -236,6 +303,37 @@ namespace aby::vk {
         return m_Graphics;
     }
 
+    const DeviceQueue& DeviceManager::transfer() const {
+        return m_Transfer;
+    }
+
+    bool DeviceManager::has_dedicated_transfer() const {
+        return m_Transfer.FamilyIdx != m_Graphics.FamilyIdx;
+    }
+
+    std::vector<u32> DeviceManager::queue_families() const {
+        if (has_dedicated_transfer()) {
+            return { m_Graphics.FamilyIdx, m_Transfer.FamilyIdx };
+        }
+        return { m_Graphics.FamilyIdx };
+    }
+
+    std::mutex& DeviceManager::queue_mutex() {
+        return m_QueueMutex;
+    }
+
+    std::mutex& DeviceManager::transfer_mutex() {
+        return has_dedicated_transfer() ? m_TransferMutex : m_QueueMutex;
+    }
+
+    MemoryAllocator& DeviceManager::memory() {
+        return m_Memory;
+    }
+
+    PipelineCache& DeviceManager::pipeline_cache() {
+        return m_PipelineCache;
+    }
+
 
     
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "Platform/vk/VkMemoryAllocator.h"
+#include "Platform/vk/VkAllocator.h"
+#include "Core/Log.h"
+#include <algorithm>
+#include <bit>
+
+namespace aby::vk {
+
+    MemoryAllocator::MemoryAllocator() :
+        m_Physical(VK_NULL_HANDLE),
+        m_Logical(VK_NULL_HANDLE),
+        m_Budget(false),
+        m_Granularity(1),
+        m_Properties{},
+        m_Pools{},
+        m_Dedicated{},
+        m_DeviceAllocations(0)
+    {
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        destroy();
+    }
+
+    void MemoryAllocator::create(VkPhysicalDevice physical, VkDevice logical, bool budget) {
+        m_Physical = physical;
+        m_Logical  = logical;
+        m_Budget   = budget;
+        vkGetPhysicalDeviceMemoryProperties(m_Physical, &m_Properties);
+
+        VkPhysicalDeviceProperties props = {};
+        vkGetPhysicalDeviceProperties(m_Physical, &props);
+        m_Granularity = props.limits.bufferImageGranularity;
+
+        ABY_DBG("vk::MemoryAllocator::create");
+        ABY_DBG("  Memory Types:            {}", m_Properties.memoryTypeCount);
+        ABY_DBG("  Memory Heaps:            {}", m_Properties.memoryHeapCount);
+        ABY_DBG("  Buffer Image Granularity {}", m_Granularity);
+        ABY_DBG("  Memory Budget:           {}", m_Budget ? "VK_EXT_memory_budget" : "Unsupported");
+    }
+
+    void MemoryAllocator::destroy() {
+        std::lock_guard lock(m_Mutex);
+        if (m_Logical == VK_NULL_HANDLE) {
+            return;
+        }
+        for (auto& pools : m_Pools) {
+            for (auto& pool : pools) {
+                for (auto& block : pool) {
+                    if (block && block->used > 0) {
+                        ABY_WARN("vk::MemoryAllocator::destroy: {} byte(s) still in use", block->used);
+                    }
+                    if (block) {
+                        vkFreeMemory(m_Logical, block->memory, IAllocator::get());
+                    }
+                }
+                pool.clear();
+            }
+        }
+        m_Logical           = VK_NULL_HANDLE;
+        m_DeviceAllocations = 0;
+    }
+
+    Allocation MemoryAllocator::alloc(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+        const u32 type = find_type(requirements.memoryTypeBits, properties);
+        const VkDeviceSize needed = std::max({ requirements.size, requirements.alignment, MIN_SIZE });
+
+        std::lock_guard lock(m_Mutex);
+        const VkDeviceSize size = block_size(type);
+        // Anything over half a block would waste most of it, give it its own memory.
+        if (needed > size / 2) {
+            return alloc_dedicated(requirements.size, type);
+        }
+
+        const u32 order = order_of(needed);
+        const u32 pool_idx = (linear || m_Granularity <= MIN_SIZE) ? 0 : 1;
+        auto& pool = m_Pools[type][pool_idx];
+
+        Allocation allocation;
+        allocation.type  = type;
+        allocation.pool  = pool_idx;
+        allocation.order = order;
+        allocation.size  = MIN_SIZE << order;
+
+        for (u32 i = 0; i < pool.size(); i++) {
+            if (pool[i] && alloc_from(*pool[i], order, allocation.offset)) {
+                allocation.block  = i;
+                allocation.memory = pool[i]->memory;
+                allocation.mapped = pool[i]->mapped ? pool[i]->mapped + allocation.offset : nullptr;
+                return allocation;
+            }
+        }
+
+        auto block  = create_unique<Block>();
+        block->size = size;
+        block->free.resize(order_of(size) + 1);
+        block->free.back().insert(0);
+
+        VkMemoryAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .allocationSize = size,
+            .memoryTypeIndex = type,
+        };
+        VK_CHECK(vkAllocateMemory(m_Logical, &alloc_info, IAllocator::get(), &block->memory));
+        m_DeviceAllocations++;
+        block->mapped = map(block->memory, type);
+
+        // Reuse the slot of a released block before growing the pool.
+        auto slot = std::find(pool.begin(), pool.end(), nullptr);
+        if (slot == pool.end()) {
+            pool.push_back(nullptr);
+            slot = pool.end() - 1;
+        }
+        *slot = std::move(block);
+        auto& created = **slot;
+
+        alloc_from(created, order, allocation.offset);
+        allocation.block  = static_cast<u32>(slot - pool.begin());
+        allocation.memory = created.memory;
+        allocation.mapped = created.mapped ? created.mapped + allocation.offset : nullptr;
+        ABY_DBG("vk::MemoryAllocator: New {} byte block (type {}, {} device allocations)", size, type, m_DeviceAllocations);
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::bind(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_Logical, buffer, &requirements);
+        Allocation allocation = alloc(requirements, properties, true);
+        VK_CHECK(vkBindBufferMemory(m_Logical, buffer, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::bind(VkImage image, VkMemoryPropertyFlags properties) {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_Logical, image, &requirements);
+        // Only optimal tiling images are created, linear images would have to be passed as linear here.
+        Allocation allocation = alloc(requirements, properties, false);
+        VK_CHECK(vkBindImageMemory(m_Logical, image, allocation.memory, allocation.offset));
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation& allocation) {
+        if (!allocation) {
+            return;
+        }
+        std::lock_guard lock(m_Mutex);
+        if (allocation.block == UINT32_MAX) {
+            vkFreeMemory(m_Logical, allocation.memory, IAllocator::get());
+            m_Dedicated[m_Properties.memoryTypes[allocation.type].heapIndex] -= allocation.size;
+            m_DeviceAllocations--;
+        }
+        else {
+            auto& pool  = m_Pools[allocation.type][allocation.pool];
+            auto& block = pool[allocation.block];
+            free_to(*block, allocation.offset, allocation.order);
+            // Keep one empty block per pool around so alloc/free cycles do not hit vkAllocateMemory.
+            if (block->used == 0) {
+                auto empty = std::count_if(pool.begin(), pool.end(), [](const auto& b) { return b && b->used == 0; });
+                if (empty > 1) {
+                    vkFreeMemory(m_Logical, block->memory, IAllocator::get());
+                    block.reset();
+                    m_DeviceAllocations--;
+                }
+            }
+        }
+        allocation = Allocation{};
+    }
+
+    std::vector<HeapUsage> MemoryAllocator::usage() const {
+        std::vector<HeapUsage> heaps(m_Properties.memoryHeapCount);
+        for (u32 i = 0; i < m_Properties.memoryHeapCount; i++) {
+            heaps[i].size   = m_Properties.memoryHeaps[i].size;
+            heaps[i].budget = heaps[i].size;
+        }
+        {
+            std::lock_guard lock(m_Mutex);
+            for (u32 type = 0; type < m_Properties.memoryTypeCount; type++) {
+                auto& heap = heaps[m_Properties.memoryTypes[type].heapIndex];
+                for (auto& pool : m_Pools[type]) {
+                    for (auto& block : pool) {
+                        if (!block) continue;
+                        heap.allocated += block->size;
+                        heap.used      += block->used;
+                        heap.blocks++;
+                    }
+                }
+            }
+            for (u32 i = 0; i < m_Properties.memoryHeapCount; i++) {
+                heaps[i].allocated += m_Dedicated[i];
+                heaps[i].used      += m_Dedicated[i];
+                heaps[i].usage      = heaps[i].allocated;
+            }
+        }
+        if (m_Budget) {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+                .pNext = nullptr,
+            };
+            VkPhysicalDeviceMemoryProperties2 props = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+                .pNext = &budget,
+            };
+            vkGetPhysicalDeviceMemoryProperties2(m_Physical, &props);
+            for (u32 i = 0; i < m_Properties.memoryHeapCount; i++) {
+                heaps[i].budget = budget.heapBudget[i];
+                heaps[i].usage  = budget.heapUsage[i];
+            }
+        }
+        return heaps;
+    }
+
+    u32 MemoryAllocator::device_allocations() const {
+        std::lock_guard lock(m_Mutex);
+        return m_DeviceAllocations;
+    }
+
+    u32 MemoryAllocator::find_type(u32 filter, VkMemoryPropertyFlags properties) const {
+        for (u32 i = 0; i < m_Properties.memoryTypeCount; i++) {
+            if ((filter & (1 << i)) && (m_Properties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Failed to find a suitable memory type!");
+    }
+
+    VkDeviceSize MemoryAllocator::block_size(u32 type) const {
+        // Small heaps (e.g. the 256MB host visible device local heap without ReBAR) get smaller blocks.
+        VkDeviceSize heap = m_Properties.memoryHeaps[m_Properties.memoryTypes[type].heapIndex].size;
+        return std::min(BLOCK_SIZE, std::bit_floor(std::max(heap / 8, MIN_SIZE)));
+    }
+
+    Allocation MemoryAllocator::alloc_dedicated(VkDeviceSize size, u32 type) {
+        Allocation allocation;
+        allocation.type = type;
+        allocation.size = size;
+        VkMemoryAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .allocationSize = size,
+            .memoryTypeIndex = type,
+        };
+        VK_CHECK(vkAllocateMemory(m_Logical, &alloc_info, IAllocator::get(), &allocation.memory));
+        allocation.mapped = map(allocation.memory, type);
+        m_Dedicated[m_Properties.memoryTypes[type].heapIndex] += size;
+        m_DeviceAllocations++;
+        return allocation;
+    }
+
+    bool MemoryAllocator::alloc_from(Block& block, u32 order, VkDeviceSize& offset) {
+        if (order >= block.free.size()) {
+            return false;
+        }
+        // Smallest free range that fits, split down to the requested order.
+        u32 found = order;
+        while (found < block.free.size() && block.free[found].empty()) {
+            found++;
+        }
+        if (found == block.free.size()) {
+            return false;
+        }
+        auto it = block.free[found].begin();
+        offset  = *it;
+        block.free[found].erase(it);
+        while (found > order) {
+            found--;
+            block.free[found].insert(offset + (MIN_SIZE << found));
+        }
+        block.used += MIN_SIZE << order;
+        return true;
+    }
+
+    void MemoryAllocator::free_to(Block& block, VkDeviceSize offset, u32 order) {
+        block.used -= MIN_SIZE << order;
+        // Merge with the buddy for as long as it is free as well.
+        while (order + 1 < block.free.size()) {
+            VkDeviceSize buddy = offset ^ (MIN_SIZE << order);
+            auto it = block.free[order].find(buddy);
+            if (it == block.free[order].end()) {
+                break;
+            }
+            block.free[order].erase(it);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        block.free[order].insert(offset);
+    }
+
+    std::byte* MemoryAllocator::map(VkDeviceMemory memory, u32 type) {
+        if (!(m_Properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+            return nullptr;
+        }
+        void* mapped = nullptr;
+        VK_CHECK(vkMapMemory(m_Logical, memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+        return static_cast<std::byte*>(mapped);
+    }
+
+    u32 MemoryAllocator::order_of(VkDeviceSize size) {
+        return static_cast<u32>(std::countr_zero(std::bit_ceil(size) / MIN_SIZE));
+    }
+
+}
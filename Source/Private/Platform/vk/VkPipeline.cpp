@@ -8,29 +8,33 @@ namespace aby::vk {
 		m_Device(VK_NULL_HANDLE),
 		m_Shaders(nullptr),
 		m_Pipeline(VK_NULL_HANDLE),
-		m_ColorAttachment(VK_FORMAT_UNDEFINED)
+		m_ColorAttachment(VK_FORMAT_UNDEFINED),
+		m_Instanced(false),
+		m_Permutation()
 	{
 	}
 
-	Pipeline::Pipeline(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, Swapchain& swapchain) : 
+	Pipeline::Pipeline(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, VkFormat color_format, bool instanced, std::string_view permutation, std::span<const VkPipelineShaderStageCreateInfo> stages) : 
 		m_Device(VK_NULL_HANDLE),
 		m_Shaders(nullptr),
 		m_Pipeline(VK_NULL_HANDLE),
-		m_ColorAttachment(swapchain.format())
+		m_ColorAttachment(color_format),
+		m_Instanced(instanced),
+		m_Permutation()
 	{
-		create(window, manager, shaders, swapchain);
+		create(window, manager, shaders, color_format, instanced, permutation, stages);
 	}
 
-	void Pipeline::create(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, Swapchain& swapchain) {
-		m_Device   = manager.logical();
-		m_Shaders  = shaders;
-		m_Pipeline = VK_NULL_HANDLE;
+	void Pipeline::create(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, VkFormat color_format, bool instanced, std::string_view permutation, std::span<const VkPipelineShaderStageCreateInfo> stages) {
+		m_Device      = manager.logical();
+		m_Shaders     = shaders;
+		m_Pipeline    = VK_NULL_HANDLE;
+		m_Instanced   = instanced;
+		m_Permutation = ShaderCompiler::permutation_key(permutation);
 
-		if (m_ColorAttachment == VK_FORMAT_UNDEFINED) {
-			m_ColorAttachment = swapchain.format();
-		}
+		m_ColorAttachment = color_format;
  
-		auto& descriptor = m_Shaders->vertex_descriptor();
+		auto& descriptor = instanced ? m_Shaders->instance_descriptor() : m_Shaders->vertex_descriptor();
 		auto input_binding_stride = descriptor.input_binding_stride();
 
 		std::vector<VkVertexInputBindingDescription> ibds;
@@ -39,7 +43,7 @@ namespace aby::vk {
 			VkVertexInputBindingDescription ibd = {
 				.binding   = static_cast<u32>(binding),
 				.stride    = static_cast<u32>(stride),
-				.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+				.inputRate = instanced ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX,
 			};
 			ibds.push_back(ibd);
 		}
@@ -136,14 +140,20 @@ namespace aby::vk {
 			.pColorAttachmentFormats = &m_ColorAttachment, // &format
 		};
 
-		std::vector<VkPipelineShaderStageCreateInfo> stages = m_Shaders->stages();
+		std::vector<VkPipelineShaderStageCreateInfo> shader_stages;
+		if (stages.empty()) {
+			shader_stages = m_Shaders->stages(instanced, m_Permutation);
+		}
+		else {
+			shader_stages.assign(stages.begin(), stages.end());
+		}
 
 		// Pipeline creation
 		VkGraphicsPipelineCreateInfo pipeline_ci{
 			.sType				 = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 			.pNext				 = &m_CreateInfo,
-			.stageCount			 = static_cast<u32>(stages.size()),
-			.pStages			 = stages.data(),
+			.stageCount			 = static_cast<u32>(shader_stages.size()),
+			.pStages			 = shader_stages.data(),
 			.pVertexInputState	 = &vertex_input,
 			.pInputAssemblyState = &input_asm,
 			.pViewportState		 = &viewport,
@@ -157,8 +167,8 @@ namespace aby::vk {
 			.subpass			 = 0,
 		};
 
-		// Create pipeline
-		VK_CHECK(vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &pipeline_ci, IAllocator::get(), &m_Pipeline));
+		// Create pipeline, a warm cache skips the driver's shader compilation
+		VK_CHECK(vkCreateGraphicsPipelines(m_Device, manager.pipeline_cache(), 1, &pipeline_ci, IAllocator::get(), &m_Pipeline));
 	}
 
 	void Pipeline::destroy() {
@@ -169,9 +179,17 @@ namespace aby::vk {
 		m_Shaders->destroy();
 	}
 
-	void Pipeline::bind(VkCommandBuffer buffer) {
+	VkPipeline Pipeline::replace(Pipeline&& other) {
+		ABY_ASSERT(other.m_Shaders == m_Shaders, "Pipeline: replacement built from another module");
+		return std::exchange(m_Pipeline, std::exchange(other.m_Pipeline, VK_NULL_HANDLE));
+	}
+
+	void Pipeline::bind(VkCommandBuffer buffer, std::span<const u32> dynamic_offsets) {
 		vkCmdBindPipeline(buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
 		auto& descriptors = m_Shaders->descriptors();
+		if (dynamic_offsets.empty()) {
+			dynamic_offsets = m_Shaders->dynamic_offsets();
+		}
 		vkCmdBindDescriptorSets(
 			buffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -179,8 +197,8 @@ namespace aby::vk {
 			0,						  // First set index
 			static_cast<u32>(descriptors.size()),					      // Number of sets
 			descriptors.data(),			  // The allocated descriptor set
-			0,
-			nullptr
+			static_cast<u32>(dynamic_offsets.size()), // Uniform ring slices
+			dynamic_offsets.data()
 		);
 	}
 
@@ -192,6 +210,14 @@ namespace aby::vk {
 		return m_Shaders;
 	}
 
+	bool Pipeline::instanced() const {
+		return m_Instanced;
+	}
+
+	const std::string& Pipeline::permutation() const {
+		return m_Permutation;
+	}
+
 	Pipeline::operator VkPipeline() {
 		return m_Pipeline;
 	}
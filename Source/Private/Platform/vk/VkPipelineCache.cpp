@@ -0,0 +1,89 @@
+#include "Platform/vk/VkPipelineCache.h"
+#include "Platform/vk/VkAllocator.h"
+#include "Core/Log.h"
+#include "Utility/AtomicFile.h"
+#include <cstring>
+#include <fstream>
+
+namespace aby::vk {
+
+    PipelineCache::PipelineCache() :
+        m_Device(VK_NULL_HANDLE),
+        m_Cache(VK_NULL_HANDLE),
+        m_Path(),
+        m_Properties{}
+    {
+    }
+
+    void PipelineCache::create(VkPhysicalDevice physical, VkDevice logical, const fs::path& path) {
+        m_Device = logical;
+        m_Path   = path;
+        vkGetPhysicalDeviceProperties(physical, &m_Properties);
+
+        std::vector<std::byte> data;
+        if (std::ifstream in(path, std::ios::binary | std::ios::ate); in) {
+            data.resize(static_cast<std::size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(reinterpret_cast<char*>(data.data()), data.size());
+            if (!in || !matches(data)) {
+                ABY_DBG("vk::PipelineCache: {} is stale, starting empty", path);
+                data.clear();
+            }
+        }
+
+        VkPipelineCacheCreateInfo pcci{
+            .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext           = nullptr,
+            .flags           = 0,
+            .initialDataSize = data.size(),
+            .pInitialData    = data.empty() ? nullptr : data.data(),
+        };
+        VK_CHECK(vkCreatePipelineCache(m_Device, &pcci, IAllocator::get(), &m_Cache));
+        ABY_DBG("vk::PipelineCache::create: {} bytes from {}", data.size(), path);
+    }
+
+    void PipelineCache::destroy() {
+        if (m_Cache == VK_NULL_HANDLE) {
+            return;
+        }
+        save();
+        vkDestroyPipelineCache(m_Device, m_Cache, IAllocator::get());
+        m_Cache = VK_NULL_HANDLE;
+    }
+
+    void PipelineCache::save() {
+        std::size_t size = 0;
+        VK_CHECK(vkGetPipelineCacheData(m_Device, m_Cache, &size, nullptr));
+        std::vector<std::byte> data(size);
+        VK_CHECK(vkGetPipelineCacheData(m_Device, m_Cache, &size, data.data()));
+        data.resize(size);
+
+        // Written atomically, a crash while saving leaves the old file intact.
+        std::error_code ec;
+        fs::create_directories(m_Path.parent_path(), ec);
+        ec = util::write_atomic(m_Path, [&data](std::ostream& out) {
+            out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        });
+        if (ec) {
+            ABY_WARN("vk::PipelineCache: could not write {} ({})", m_Path, ec.message());
+        }
+    }
+
+    PipelineCache::operator VkPipelineCache() const {
+        return m_Cache;
+    }
+
+    bool PipelineCache::matches(const std::vector<std::byte>& data) const {
+        VkPipelineCacheHeaderVersionOne header{};
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        return header.headerSize >= sizeof(header) &&
+            header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            header.vendorID == m_Properties.vendorID &&
+            header.deviceID == m_Properties.deviceID &&
+            std::memcmp(header.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+}
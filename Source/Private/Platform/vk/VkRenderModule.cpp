@@ -1,32 +1,47 @@
 #include "Platform/vk/VkRenderModule.h"
-#include "Utility/TagParser.h"
+#include "Platform/vk/VkTexture.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/euler_angles.hpp>
-#include <unordered_set>
+#include <algorithm>
+#include <cstring>
 
 
 namespace aby::vk {
 
+    // Full batches a single ring region holds before another ring is chained.
+    static constexpr std::size_t BATCHES_PER_RING = 2;
+
     RenderPrimitive::RenderPrimitive(Ref<vk::Context> ctx, const ShaderDescriptor& vertex_descriptor, const PrimitiveDescriptor& primitive_descriptor) :
+        m_Devices(&ctx->devices()),
         m_VertexClass(vertex_descriptor, primitive_descriptor.MaxVertices, 0),
         m_VertexAccumulator(m_VertexClass),
-        m_VertexBuffer(m_VertexClass, ctx->devices()),
-        m_IndexBuffer(primitive_descriptor.MaxIndices * sizeof(u32), ctx->devices()),
+        m_Rings{},
+        m_Ring(0),
+        m_Frame(0),
+        m_Slice{},
+        m_Batches{},
+        m_IndexBuffer(primitive_descriptor.IndicesPer != primitive_descriptor.VerticesPer ?
+            create_unique<vk::IndexBuffer>(primitive_descriptor.MaxIndices, IndexBuffer::fitting_type(primitive_descriptor.MaxVertices), ctx->devices()) : nullptr),
         m_Descriptor(primitive_descriptor),
         m_IndexCount(0)
     {
-       
+        m_Rings.push_back(create_unique<RingBuffer>(
+            m_VertexClass.max_vertices() * m_VertexClass.vertex_size() * BATCHES_PER_RING,
+            static_cast<u32>(MAX_FRAMES_IN_FLIGHT),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            ctx->devices()
+        ));
     }
 
-
-
     void RenderPrimitive::destroy() {
-        m_VertexBuffer.destroy();
-        if (m_Descriptor.IndicesPer != m_Descriptor.VerticesPer) {
-            m_IndexBuffer.destroy();
+        for (auto& ring : m_Rings) {
+            ring->destroy();
+        }
+        if (m_IndexBuffer) {
+            m_IndexBuffer->destroy();
         }
     }
 
@@ -41,13 +56,21 @@ namespace aby::vk {
         return m_VertexAccumulator.count();
     }
 
+    std::size_t RenderPrimitive::batch_count() const {
+        return m_Batches.size() + (m_VertexAccumulator.count() > 0 ? 1 : 0);
+    }
+
     void RenderPrimitive::set_index_data(const u32* indices, DeviceManager& manager) {
-        ABY_ASSERT(m_Descriptor.IndicesPer != m_Descriptor.VerticesPer, "No index buffer will be used to draw this primitive");
-        m_IndexBuffer.set_data(indices, sizeof(u32) * m_Descriptor.MaxIndices, manager);
+        ABY_ASSERT(m_IndexBuffer, "No index buffer will be used to draw this primitive");
+        m_IndexBuffer->set_indices(std::span(indices, m_Descriptor.MaxIndices), manager);
     }
 
     bool RenderPrimitive::empty() const {
-        return this->vertex_count() == 0;
+        return m_Batches.empty() && this->vertex_count() == 0;
+    }
+
+    bool RenderPrimitive::is_instanced() const {
+        return m_Descriptor.InstanceVertices != 0;
     }
 
     bool RenderPrimitive::should_flush() const {
@@ -60,35 +83,109 @@ namespace aby::vk {
         return flush;
     }
 
+    void RenderPrimitive::begin_frame(u32 frame) {
+        m_Frame = frame;
+        m_Ring  = 0;
+        for (auto& ring : m_Rings) {
+            ring->begin_frame(frame);
+        }
+        m_Batches.clear();
+        m_IndexCount = 0;
+        map_slice();
+    }
 
-    void RenderPrimitive::bind(VkCommandBuffer cmd, DeviceManager& manager) {
-        m_VertexBuffer.set_data(m_VertexAccumulator.data(), m_VertexAccumulator.bytes(), manager);
-        m_VertexBuffer.bind(cmd);
-        if (m_Descriptor.IndicesPer != m_Descriptor.VerticesPer) {
-            m_IndexBuffer.bind(cmd);
+    void RenderPrimitive::next_batch() {
+        if (m_VertexAccumulator.count() == 0) {
+            return;
+        }
+        m_Batches.push_back(Batch{
+            .buffer   = static_cast<VkBuffer>(*m_Rings[m_Ring]),
+            .offset   = m_Slice.offset,
+            .vertices = static_cast<u32>(m_VertexAccumulator.count()),
+            .indices  = static_cast<u32>(m_IndexCount),
+        });
+        m_IndexCount = 0;
+        map_slice();
+    }
+
+    void RenderPrimitive::map_slice() {
+        const std::size_t batch_bytes = m_VertexClass.max_vertices() * m_VertexClass.vertex_size();
+        m_Slice = m_Rings[m_Ring]->alloc(batch_bytes);
+        while (!m_Slice) {
+            if (++m_Ring == m_Rings.size()) {
+                ABY_DBG("RenderPrimitive: Chaining vertex ring {}", m_Ring);
+                m_Rings.push_back(create_unique<RingBuffer>(
+                    batch_bytes * BATCHES_PER_RING,
+                    static_cast<u32>(MAX_FRAMES_IN_FLIGHT),
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                    *m_Devices
+                ));
+            }
+            m_Rings[m_Ring]->begin_frame(m_Frame);
+            m_Slice = m_Rings[m_Ring]->alloc(batch_bytes);
+        }
+        m_VertexAccumulator.map(m_Slice.data);
+    }
+
+    std::span<std::byte> RenderPrimitive::push_bytes(std::size_t count) {
+        const std::size_t per  = m_Descriptor.VerticesPer;
+        const std::size_t room = (m_VertexAccumulator.capacity() - m_VertexAccumulator.count()) / per * per;
+        auto claimed = m_VertexAccumulator.push(std::min(count / per * per, room));
+        m_IndexCount += claimed.size() / m_VertexAccumulator.vertex_size() / per * m_Descriptor.IndicesPer;
+        return claimed;
+    }
+
+    void RenderPrimitive::bind(VkCommandBuffer cmd) {
+        // Vertex buffers are bound per batch in draw().
+        if (m_IndexBuffer) {
+            m_IndexBuffer->bind(cmd);
         }
     }
     
     void RenderPrimitive::draw(VkCommandBuffer cmd) {
-        if (m_Descriptor.IndicesPer == m_Descriptor.VerticesPer) {
-            draw_nonindexed(cmd);
+        // The vertices were written into the rings by the accumulator, nothing to copy.
+        auto draw_batch = [this, cmd](const Batch& batch) {
+            vkCmdBindVertexBuffers(cmd, 0, 1, &batch.buffer, &batch.offset);
+            if (is_instanced()) {
+                draw_instanced(cmd, batch);
+            }
+            else if (m_Descriptor.IndicesPer == m_Descriptor.VerticesPer) {
+                draw_nonindexed(cmd, batch);
+            }
+            else {
+                draw_indexed(cmd, batch);
+            }
+        };
+        for (auto& batch : m_Batches) {
+            draw_batch(batch);
         }
-        else {
-            draw_indexed(cmd);
+        if (m_VertexAccumulator.count() > 0) {
+            draw_batch(Batch{
+                .buffer   = static_cast<VkBuffer>(*m_Rings[m_Ring]),
+                .offset   = m_Slice.offset,
+                .vertices = static_cast<u32>(m_VertexAccumulator.count()),
+                .indices  = static_cast<u32>(m_IndexCount),
+            });
         }
     }
 
 
-    void RenderPrimitive::draw_indexed(VkCommandBuffer cmd) {
-        vkCmdDrawIndexed(cmd, static_cast<u32>(m_IndexCount), 1u, 0u, 0u, 0u);
+    void RenderPrimitive::draw_indexed(VkCommandBuffer cmd, const Batch& batch) {
+        vkCmdDrawIndexed(cmd, batch.indices, 1u, 0u, 0u, 0u);
     }
 
-    void RenderPrimitive::draw_nonindexed(VkCommandBuffer cmd) {
-        vkCmdDraw(cmd, static_cast<u32>(this->vertex_count()), 1u, 0u, 0u);
+    void RenderPrimitive::draw_nonindexed(VkCommandBuffer cmd, const Batch& batch) {
+        vkCmdDraw(cmd, batch.vertices, 1u, 0u, 0u);
+    }
+
+    void RenderPrimitive::draw_instanced(VkCommandBuffer cmd, const Batch& batch) {
+        // The corners come from gl_VertexIndex, the batch holds one record per instance.
+        vkCmdDraw(cmd, m_Descriptor.InstanceVertices, batch.vertices, 0u, 0u);
     }
 
     void RenderPrimitive::reset() {
         m_VertexAccumulator.reset();
+        m_Batches.clear();
         m_IndexCount = 0;
     }
 
@@ -105,126 +202,78 @@ namespace aby::vk {
 
 namespace aby::vk {
 
-    static constexpr glm::mat4 UNIT_MATRIX = glm::mat4(1);
-
-    static constexpr glm::vec2 COORDS[4] = {
-        { 0.0f, 0.0f },
-        { 1.0f, 0.0f },
-        { 1.0f, 1.0f },
-        { 0.0f, 1.0f }
-    };
-    static constexpr glm::vec4 VERTEX_POSITIONS[4] = {
-        { -0.5f, -0.5f, 0.0f, 1.0f },
-        {  0.5f, -0.5f, 0.0f, 1.0f },
-        {  0.5f,  0.5f, 0.0f, 1.0f },
-        { -0.5f,  0.5f, 0.0f, 1.0f }
-    };
-
-    static const std::unordered_set<char32_t> TEXT_ESCAPE_CHARACTERS = {
-        0x27, // '''
-        0x22, // '"'
-        0x3f, // '?'
-        0x5c, // '\'
-        0x07, // '\a'
-        0x08, // '\b'
-        0x0c, // '\f'
-        0x0a, // '\n'
-        0x0d, // '\r'
-        0x09, // '\t'
-        0x0b, // '\v'
-    };
-
-    glm::mat4 compute_text_transform(const ft::Glyph& g, const glm::vec2& current_position, float text_scale, float text_size_y) {
-        glm::vec3 size = { g.size.x * text_scale, g.size.y * text_scale, 0.f };
-        glm::vec3 pos = {
-            (current_position.x + g.bearing.x * text_scale) + (size.x / 2),
-            (current_position.y + (text_size_y - g.bearing.y) * text_scale) + (size.y / 2),
-            0.f
-        };
-        return glm::translate(UNIT_MATRIX, pos) * glm::scale(UNIT_MATRIX, size);
-    }
-
-
-
+    // Full texture, the corners pick their texcoord from it in the shader.
+    static constexpr glm::vec4 UNIT_UV_RECT = { 0.0f, 0.0f, 1.0f, 1.0f };
 
-    RenderModule::RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, const std::vector<fs::path>& shaders) :
-        m_Ctx(ctx.get()),
-        m_Module(ShaderModule::create(ctx.get(), shaders[0], shaders[1])),
-        m_Pipeline(ctx->window(), ctx->devices(), m_Module, swapchain),
-        m_Primitives{
-            RenderPrimitive(ctx, m_Module->vertex_descriptor(), PrimitiveDescriptor{
+    static RenderPrimitiveArray create_primitives(Ref<vk::Context> ctx, const ShaderModule& module) {
+        return RenderPrimitiveArray{
+            RenderPrimitive(ctx, module.vertex_descriptor(), PrimitiveDescriptor{
                 .MaxVertices = 10000,
-                .MaxIndices = 30000, 
+                .MaxIndices = 30000,
                 .IndicesPer = 3,
                 .VerticesPer = 3
             }), // Triangles
-            RenderPrimitive(ctx, m_Module->vertex_descriptor(), PrimitiveDescriptor{
-                .MaxVertices = 10000 * 2,
-                .MaxIndices = 60000 * 2,
-                .IndicesPer = 6,
-                .VerticesPer = 4
-            }) // Quads
-        }
+            RenderPrimitive(ctx, module.instance_descriptor(), PrimitiveDescriptor{
+                .MaxVertices = 10000,
+                .MaxIndices = 0,
+                .IndicesPer = 1,
+                .VerticesPer = 1,
+                .InstanceVertices = 6
+            }), // Quads
+            RenderPrimitive(ctx, module.instance_descriptor(), PrimitiveDescriptor{
+                .MaxVertices = 10000,
+                .MaxIndices = 0,
+                .IndicesPer = 1,
+                .VerticesPer = 1,
+                .InstanceVertices = 6 * 6
+            }) // Cubes
+        };
+    }
+
+    static Unique<RingBuffer> create_glyph_staging(Ref<vk::Context> ctx) {
+        // Room for every page of the default budget per frame, a page left dirty would be drawn with its old
+        // (possibly evicted) glyphs this frame. Usually only a few glyphs are new.
+        return create_unique<RingBuffer>(
+            GlyphAtlas::DEFAULT_BUDGET,
+            static_cast<u32>(MAX_FRAMES_IN_FLIGHT),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            ctx->devices()
+        );
+    }
+
+    RenderModule::RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, const std::vector<fs::path>& shaders, std::string_view permutation) :
+        m_Ctx(ctx.get()),
+        m_Module(ShaderModule::create(ctx.get(), shaders[0], shaders[1], shaders.size() > 2 ? shaders[2] : fs::path{})),
+        m_Pipeline(ctx->window(), ctx->devices(), m_Module, swapchain.format(), false, permutation),
+        m_InstancePipeline(ctx->window(), ctx->devices(), m_Module, swapchain.format(), true, permutation),
+        m_UniformOffsets(m_Module->dynamic_offsets().begin(), m_Module->dynamic_offsets().end()),
+        m_PushConstants{},
+        m_PushConstantBytes(0),
+        m_Primitives(create_primitives(ctx, *m_Module)),
+        m_GlyphStaging(create_glyph_staging(ctx))
     {
-        init();
     }
 
-    RenderModule::RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, Ref<ShaderModule> module) :
+    RenderModule::RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, Ref<ShaderModule> module, std::string_view permutation) :
         m_Ctx(ctx.get()),
         m_Module(module),
-        m_Pipeline(ctx->window(), ctx->devices(), m_Module, swapchain),
-        m_Primitives{
-            RenderPrimitive(ctx, m_Module->vertex_descriptor(), PrimitiveDescriptor{
-                .MaxVertices = 10000,
-                .MaxIndices = 30000,
-                .IndicesPer = 3,
-                .VerticesPer = 3
-            }), // Triangles
-            RenderPrimitive(ctx, m_Module->vertex_descriptor(), PrimitiveDescriptor{
-                .MaxVertices = 10000 * 2,
-                .MaxIndices = 60000 * 2,
-                .IndicesPer = 6,
-                .VerticesPer = 4
-            }) // Quads
-        }
+        m_Pipeline(ctx->window(), ctx->devices(), m_Module, swapchain.format(), false, permutation),
+        m_InstancePipeline(ctx->window(), ctx->devices(), m_Module, swapchain.format(), true, permutation),
+        m_UniformOffsets(m_Module->dynamic_offsets().begin(), m_Module->dynamic_offsets().end()),
+        m_PushConstants{},
+        m_PushConstantBytes(0),
+        m_Primitives(create_primitives(ctx, *m_Module)),
+        m_GlyphStaging(create_glyph_staging(ctx))
     {
-        init();
-    }
-
-    void RenderModule::init() {
-        auto& quad_prim = this->quads();
-        auto& prim_desc = quad_prim.descriptor();
-#ifdef NDEBUG
-        uint32_t* indices = new uint32_t[prim_desc.MaxIndices];
-        for (uint32_t i = 0, offset = 0; i < prim_desc.MaxIndices; i += prim_desc.IndicesPer, offset += prim_desc.VerticesPer) {
-            indices[i + 0] = offset + 0;
-            indices[i + 1] = offset + 1;
-            indices[i + 2] = offset + 2;
-            indices[i + 3] = offset + 2;
-            indices[i + 4] = offset + 3;
-            indices[i + 5] = offset + 0;
-        }
-        quad_prim.set_index_data(indices, m_Ctx->devices());
-        delete[] indices;
-#else
-        std::vector<uint32_t> indices(prim_desc.MaxIndices);
-        for (uint32_t i = 0, offset = 0; i < prim_desc.MaxIndices; i += prim_desc.IndicesPer, offset += prim_desc.VerticesPer) {
-            indices[i + 0] = offset + 0;
-            indices[i + 1] = offset + 1;
-            indices[i + 2] = offset + 2;
-            indices[i + 3] = offset + 2;
-            indices[i + 4] = offset + 3;
-            indices[i + 5] = offset + 0;
-        }
-        quad_prim.set_index_data(indices.data(), m_Ctx->devices());
-#endif
     }
 
     void RenderModule::destroy() {
         m_Pipeline.destroy();
+        m_InstancePipeline.destroy();
         for (auto& prim : m_Primitives) {
             prim.destroy();
         }
+        m_GlyphStaging->destroy();
     }
 
     void RenderModule::reset() {
@@ -232,183 +281,182 @@ namespace aby::vk {
             prim.reset();
         }
     }
+
+    void RenderModule::begin_frame(u32 frame) {
+        m_Module->begin_frame(frame);
+        for (auto& prim : m_Primitives) {
+            prim.begin_frame(frame);
+        }
+        m_GlyphStaging->begin_frame(frame);
+        m_TextLayouts.next_frame();
+    }
+
+    void RenderModule::next_batch(ERenderPrimitive primitive) {
+        if (primitive == ERenderPrimitive::ALL) {
+            for (auto& prim : m_Primitives) {
+                prim.next_batch();
+            }
+        }
+        else {
+            m_Primitives[static_cast<std::size_t>(primitive)].next_batch();
+        }
+    }
     
     void RenderModule::flush(VkCommandBuffer cmd, DeviceManager& manager, ERenderPrimitive primitive) {
+        // Dynamic state set by the renderer carries over, both pipelines declare the same dynamic states.
+        auto flush_primitive = [this, cmd](RenderPrimitive& prim) {
+            if (prim.empty()) {
+                return;
+            }
+            (prim.is_instanced() ? m_InstancePipeline : m_Pipeline).bind(cmd, m_UniformOffsets);
+            if (m_PushConstantBytes) {
+                const auto& range = m_Module->push_constants();
+                vkCmdPushConstants(cmd, m_Module->layout(), range.stageFlags, 0, m_PushConstantBytes, m_PushConstants.data());
+            }
+            prim.bind(cmd);
+            prim.draw(cmd);
+        };
         if (primitive == ERenderPrimitive::ALL) {
             for (auto& prim : m_Primitives) {
-                if (!prim.empty()) {
-                    prim.bind(cmd, manager);
-                    prim.draw(cmd);
-                }
+                flush_primitive(prim);
             }
         }
         else {
-            auto& prim = m_Primitives[static_cast<std::size_t>(primitive)];
-            if (!prim.empty()) {
-                prim.bind(cmd, manager);
-                prim.draw(cmd);
-            }
+            flush_primitive(m_Primitives[static_cast<std::size_t>(primitive)]);
         }
     }
 
     void RenderModule::set_uniforms(const void* data, std::size_t bytes, u32 binding) {
         m_Module->set_uniforms(data, bytes, binding);
+        auto offsets = m_Module->dynamic_offsets();
+        m_UniformOffsets.assign(offsets.begin(), offsets.end());
+    }
+
+    void RenderModule::push_constants(const void* data, std::size_t bytes) {
+        ABY_ASSERT(bytes <= m_Module->push_constants().size && bytes <= MAX_PUSH_CONSTANTS,
+            "Push constants of {} bytes exceed the {} byte block", bytes, m_Module->push_constants().size);
+        std::memcpy(m_PushConstants.data(), data, bytes);
+        m_PushConstantBytes = static_cast<u32>(bytes);
     }
 
     void RenderModule::draw_triangle(const Triangle& triangle) {
         auto& acc = this->tris();
-        acc = triangle.v1;
+        acc = PackedVertex(triangle.v1);
         ++acc;
-        acc = triangle.v2;
+        acc = PackedVertex(triangle.v2);
         ++acc;
-        acc = triangle.v3;
+        acc = PackedVertex(triangle.v3);
         ++acc;
     }
     
     void RenderModule::draw_quad(const Quad& quad) {
         auto& acc = this->quads();
-
-        glm::mat4 transform = glm::translate(UNIT_MATRIX, quad.pos) * glm::scale(UNIT_MATRIX, quad.size);
-
-        for (std::size_t i = 0; i < std::size(VERTEX_POSITIONS); i++) {
-            glm::vec3 pos(transform * VERTEX_POSITIONS[i]);
-            glm::vec3 texinfo(COORDS[i], quad.texinfo.z);
-            Vertex v(pos, quad.col, texinfo);
-            acc = v;
-            ++acc;
-        }
+        // A quad has no depth, the z size would push the (front) face out of its plane.
+        acc = QuadInstance(quad.pos, { quad.size.x, quad.size.y, 0.f }, quad.col, UNIT_UV_RECT, quad.texinfo.z, quad.uvs);
+        ++acc;
     }
 
     void RenderModule::draw_cube(const Quad& quad) {
-        auto& acc = this->quads();
-
-        glm::vec3 half_size = quad.size * 0.5f;
+        auto& acc = this->cubes();
+        // The six faces are expanded in the shader, see Instance.glsl.
+        acc = QuadInstance(quad.pos, quad.size, quad.col, UNIT_UV_RECT, quad.texinfo.z, quad.uvs);
+        ++acc;
+    }
 
+    void RenderModule::draw_text(const Text& text) {
+        // Nothing to draw until the font has loaded, the prebaked atlas falls back to the default texture.
+        Ref<Font> font_obj = m_Ctx->fonts().try_at({ EResource::FONT, text.font });
+        if (!font_obj) {
+            return;
+        }
+        const TextLayout& layout = m_TextLayouts.get(font_obj, text);
+        GlyphAtlas&       atlas  = font_obj->atlas();
 
-        struct FaceTransform {
-            glm::vec3 translation;
-            glm::vec3 rotation_axis;
-            float rotation_angle; // in radians
-        };
+        for (Quad highlight : layout.highlights) {
+            highlight.pos += glm::vec3(text.pos.x, text.pos.y, 0.f);
+            draw_quad(highlight);
+        }
 
-        const FaceTransform faces[6] = {
-            // Front face (+Z)
-            { {0, 0, half_size.z}, {0, 0, 0}, 0 },
-            // Back face (-Z)
-            { {0, 0, -half_size.z}, {0, 1, 0}, glm::pi<float>() },
-            // Left face (-X)
-            { {-half_size.x, 0, 0}, {0, 1, 0}, -glm::half_pi<float>() },
-            // Right face (+X)
-            { {half_size.x, 0, 0}, {0, 1, 0}, glm::half_pi<float>() },
-            // Top face (+Y)
-            { {0, half_size.y, 0}, {1, 0, 0}, -glm::half_pi<float>() },
-            // Bottom face (-Y)
-            { {0, -half_size.y, 0}, {1, 0, 0}, glm::half_pi<float>() },
+        GlyphRun run{
+            .origin  = { text.pos.x, text.pos.y, 0.f },
+            .scale   = text.scale,
+            .height  = layout.size.y,
+            .color   = text.color,
+            .texture = 0.f,
+            .flags   = 0,
         };
-
-        for (const auto& face : faces) {
-            glm::mat4 face_transform = glm::translate(UNIT_MATRIX, quad.pos);
-            face_transform *= glm::translate(UNIT_MATRIX, face.translation);
-            if (face.rotation_angle != 0.0f)
-                face_transform *= glm::rotate(UNIT_MATRIX, face.rotation_angle, face.rotation_axis);
-            face_transform *= glm::scale(UNIT_MATRIX, { quad.size.x, quad.size.y, 1.0f });
-
-            for (std::size_t i = 0; i < std::size(VERTEX_POSITIONS); i++) {
-                glm::vec3 pos(face_transform * VERTEX_POSITIONS[i]);
-                glm::vec3 texinfo(COORDS[i], quad.texinfo.z);
-                Vertex v(pos, quad.col, texinfo);
-                acc = v;
-                ++acc;
+        // Only atlas pages hold distance fields, the prebaked glyphs are always coverage.
+        const u32 page_flags = font_obj->mode() == EFontMode::SDF ? QuadInstance::TEXTURE_SDF : 0;
+        for (const auto& span : layout.runs) {
+            Resource texture = font_obj->texture();
+            if (span.page != FontGlyph::PREBAKED) {
+                texture = atlas.texture(span.page);
+                // A new page is drawn once its texture exists, the fallback would show as boxes.
+                if (!m_Ctx->textures().is_ready(texture)) {
+                    continue;
+                }
+                atlas.touch(span.page);
             }
+            run.texture = static_cast<float>(m_Ctx->textures().resolve(texture).handle());
+            run.flags   = span.page != FontGlyph::PREBAKED ? page_flags : 0;
+            draw_glyph_run(std::span(layout.glyphs).subspan(span.first, span.count), run);
+        }
+
+        if (atlas.pages() > 0 && std::find(m_GlyphFonts.begin(), m_GlyphFonts.end(), font_obj) == m_GlyphFonts.end()) {
+            m_GlyphFonts.push_back(font_obj);
         }
     }
 
-    void RenderModule::draw_text(const Text& text) {
-        Ref<Font>    font_obj = m_Ctx->fonts().at({ EResource::FONT, text.font });
-        float        texture = static_cast<float>(font_obj->texture().handle());
-        Ref<Texture> tex_obj = m_Ctx->textures().at(font_obj->texture());
-        auto&        acc = this->quads();
-        const auto&  glyphs = font_obj->glyphs();
-
-        glm::vec2   text_size        = font_obj->measure(text.text) * text.scale;
-        glm::vec3   current_position = { text.pos.x, text.pos.y, 0.f }; 
-        glm::vec4   color            = text.color;
-        std::string stripped_text    = text.prefix + text.text;
-        auto        text_decors      = util::parse_and_strip_tags(stripped_text);
-
-        std::size_t cursor = 0;
-
-        for (auto& decor : text_decors) {
-            if (decor.type != util::ETextDecor::HIGHLIGHT)
+    void RenderModule::draw_quads(std::span<const Quad> quads) {
+        write_quads(this->quads(), quads, true);
+    }
+
+    void RenderModule::draw_cubes(std::span<const Quad> cubes) {
+        write_quads(this->cubes(), cubes, false);
+    }
+
+    void RenderModule::draw_glyph_run(std::span<const GlyphQuad> glyphs, const GlyphRun& run) {
+        auto& prim = this->quads();
+        while (!glyphs.empty()) {
+            auto out = prim.push<QuadInstance>(glyphs.size());
+            if (out.empty()) {
+                prim.next_batch();
                 continue;
-            
-            if (!font_obj->is_mono())
-                throw std::runtime_error("TODO: Implement ETextDecoration::HIGHLIGHT for non mono fonts");
-
-            auto underline_start = glm::vec2{ 
-                current_position.x + (font_obj->char_width() * decor.range.start),
-                current_position.y - 2.f
-            };
-
-            auto underline_end = glm::vec2{
-                current_position.x + (font_obj->char_width() * (decor.range.end + 1)),
-                current_position.y
-            };
-            Quad quad({ (underline_end - underline_start).x, text_size.y + 4.f }, underline_start, { 0.1, 0.1, 1.0, 1.f });
-            draw_quad(quad);
+            }
+            kernels::write_glyphs(glyphs.first(out.size()), run, out.data());
+            glyphs = glyphs.subspan(out.size());
         }
+    }
 
-        for (char32_t c : stripped_text) {
-            // Skip escape characters
-            if (TEXT_ESCAPE_CHARACTERS.contains(c)) {
-                switch (c) {
-                case U'\t': {
-                    current_position.x += (glyphs.at(U' ').advance * text.scale * 4);
-                    break;
-                }
-                }
+    void RenderModule::write_quads(RenderPrimitive& prim, std::span<const Quad> quads, bool flat) {
+        while (!quads.empty()) {
+            auto out = prim.push<QuadInstance>(quads.size());
+            if (out.empty()) {
+                prim.next_batch();
                 continue;
             }
-            auto it = glyphs.find(c);
-            if (it == glyphs.end()) {
+            auto chunk = quads.first(out.size());
+            kernels::write_quads(chunk, out.data(), flat);
+            resolve_textures(chunk, out.data());
+            quads = quads.subspan(out.size());
+        }
+    }
+
+    void RenderModule::resolve_textures(std::span<const Quad> quads, QuadInstance* out) {
+        // See Renderer::resolve_texture, untextured records are not touched again.
+        float last     = 0.f;
+        u32   resolved = 0;
+        for (std::size_t i = 0; i < quads.size(); i++) {
+            float texture = quads[i].texinfo.z;
+            if (texture == 0.f) {
                 continue;
             }
-            const auto& glyph = it->second;
-            glm::mat4 transform = compute_text_transform(glyph, current_position, text.scale, text_size.y);
-            for (std::size_t i = 0; i < 4; i++) {
-                glm::vec3 position(transform * VERTEX_POSITIONS[i]);
-                glm::vec3 texinfo(glyph.texcoords[i].x, glyph.texcoords[i].y, texture);
-                acc = Vertex(position, color, texinfo);
-                ++acc;
-            }
-
-            for (auto& decor : text_decors) {
-                if (cursor >= decor.range.start && cursor <= decor.range.end) {
-                    switch (decor.type) {
-                    case util::ETextDecor::UNDERLINE: {
-                            auto decor_it = glyphs.find('_');
-                            if (decor_it == glyphs.end()) {
-                                IF_DBG(ABY_WARN("Font Glyph for character '{:#x}' not found", (int32_t)c), ;);
-                                continue;
-                            }
-                            const auto& decor_glyph = decor_it->second;
-                            glm::mat4 decor_transform = compute_text_transform(decor_glyph, { current_position.x, current_position.y }, text.scale, text_size.y);
-                            for (std::size_t i = 0; i < 4; i++) {
-                                glm::vec3 position(decor_transform * VERTEX_POSITIONS[i]);
-                                glm::vec3 texinfo(decor_glyph.texcoords[i].x, decor_glyph.texcoords[i].y, texture);
-                                acc = Vertex(position, color, texinfo);
-                                ++acc;
-                            }
-                            break;
-                        }
-                        default:
-                            break;
-                    }
-                }
+            if (texture != last) {
+                Resource resource(EResource::TEXTURE, static_cast<Resource::Handle>(texture));
+                resolved = static_cast<u32>(m_Ctx->textures().resolve(resource).handle());
+                last     = texture;
             }
-
-            current_position.x += glyph.advance * text.scale;
-            cursor++;
+            out[i].texture = resolved;
         }
     }
 
@@ -416,11 +464,66 @@ namespace aby::vk {
         std::size_t idx = static_cast<std::size_t>(ERenderPrimitive::QUAD);
         return m_Primitives[idx];
     }
+    RenderPrimitive& RenderModule::cubes() {
+        std::size_t idx = static_cast<std::size_t>(ERenderPrimitive::CUBE);
+        return m_Primitives[idx];
+    }
     RenderPrimitive& RenderModule::tris() {
         std::size_t idx = static_cast<std::size_t>(ERenderPrimitive::TRIANGLE);
         return m_Primitives[idx];
     }
 
+    void RenderModule::upload_glyphs(VkCommandBuffer cmd) {
+        auto upload = [this, cmd](Resource texture, const glm::u32vec2& offset, const glm::u32vec2& size, std::span<const std::byte> pixels) {
+            auto tex = std::static_pointer_cast<vk::Texture>(m_Ctx->textures().try_at(texture));
+            if (!tex) {
+                return false; // Still loading, the rectangle stays dirty
+            }
+            auto slice = m_GlyphStaging->alloc(static_cast<std::size_t>(size.x) * size.y, 4);
+            if (!slice) {
+                return false; // This frame's staging region is used up (more than one full atlas dirty), uploaded next frame
+            }
+            for (u32 row = 0; row < size.y; row++) {
+                std::memcpy(slice.data.data() + static_cast<std::size_t>(row) * size.x, pixels.data() + static_cast<std::size_t>(row) * GlyphAtlas::PAGE_SIZE.x, size.x);
+            }
+            // Only the rectangle changes, the rest of the page keeps its pixels through the transitions.
+            helper::transition_image_layout(
+                cmd,
+                tex->img(),
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_ACCESS_2_NONE,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT
+            );
+            helper::copy_buffer_to_img(
+                cmd,
+                *m_GlyphStaging,
+                slice.offset,
+                tex->img(),
+                VkOffset2D{ static_cast<i32>(offset.x), static_cast<i32>(offset.y) },
+                VkExtent2D{ size.x, size.y }
+            );
+            helper::transition_image_layout(
+                cmd,
+                tex->img(),
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+            );
+            return true;
+        };
+        for (auto& font : m_GlyphFonts) {
+            font->atlas().upload(upload);
+            font->atlas().next_frame();
+        }
+        m_GlyphFonts.clear();
+    }
+
     Ref<ShaderModule> RenderModule::module() const {
         return m_Module;
     }
@@ -428,6 +531,10 @@ namespace aby::vk {
     vk::Pipeline& RenderModule::pipeline() {
         return m_Pipeline;
     }
+
+    vk::Pipeline& RenderModule::instance_pipeline() {
+        return m_InstancePipeline;
+    }
   
 
 
@@ -21,38 +21,80 @@ namespace aby::vk {
         m_Ctx(ctx),
         m_Frames{},
         m_Swapchain(ctx->surface(), ctx->devices(), ctx->window(), m_Frames),
+        // Only text has distance field glyphs, the cubes of the 3D module use the default fragment stage.
         m_2D(ctx, m_Swapchain, { 
             ctx->app()->bin() / "Shaders/Vertex.glsl",
-            ctx->app()->bin() / "Shaders/Fragment.glsl" 
-        }),
+            ctx->app()->bin() / "Shaders/Fragment.glsl",
+            ctx->app()->bin() / "Shaders/Instance.glsl"
+        }, "SDF"),
         m_3D(ctx, m_Swapchain, m_2D.module()),
+        m_Reloader(ctx.get(), m_2D.module()),
         m_RecycledSemaphores{},
+        m_FrameFences{},
+        m_Frame(0),
+        m_FrameStarted(false),
         m_Img(0)
     {
         m_Ctx->window()->register_event(this, &Renderer::on_event);
+        VkFenceCreateInfo fence_info{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+        };
+        for (auto& fence : m_FrameFences) {
+            VK_CHECK(vkCreateFence(m_Ctx->devices().logical(), &fence_info, IAllocator::get(), &fence));
+        }
+        // Bound in place of any texture whose load is still pending (or failed).
         Resource default_tex = Texture::create(m_Ctx.get(), { 1, 1 }, { 1, 1, 1, 1 });
-        (void)default_tex;
+        m_Ctx->loader().wait(default_tex);
+        m_Ctx->textures().set_fallback(default_tex);
+    }
+
+    float Renderer::resolve_texture(float texture) const {
+        if (texture == 0.f) {
+            return texture;
+        }
+        Resource resource(EResource::TEXTURE, static_cast<Resource::Handle>(texture));
+        return static_cast<float>(m_Ctx->textures().resolve(resource).handle());
     }
     
     void Renderer::draw_text(const Text& text) {
-        flush_if(m_2D, m_2D.quads().should_flush(text.text.length()), ERenderPrimitive::QUAD);
+        // One glyph instance per character plus an underline instance where decorated.
+        flush_if(m_2D, m_2D.quads().should_flush((text.prefix.length() + text.text.length()) * 2), ERenderPrimitive::QUAD);
         m_2D.draw_text(text);
     }
    
     void Renderer::draw_triangle(const Triangle& triangle) {
         flush_if(m_2D, m_2D.tris().should_flush(), ERenderPrimitive::TRIANGLE);
-        m_2D.draw_triangle(triangle);
+        Triangle resolved(triangle);
+        resolved.v1.texinfo.z = resolve_texture(resolved.v1.texinfo.z);
+        resolved.v2.texinfo.z = resolve_texture(resolved.v2.texinfo.z);
+        resolved.v3.texinfo.z = resolve_texture(resolved.v3.texinfo.z);
+        m_2D.draw_triangle(resolved);
     }
 
     void Renderer::draw_cube(const Quad& cube) {
-        flush_if(m_3D, m_3D.quads().should_flush(), ERenderPrimitive::QUAD);
-        m_3D.draw_cube(cube);
+        flush_if(m_3D, m_3D.cubes().should_flush(), ERenderPrimitive::CUBE);
+        Quad resolved(cube);
+        resolved.texinfo.z = resolve_texture(resolved.texinfo.z);
+        m_3D.draw_cube(resolved);
     }
 
     void Renderer::draw_quad(const Quad& quad) {
         if (quad.col.a == 0) return;
         flush_if(m_2D, m_2D.quads().should_flush(), ERenderPrimitive::QUAD);
-        m_2D.draw_cube(quad);
+        Quad resolved(quad);
+        resolved.texinfo.z = resolve_texture(resolved.texinfo.z);
+        m_2D.draw_quad(resolved);
+    }
+
+    void Renderer::draw_quads(std::span<const Quad> quads) {
+        // Splits into batches and resolves textures itself.
+        m_2D.draw_quads(quads);
+    }
+
+    void Renderer::draw_cubes(std::span<const Quad> cubes) {
+        m_3D.draw_cubes(cubes);
     }
 
     void Renderer::start_batch(RenderModule& module) {
@@ -65,10 +107,9 @@ namespace aby::vk {
     }
 
     void Renderer::flush_if(RenderModule& module, bool flush, ERenderPrimitive primitive) {
+        // Full batches are drawn as additional draws of this frame, see RenderPrimitive::next_batch.
         if (flush) {
-            this->on_end();
-            start_batch(module);
-            this->on_begin();
+            module.next_batch(primitive);
         }
     }
 
@@ -78,28 +119,49 @@ namespace aby::vk {
         for (auto semaphore : m_RecycledSemaphores) {
             vkDestroySemaphore(logical, semaphore, IAllocator::get());
         }
+        for (auto fence : m_FrameFences) {
+            vkDestroyFence(logical, fence, IAllocator::get());
+        }
         m_Swapchain.destroy(m_Ctx->devices(), m_Frames);
+        m_Reloader.destroy();
         m_2D.destroy();
         m_3D.destroy();
     }
 
+    void Renderer::begin_frame() {
+        if (m_FrameStarted) {
+            return;
+        }
+        m_FrameStarted = true;
+        // Only reset right before the submission that signals it again, so a frame that never
+        // reaches the queue (e.g. failed acquire) leaves it signaled.
+        VK_CHECK(vkWaitForFences(m_Ctx->devices().logical(), 1, &m_FrameFences[m_Frame], VK_TRUE, UINT64_MAX));
+        RenderModule* modules[] = { &m_2D, &m_3D };
+        m_Reloader.update(modules, m_Swapchain);
+        m_2D.begin_frame(m_Frame);
+        m_3D.begin_frame(m_Frame);
+    }
+
     void Renderer::on_begin() {
+        begin_frame();
         start_batch(m_2D);
         auto viewport_size = m_Swapchain.size();
         glm::mat4 ortho_view_proj = glm::ortho(0.0f, static_cast<float>(viewport_size.x), 0.0f, static_cast<float>(viewport_size.y), -1.0f, 1.0f);
-        m_2D.module()->set_uniforms(&ortho_view_proj, sizeof(ortho_view_proj));
+        m_2D.push_constants(&ortho_view_proj, sizeof(ortho_view_proj));
     }
 
     void Renderer::on_begin(const glm::mat4& view_projection) {
+        begin_frame();
         start_batch(m_2D);
         start_batch(m_3D);
-        m_3D.set_uniforms(&view_projection, sizeof(view_projection));
+        m_3D.push_constants(&view_projection, sizeof(view_projection));
         auto viewport_size = m_Swapchain.size(); 
         glm::mat4 ortho_view_proj = glm::ortho(0.0f, static_cast<float>(viewport_size.x), 0.0f, static_cast<float>(viewport_size.y), -1.0f, 1.0f);
-        m_2D.set_uniforms(&ortho_view_proj, sizeof(ortho_view_proj));
+        m_2D.push_constants(&ortho_view_proj, sizeof(ortho_view_proj));
     }
 
     void Renderer::on_end() {
+        begin_frame();
         VkResult res;
         std::tie(res, m_Img) = acquire_next_img();
         if (res == VK_SUBOPTIMAL_KHR || res == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -109,7 +171,9 @@ namespace aby::vk {
             std::tie(res, m_Img) = acquire_next_img();
         }
         if (res != VK_SUCCESS) {
+            std::lock_guard lock(m_Ctx->devices().queue_mutex());
             vkQueueWaitIdle(m_Ctx->devices().graphics().Queue);
+            m_FrameStarted = false;
             return;
         }
         render(m_Img);
@@ -124,10 +188,14 @@ namespace aby::vk {
         else if (res != VK_SUCCESS) {
             ABY_ERR("Failed to present swapchain image.");
         }
-
+        m_Frame        = static_cast<u32>((m_Frame + 1) % MAX_FRAMES_IN_FLIGHT);
+        m_FrameStarted = false;
     }
 
     void Renderer::render(u32 img) {
+        // Textures loaded until now (also those resolved by this frame's draws and ImGui) get their descriptors.
+        m_2D.module()->flush_texture_writes();
+
         VkCommandBuffer cmd = m_Frames[img].cmd_buffer;
         VkCommandBufferBeginInfo begin_info{
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
@@ -137,6 +205,10 @@ namespace aby::vk {
         };
         VK_CHECK(vkBeginCommandBuffer(cmd, &begin_info));
 
+        // Transfers are not allowed within dynamic rendering.
+        m_3D.upload_glyphs(cmd);
+        m_2D.upload_glyphs(cmd);
+
     // Before starting rendering, transition the swapchain image to COLOR_ATTACHMENT_OPTIMAL
         helper::transition_image_layout(
             cmd,
@@ -261,7 +333,14 @@ namespace aby::vk {
             .pSignalSemaphores = &m_Frames[img].release
         };
 
+        auto& frame_fence = m_FrameFences[m_Frame];
+        VK_CHECK(vkResetFences(m_Ctx->devices().logical(), 1, &frame_fence));
+
+        std::lock_guard lock(m_Ctx->devices().queue_mutex());
         VK_CHECK(vkQueueSubmit(m_Ctx->devices().graphics().Queue, 1, &info, m_Frames[img].queue_submit));
+        // An empty submission signals once everything submitted before it finished,
+        // this tracks the frame in flight independently of the swapchain image.
+        VK_CHECK(vkQueueSubmit(m_Ctx->devices().graphics().Queue, 0, nullptr, frame_fence));
     }
 
     void Renderer::on_event(Event& event) {
@@ -288,7 +367,10 @@ namespace aby::vk {
             return false;
         }
 
-        vkDeviceWaitIdle(m_Ctx->devices().logical());
+        {
+            std::lock_guard lock(m_Ctx->devices().queue_mutex());
+            vkDeviceWaitIdle(m_Ctx->devices().logical());
+        }
         
         recreate_swapchain();
         
@@ -355,6 +437,7 @@ namespace aby::vk {
         };
 
         // Present swapchain image
+        std::lock_guard lock(m_Ctx->devices().queue_mutex());
         return vkQueuePresentKHR(m_Ctx->devices().graphics().Queue, &present);
     }
 
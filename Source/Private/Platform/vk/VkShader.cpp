@@ -4,9 +4,18 @@
 #include "Platform/vk/VkTexture.h"
 #include "Core/Log.h"
 #include "Core/App.h"
+#include "Utility/AtomicFile.h"
+#include "Utility/Hash.h"
 #include "Utility/Inserter.h"
+#include <algorithm>
+#include <cctype>
 #include <set>
 #include <fstream>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <tuple>
 
 #include <shaderc/shaderc.hpp>
 #include <spirv_cross/spirv_cross.hpp>
@@ -28,97 +37,319 @@ namespace aby::vk::helper {
         }
     }
 
-    uint32_t get_stride(const spirv_cross::SPIRType& type) {
-        uint32_t scalarSize = 0;
+    /**
+    * @brief Packed vertex inputs are declared as the float vector they unpack to,
+    *        the name suffix picks the format: vec4 *_unorm8 (R8G8B8A8_UNORM), vec2 *_half (R16G16_SFLOAT).
+    */
+    VkFormat get_packed_format(const std::string& name, const spirv_cross::SPIRType& type) {
+        if (name.ends_with("_unorm8")) {
+            if (type.basetype != spirv_cross::SPIRType::Float || type.vecsize != 4) {
+                ABY_ERR("Packed input '{}' has to be a vec4", name);
+                return VK_FORMAT_UNDEFINED;
+            }
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        if (name.ends_with("_half")) {
+            if (type.basetype != spirv_cross::SPIRType::Float || type.vecsize != 2) {
+                ABY_ERR("Packed input '{}' has to be a vec2", name);
+                return VK_FORMAT_UNDEFINED;
+            }
+            return VK_FORMAT_R16G16_SFLOAT;
+        }
+        return VK_FORMAT_UNDEFINED;
+    }
+}
 
-        // Determine the size of a single scalar
-        switch (type.basetype) {
-            case spirv_cross::SPIRType::Float: scalarSize = 4; break; // 4 bytes for float
-            case spirv_cross::SPIRType::Int:   scalarSize = 4; break; // 4 bytes for int
-            case spirv_cross::SPIRType::UInt:  scalarSize = 4; break; // 4 bytes for uint
-            case spirv_cross::SPIRType::Double: scalarSize = 8; break; // 8 bytes for double
-            default:
-                ABY_ERR("Unsupported base type for stride calculation!");
-                return 0; // Error case
+// ShaderCompiler
+namespace aby::vk {
+
+    /**
+    * @brief Resolves #include "file" relative to the including file and #include <file> relative to the shader directory.
+    *        Every file opened is appended to sources.
+    */
+    class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+    public:
+        ShaderIncluder(const fs::path& root, std::vector<fs::path>& sources) :
+            m_Root(root),
+            m_Sources(sources)
+        {
         }
 
-        // Calculate stride for vector or matrix
-        uint32_t vectorSize = scalarSize * type.vecsize;       // Vector size = scalar * components
-        uint32_t stride = vectorSize;
+        shaderc_include_result* GetInclude(const char* requested, shaderc_include_type type, const char* requesting, std::size_t) override {
+            auto* include = new Include{};
+            fs::path dir  = type == shaderc_include_type_relative ? fs::path(requesting).parent_path() : m_Root;
+            fs::path path = dir / requested;
+            std::ifstream in(path, std::ios::binary);
+            if (in) {
+                std::stringstream ss;
+                ss << in.rdbuf();
+                include->name    = path.string();
+                include->content = ss.str();
+                m_Sources.push_back(path.lexically_normal());
+            }
+            else {
+                // An empty name tells shaderc the include failed, the content is the error message.
+                include->content = std::format("Cannot open {}", path.string());
+            }
+            include->result = shaderc_include_result{
+                .source_name        = include->name.data(),
+                .source_name_length = include->name.size(),
+                .content            = include->content.data(),
+                .content_length     = include->content.size(),
+                .user_data          = include,
+            };
+            return &include->result;
+        }
 
-        // If it's a matrix, account for columns (row-major or column-major padding may also apply)
-        if (type.columns > 1) {
-            stride *= type.columns; // Matrix stride = vector stride * columns
+        void ReleaseInclude(shaderc_include_result* result) override {
+            delete static_cast<Include*>(result->user_data);
         }
+    private:
+        struct Include {
+            std::string            name;
+            std::string            content;
+            shaderc_include_result result;
+        };
+        fs::path               m_Root;
+        std::vector<fs::path>& m_Sources;
+    };
 
-        return stride;
+    /**
+    * @brief Macros every shader is compiled with, part of the cache key.
+    *        Nothing device or build dependent, those values are specialization constants (see ESpecConstant).
+    */
+    static std::vector<std::pair<std::string, std::string>> shader_defines(const std::string& permutation) {
+        std::vector<std::pair<std::string, std::string>> defines{
+            { "GLSL_VERSION",             "450" },
+            { "BINDLESS_TEXTURE_BINDING", std::to_string(BINDLESS_TEXTURE_BINDING) },
+            { "MAX_TEXTURE_SLOTS_ID",     std::to_string(static_cast<u32>(ESpecConstant::MAX_TEXTURE_SLOTS)) },
+            { "DEBUG_ID",                 std::to_string(static_cast<u32>(ESpecConstant::DEBUG)) },
+            { "EXPAND_VEC4(vec)",         "vec.r, vec.g, vec.b, vec.a" },
+            { "EXPAND_VEC3(vec)",         "vec.x, vec.y, vec.z" },
+        };
+        std::string_view names(permutation);
+        while (!names.empty()) {
+            auto plus = names.find('+');
+            defines.emplace_back(std::string(names.substr(0, plus)), "1");
+            names = plus == std::string_view::npos ? std::string_view{} : names.substr(plus + 1);
+        }
+        return defines;
     }
-}
 
-// ShaderCompiler
-namespace aby::vk {
+    /**
+    * @brief Keys of the "#pragma permutation NAME..." lines of source, the pragma is ignored by the compiler.
+    */
+    static std::vector<std::string> declared_permutations(const std::string& source) {
+        std::vector<std::string> keys;
+        std::istringstream lines(source);
+        std::string        line;
+        while (std::getline(lines, line)) {
+            std::istringstream tokens(line);
+            std::string pragma, name, names;
+            if (!(tokens >> pragma >> name) || pragma != "#pragma" || name != "permutation") {
+                continue;
+            }
+            std::getline(tokens, names);
+            if (std::string key = ShaderCompiler::permutation_key(names); !key.empty() &&
+                std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(std::move(key));
+            }
+        }
+        return keys;
+    }
 
-    std::vector<u32> ShaderCompiler::compile(App* app, DeviceManager& devices, const fs::path& path, EShader type) {
-        auto cached = cache_dir(app, path);
-        if (fs::exists(cached)) {
-            std::vector<u32> out;
-            std::ifstream in(cached, std::ios::in | std::ios::binary);
-            in.seekg(0, std::ios::end);
-            auto size = in.tellg();
-            in.seekg(0, std::ios::beg);
-            out.resize(size / sizeof(uint32_t)); // + (size % sizeof(uint32_t) != 0 ? 1 : 0));
-            in.read(reinterpret_cast<char*>(out.data()), size);
-            return out;
+    /**
+    * @brief Everything the SPIR-V depends on besides the preprocessed source.
+    */
+    static void hash_environment(util::Hasher& hasher, EShader type, const std::vector<std::pair<std::string, std::string>>& defines) {
+        unsigned int spv_version = 0, spv_revision = 0;
+        shaderc_get_spv_version(&spv_version, &spv_revision);
+        hasher.update_value(ShaderCompiler::CACHE_VERSION)
+              .update_value(spv_version)
+              .update_value(spv_revision)
+              .update_value(static_cast<u32>(shaderc_env_version_vulkan_1_3))
+              .update_value(static_cast<u32>(shaderc_spirv_version_1_3))
+              .update_value(static_cast<u32>(shaderc_optimization_level_performance))
+              .update_value(type);
+        for (const auto& [name, value] : defines) {
+            hasher.update_string(name).update_string(value);
+        }
+    }
+
+    static std::optional<std::vector<std::byte>> read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!in) {
+            return std::nullopt;
+        }
+        std::vector<std::byte> bytes(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0, std::ios::beg);
+        in.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+        if (!in) {
+            return std::nullopt;
+        }
+        return bytes;
+    }
+
+    /**
+    * @brief Written atomically, a parallel compile of the same key never reads half a file.
+    */
+    static bool write_file(const fs::path& path, std::span<const std::byte> bytes) {
+        std::error_code ec = util::write_atomic(path, [bytes](std::ostream& out) {
+            out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        });
+        if (ec) {
+            ABY_ERR("Failed to write to file: {} ({})", path.string(), ec.message());
+            return false;
+        }
+        return true;
+    }
+
+    static std::mutex s_ManifestMutex;
+
+    /**
+    * @brief Cache/Shaders/manifest has one "<key> <source>[#permutation]" line per shader, the key it was last compiled to.
+    *        Entries (SPIR-V and reflection sidecar) no shader points at anymore are deleted when the manifest changes.
+    */
+    static void update_manifest(App* app, const std::string& name, const std::string& key) {
+        std::lock_guard lock(s_ManifestMutex);
+        const fs::path manifest = ShaderCompiler::cache_dir(app, "manifest");
+
+        std::vector<std::pair<std::string, std::string>> entries;
+        if (std::ifstream in(manifest); in) {
+            std::string line;
+            while (std::getline(in, line)) {
+                if (auto space = line.find(' '); space != std::string::npos) {
+                    entries.emplace_back(line.substr(0, space), line.substr(space + 1));
+                }
+            }
+        }
+
+        std::string stale;
+        auto it = std::find_if(entries.begin(), entries.end(), [&name](const auto& e) { return e.second == name; });
+        if (it == entries.end()) {
+            entries.emplace_back(key, name);
+        }
+        else if (it->first != key) {
+            stale = std::exchange(it->first, key);
+        }
+        if (!stale.empty() && std::none_of(entries.begin(), entries.end(), [&stale](const auto& e) { return e.first == stale; })) {
+            std::error_code ec;
+            fs::remove(ShaderCompiler::cache_dir(app, stale + ".spv"), ec);
+            fs::remove(ShaderCompiler::cache_dir(app, stale + ".refl"), ec);
+        }
+
+        std::ofstream out(manifest, std::ios::trunc);
+        for (const auto& [k, n] : entries) {
+            out << k << ' ' << n << '\n';
         }
+    }
+
+    std::string ShaderCompiler::permutation_key(std::string_view names) {
+        std::vector<std::string> sorted;
+        std::string              name;
+        for (char c : names) {
+            if (c == '+' || std::isspace(static_cast<unsigned char>(c))) {
+                if (!name.empty()) {
+                    sorted.push_back(std::exchange(name, {}));
+                }
+                continue;
+            }
+            name += c;
+        }
+        if (!name.empty()) {
+            sorted.push_back(std::move(name));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+        std::string key;
+        for (const auto& n : sorted) {
+            key += key.empty() ? n : "+" + n;
+        }
+        return key;
+    }
 
+    CompiledShader ShaderCompiler::compile(App* app, const fs::path& path, EShader type, const std::string& permutation) {
         if (type == EShader::FROM_EXT) {
             type = get_type_from_ext(path.extension());
         }
-        shaderc::Compiler compiler;
-        shaderc::CompileOptions options;
-        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
-        options.SetTargetSpirv(shaderc_spirv_version_1_3);
-        options.SetOptimizationLevel(shaderc_optimization_level_performance);
-        options.AddMacroDefinition("GLSL_VERSION", "450");
-        options.AddMacroDefinition("MAX_TEXTURE_SLOTS", std::to_string(devices.max_texture_slots()));
-        options.AddMacroDefinition("BINDLESS_TEXTURE_BINDING", std::to_string(BINDLESS_TEXTURE_BINDING));
-        options.AddMacroDefinition("EXPAND_VEC4(vec)", "vec.r, vec.g, vec.b, vec.a");
-        options.AddMacroDefinition("EXPAND_VEC3(vec)", "vec.x, vec.y, vec.z");
-    #ifdef NDEBUG
-        options.AddMacroDefinition("NDEBUG");
-    #endif
         std::ifstream ifs(path);
         if (!ifs.is_open()) {
-            ABY_ERR("Failed to open file: {}", path.string());
+            throw std::runtime_error(std::format("{}: Failed to open file", path.string()));
         }
         std::stringstream ss;
         ss << ifs.rdbuf();
         ifs.close();
         std::string source(ss.str());
 
-        auto module = compiler.CompileGlslToSpv(source, helper::get_shader_type(type), path.string().c_str(), options);
-        std::vector<u32> out(module.cbegin(), module.cend());
+        auto permutations = declared_permutations(source);
+        if (!permutation.empty() && std::find(permutations.begin(), permutations.end(), permutation) == permutations.end()) {
+            throw std::runtime_error(std::format("{}: Permutation '{}' is not declared", path.string(), permutation));
+        }
+
+        // Stages compile concurrently on the loader's workers, each worker keeps its own compiler.
+        thread_local shaderc::Compiler compiler;
+        shaderc::CompileOptions options;
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+        options.SetTargetSpirv(shaderc_spirv_version_1_3);
+        options.SetOptimizationLevel(shaderc_optimization_level_performance);
+        std::vector<fs::path> sources{ path };
+        options.SetIncluder(create_unique<ShaderIncluder>(path.parent_path(), sources));
+        auto defines = shader_defines(permutation);
+        for (const auto& [name, value] : defines) {
+            options.AddMacroDefinition(name, value);
+        }
 
-        if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
-            ABY_ERR("{}", module.GetErrorMessage());
-            return {};
-        }
-        std::ofstream ofs(cached, std::ios::out | std::ios::binary);
-        if (ofs.is_open()) {
-            ofs.write(reinterpret_cast<char*>(out.data()), out.size() * sizeof(u32));
-            if (!ofs) {
-                ABY_ERR("Failed to write to file: {}", cached.string());
-                return {};
+        // The cache is keyed by what the compiler actually sees: includes are resolved and macros expanded.
+        auto kind         = helper::get_shader_type(type);
+        auto preprocessed = compiler.PreprocessGlsl(source, kind, path.string().c_str(), options);
+        if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success) {
+            throw std::runtime_error(std::format("{}: {}", path.string(), preprocessed.GetErrorMessage()));
+        }
+        std::string expanded(preprocessed.cbegin(), preprocessed.cend());
+
+        util::Hasher hasher;
+        hash_environment(hasher, type, defines);
+        hasher.update_string(expanded);
+        const std::string key    = hasher.hex();
+        const fs::path    cached = cache_dir(app, key + ".spv");
+        const fs::path    sidecar = cache_dir(app, key + ".refl");
+
+        if (auto bytes = read_file(cached); bytes && !bytes->empty() && bytes->size() % sizeof(u32) == 0) {
+            CompiledShader out;
+            out.sources      = std::move(sources);
+            out.permutations = std::move(permutations);
+            out.spirv.resize(bytes->size() / sizeof(u32));
+            std::memcpy(out.spirv.data(), bytes->data(), bytes->size());
+            // SPIRV-Cross only runs if the sidecar is missing or from an older reflection version.
+            auto reflected = read_file(sidecar);
+            auto descriptor = reflected ? ShaderDescriptor::deserialize(*reflected) : std::nullopt;
+            if (descriptor) {
+                out.descriptor = std::move(*descriptor);
+                return out;
             }
-            ofs.flush();
-            ofs.close();
+            out.descriptor = reflect(out.spirv);
+            write_file(sidecar, out.descriptor.serialize());
+            return out;
         }
-        else {
-            ABY_ERR("Failed to open file: {}", cached.string());
-            return {};
+
+        auto module = compiler.CompileGlslToSpv(expanded, kind, path.string().c_str(), options);
+        if (module.GetCompilationStatus() != shaderc_compilation_status_success) {
+            throw std::runtime_error(std::format("{}: {}", path.string(), module.GetErrorMessage()));
+        }
+        CompiledShader out;
+        out.sources      = std::move(sources);
+        out.permutations = std::move(permutations);
+        out.spirv.assign(module.cbegin(), module.cend());
+        out.descriptor = reflect(out.spirv);
+
+        // The sidecar goes first, a blob without one is reflected again rather than trusted.
+        if (write_file(sidecar, out.descriptor.serialize()) && write_file(cached, std::as_bytes(std::span(out.spirv)))) {
+            std::string name = path.lexically_normal().generic_string();
+            update_manifest(app, permutation.empty() ? name : name + "#" + permutation, key);
         }
 
-        ABY_DBG("Compiled glsl shader: {}", path.string());
+        ABY_DBG("Compiled glsl shader: {}{}{} ({})", path.string(), permutation.empty() ? "" : "#", permutation, key);
         return out;
     }
 
@@ -161,6 +392,11 @@ namespace aby::vk {
             }
         }
 
+        // Push constants, at most one block per stage
+        for (const auto& block : resources.push_constant_buffers) {
+            descriptor.push_constants = static_cast<u32>(compiler.get_declared_struct_size(compiler.get_type(block.base_type_id)));
+        }
+
         // Storage buffers
         for (const auto& storage : resources.storage_buffers) {
             descriptor.storages.push_back({
@@ -181,50 +417,60 @@ namespace aby::vk {
             });
         }
 
+        // Offsets are handed out in location order, the order of the members of the CPU side structs.
+        auto stage_inputs = resources.stage_inputs;
+        std::sort(stage_inputs.begin(), stage_inputs.end(), [&compiler](const auto& a, const auto& b) {
+            return compiler.get_decoration(a.id, spv::DecorationLocation) < compiler.get_decoration(b.id, spv::DecorationLocation);
+        });
+
         uint32_t global_offset = 0;
-        for (const auto& input : resources.stage_inputs) {
+        for (const auto& input : stage_inputs) {
             auto     type     = compiler.get_type(input.base_type_id);
             uint32_t location = compiler.get_decoration(input.id, spv::DecorationLocation);
             uint32_t binding  = compiler.get_decoration(input.id, spv::DecorationBinding);
-            uint32_t stride   = helper::get_stride(type);
-            uint32_t offset   = global_offset;
-            global_offset += stride;
 
-            VkFormat format = VK_FORMAT_UNDEFINED;
-            if (type.basetype == spirv_cross::SPIRType::Float) {
-                switch (type.vecsize) {
-                    case 1: format = VK_FORMAT_R32_SFLOAT; break;
-                    case 2: format = VK_FORMAT_R32G32_SFLOAT; break;
-                    case 3: format = VK_FORMAT_R32G32B32_SFLOAT; break;
-                    case 4: format = VK_FORMAT_R32G32B32A32_SFLOAT; break;
-                    default:
-                        std::unreachable();
+            VkFormat format = helper::get_packed_format(input.name, type);
+            if (format == VK_FORMAT_UNDEFINED) {
+                if (type.basetype == spirv_cross::SPIRType::Float) {
+                    switch (type.vecsize) {
+                        case 1: format = VK_FORMAT_R32_SFLOAT; break;
+                        case 2: format = VK_FORMAT_R32G32_SFLOAT; break;
+                        case 3: format = VK_FORMAT_R32G32B32_SFLOAT; break;
+                        case 4: format = VK_FORMAT_R32G32B32A32_SFLOAT; break;
+                        default:
+                            std::unreachable();
+                    }
                 }
-            }
-            else if (type.basetype == spirv_cross::SPIRType::Int) {
-                switch (type.vecsize) {
-                    case 1: format = VK_FORMAT_R32_SINT; break;
-                    case 2: format = VK_FORMAT_R32G32_SINT; break;
-                    case 3: format = VK_FORMAT_R32G32B32_SINT; break;
-                    case 4: format = VK_FORMAT_R32G32B32A32_SINT; break;
-                    default:
-                        std::unreachable();
+                else if (type.basetype == spirv_cross::SPIRType::Int) {
+                    switch (type.vecsize) {
+                        case 1: format = VK_FORMAT_R32_SINT; break;
+                        case 2: format = VK_FORMAT_R32G32_SINT; break;
+                        case 3: format = VK_FORMAT_R32G32B32_SINT; break;
+                        case 4: format = VK_FORMAT_R32G32B32A32_SINT; break;
+                        default:
+                            std::unreachable();
+                    }
                 }
-            }
-            else if (type.basetype == spirv_cross::SPIRType::UInt) {
-                switch (type.vecsize) {
-                    case 1: format = VK_FORMAT_R32_UINT; break;
-                    case 2: format = VK_FORMAT_R32G32_UINT; break;
-                    case 3: format = VK_FORMAT_R32G32B32_UINT; break;
-                    case 4: format = VK_FORMAT_R32G32B32A32_UINT; break;
-                    default:
-                        std::unreachable();
+                else if (type.basetype == spirv_cross::SPIRType::UInt) {
+                    switch (type.vecsize) {
+                        case 1: format = VK_FORMAT_R32_UINT; break;
+                        case 2: format = VK_FORMAT_R32G32_UINT; break;
+                        case 3: format = VK_FORMAT_R32G32B32_UINT; break;
+                        case 4: format = VK_FORMAT_R32G32B32A32_UINT; break;
+                        default:
+                            std::unreachable();
+                    }
+                } 
+                else {
+                    ABY_ERR("Unsupported shader input type!");
                 }
-            } 
-            else {
-                ABY_ERR("Unsupported shader input type!");
             }
 
+            // Tightly packed, the stride is the size of the format and not of the shader side type.
+            uint32_t stride = static_cast<uint32_t>(ShaderDescriptor::format_size(format));
+            uint32_t offset = global_offset;
+            global_offset += stride;
+
             descriptor.inputs.emplace_back(location, binding, offset, stride, format);
         }
         return descriptor;
@@ -263,108 +509,170 @@ namespace aby::vk {
             VK_CHECK(vkCreateDescriptorSetLayout(logical, &info, vk::Allocator::get(), &m_ImGuiLayout));
         }
 
+        /**
+        * @brief Runs inside ResourceClass::add on the loading thread, the descriptors are only queued,
+        *        ShaderModule::flush_texture_writes writes them with the rest of the frame's textures.
+        */
         void on_add(Handle handle, Ref<aby::Texture> texture) override {
             auto  tex = std::static_pointer_cast<vk::Texture>(texture);
             auto* shader_module = std::any_cast<ShaderModule*>(m_UserData);
             auto logical = shader_module->m_Ctx->devices().logical();
 
-            VkDescriptorImageInfo img_info{
-               .sampler = tex->sampler(),
-               .imageView = tex->view(),
-               .imageLayout = tex->layout(),
-            };
-
-            // Write to bindless texture array.
-            {
-                VkWriteDescriptorSet write{
-                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                    .pNext = nullptr,
-                    .dstSet = shader_module->m_Descriptors[1],
-                    .dstBinding = BINDLESS_TEXTURE_BINDING,
-                    .dstArrayElement = handle,
-                    .descriptorCount = 1,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .pImageInfo = &img_info,
-                    .pBufferInfo = nullptr,
-                    .pTexelBufferView = nullptr,
-                };
-                vkUpdateDescriptorSets(logical, 1, &write, 0, nullptr);
-            }
-            // Write to vk::Texture::m_ImGuiID
-            {
-                VkDescriptorSetAllocateInfo alloc_info;
-                alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-                alloc_info.pNext = nullptr;
-                alloc_info.descriptorSetCount = 1;
-                alloc_info.descriptorPool = shader_module->pool();
-                alloc_info.pSetLayouts = &m_ImGuiLayout;
-                vkAllocateDescriptorSets(logical, &alloc_info, &tex->imgui_descriptor());
-                
-                VkWriteDescriptorSet write{};
-                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                write.dstSet = tex->imgui_descriptor();
-                write.descriptorCount = 1;
-                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                write.pImageInfo = &img_info;
-                vkUpdateDescriptorSets(logical, 1, &write, 0, nullptr);
-            }
+            std::lock_guard lock(shader_module->m_TextureMutex);
+            // The set handle is the ImGui texture id, it exists as soon as the texture is visible.
+            VkDescriptorSetAllocateInfo alloc_info;
+            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            alloc_info.pNext = nullptr;
+            alloc_info.descriptorSetCount = 1;
+            alloc_info.descriptorPool = shader_module->pool();
+            alloc_info.pSetLayouts = &m_ImGuiLayout;
+            VK_CHECK(vkAllocateDescriptorSets(logical, &alloc_info, &tex->imgui_descriptor()));
+
+            shader_module->m_TextureWrites.push_back(ShaderModule::TextureWrite{
+                .handle = handle,
+                .image  = VkDescriptorImageInfo{
+                    .sampler = tex->sampler(),
+                    .imageView = tex->view(),
+                    .imageLayout = tex->layout(),
+                },
+                .imgui  = tex->imgui_descriptor(),
+            });
         }
-        void on_erase(Handle handle, Ref<aby::Texture> texture) override {
 
+        /**
+        * @brief Frames in flight may still draw with the texture, it is kept alive (and its handle held back)
+        *        until ShaderModule::flush_texture_writes releases it. The bindless slot is left as is (partially bound),
+        *        the next texture given the handle overwrites it.
+        */
+        bool on_erase(Handle handle, Ref<aby::Texture> texture) override {
+            auto  tex = std::static_pointer_cast<vk::Texture>(texture);
+            auto* shader_module = std::any_cast<ShaderModule*>(m_UserData);
+
+            std::lock_guard lock(shader_module->m_TextureMutex);
+            auto& writes = shader_module->m_TextureWrites;
+            std::erase_if(writes, [handle](const ShaderModule::TextureWrite& write) { return write.handle == handle; });
+            // The frame whose draws resolved the texture before it was erased is recorded at the next flush,
+            // the texture is unused once that frame retired, MAX_FRAMES_IN_FLIGHT flushes after it.
+            shader_module->m_TextureReleases.push_back(ShaderModule::TextureRelease{
+                .texture = tex,
+                .handle  = handle,
+                .imgui   = std::exchange(tex->imgui_descriptor(), VK_NULL_HANDLE),
+                .frames  = MAX_FRAMES_IN_FLIGHT + 1,
+            });
+            return true;
         }
     private:
         VkDescriptorSetLayout m_ImGuiLayout;
     };
 
+    /**
+    * @brief A permutation shares the pipeline layout and the vertex input state of its default,
+    *        the inputs of a fragment stage are free to differ (e.g. one it does not read).
+    */
+    static bool same_layout(ShaderDescriptor a, ShaderDescriptor b, EShader type) {
+        if (type == EShader::FRAGMENT) {
+            a.inputs.clear();
+            b.inputs.clear();
+        }
+        return a.serialize() == b.serialize();
+    }
+
     Shader::Shader(App* app, DeviceManager& devices, const fs::path& path, EShader type) :
-        aby::Shader(
-            ShaderCompiler::compile(app, devices, path, type),
-            type == EShader::FROM_EXT ? ShaderCompiler::get_type_from_ext(path.extension()) : type
-        ),
+        Shader(devices, path, type == EShader::FROM_EXT ? ShaderCompiler::get_type_from_ext(path.extension()) : type,
+            ShaderCompiler::compile(app, path, type))
+    {
+        // Every declared permutation is compiled (or read from the cache) up front, pipelines pick one by key.
+        try {
+            for (const auto& key : m_PermutationKeys) {
+                CompiledShader variant = ShaderCompiler::compile(app, path, m_Type, key);
+                if (!same_layout(variant.descriptor, m_Descriptor, m_Type)) {
+                    throw std::runtime_error(std::format("{}: Permutation '{}' changes the descriptors", path.string(), key));
+                }
+                for (auto& source : variant.sources) {
+                    if (std::find(m_Sources.begin(), m_Sources.end(), source) == m_Sources.end()) {
+                        m_Sources.push_back(std::move(source));
+                    }
+                }
+                m_Permutations.emplace(key, create_module(variant.spirv));
+            }
+        }
+        catch (...) {
+            destroy();
+            throw;
+        }
+    }
+
+    Shader::Shader(DeviceManager& devices, const fs::path& path, EShader type, CompiledShader&& compiled) :
+        aby::Shader(std::move(compiled.spirv), type),
         m_Logical(devices.logical()),
         m_Module(VK_NULL_HANDLE),
         m_Layout(VK_NULL_HANDLE),
-        m_Descriptor(ShaderCompiler::reflect(m_Data)) 
+        m_Descriptor(std::move(compiled.descriptor)),
+        m_Sources(std::move(compiled.sources)),
+        m_PermutationKeys(std::move(compiled.permutations)),
+        m_Permutations(),
+        m_SpecEntries{},
+        m_SpecData{},
+        m_Specialization{}
     {
         Timer timer;
-        // Create shader module
-        VkShaderModuleCreateInfo smci = {
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .codeSize = m_Data.size() * sizeof(u32),
-            .pCode = m_Data.data(),
+        m_Module = create_module(m_Data);
+
+        // Same count the bindless binding is declared and allocated with.
+        m_SpecData[static_cast<u32>(ESpecConstant::MAX_TEXTURE_SLOTS)] = devices.max_texture_slots();
+    #ifdef NDEBUG
+        m_SpecData[static_cast<u32>(ESpecConstant::DEBUG)] = VK_FALSE;
+    #else
+        m_SpecData[static_cast<u32>(ESpecConstant::DEBUG)] = VK_TRUE;
+    #endif
+        for (u32 id = 0; id < m_SpecEntries.size(); id++) {
+            m_SpecEntries[id] = VkSpecializationMapEntry{
+                .constantID = id,
+                .offset     = static_cast<u32>(id * sizeof(u32)),
+                .size       = sizeof(u32),
+            };
+        }
+        // Ids the stage does not declare are ignored by the driver.
+        m_Specialization = VkSpecializationInfo{
+            .mapEntryCount = static_cast<u32>(m_SpecEntries.size()),
+            .pMapEntries   = m_SpecEntries.data(),
+            .dataSize      = sizeof(m_SpecData),
+            .pData         = m_SpecData.data(),
         };
-        VK_CHECK(vkCreateShaderModule(m_Logical, &smci, IAllocator::get(), &m_Module));
 
         std::vector<VkDescriptorSetLayoutBinding> bindings;
         std::vector<VkDescriptorBindingFlags> flags;
 
-        VkShaderStageFlags stageFlag = (m_Type == EShader::VERTEX) ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        // Process uniform buffers
-        for (const auto& uniform : m_Descriptor.uniforms) {
+        // The vertex stage layout (set 0) holds the dynamic uniform buffers, the fragment stage layout (set 1) the
+        // bindless array. Only the latter is update after bind, dynamic buffers are not allowed in such a layout.
+        VkDescriptorSetLayoutCreateFlags layout_flags = 0;
+        if (m_Type == EShader::VERTEX) {
+            for (const auto& [uniform_binding, size] : m_Descriptor.uniform_binding_sizes()) {
+                VkDescriptorSetLayoutBinding binding{};
+                binding.binding = static_cast<u32>(uniform_binding);
+                binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Frame slice of the uniform ring, see ShaderModule::set_uniforms
+                binding.descriptorCount = 1;
+                binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+                binding.pImmutableSamplers = nullptr;
+                bindings.push_back(binding);
+                flags.push_back(0); // Written once
+            }
+        }
+        else {
             VkDescriptorSetLayoutBinding binding{};
-            binding.binding = uniform.binding;
-            binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            binding.descriptorCount = 1;
-            binding.stageFlags = stageFlag;
+            binding.binding = BINDLESS_TEXTURE_BINDING;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            binding.descriptorCount = devices.max_texture_slots();
+            binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
             binding.pImmutableSamplers = nullptr;
             bindings.push_back(binding);
-            flags.push_back(VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT);
-        }
-        VkDescriptorSetLayoutBinding binding{};
-        binding.binding = BINDLESS_TEXTURE_BINDING;
-        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        binding.descriptorCount = MAX_BINDLESS_RESOURCES;
-        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        binding.pImmutableSamplers = nullptr;
-        bindings.push_back(binding);
-        flags.push_back(
-            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
-            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT |
-            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
-        );
+            flags.push_back(
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT |
+                VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+            );
+            layout_flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
 
         // Descriptor binding flags
         VkDescriptorSetLayoutBindingFlagsCreateInfo bfci{
@@ -378,7 +686,7 @@ namespace aby::vk {
         VkDescriptorSetLayoutCreateInfo layoutInfo{
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
             .pNext = &bfci,
-            .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+            .flags = layout_flags,
             .bindingCount = static_cast<uint32_t>(bindings.size()),
             .pBindings = bindings.data()
         };
@@ -403,8 +711,43 @@ namespace aby::vk {
     }
 
     void Shader::destroy() {
-        vkDestroyShaderModule(m_Logical, m_Module, IAllocator::get());
-        vkDestroyDescriptorSetLayout(m_Logical, m_Layout, IAllocator::get());
+        destroy_module();
+        if (m_Layout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(m_Logical, m_Layout, IAllocator::get());
+            m_Layout = VK_NULL_HANDLE;
+        }
+    }
+
+    void Shader::destroy_module() {
+        if (m_Module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(m_Logical, m_Module, IAllocator::get());
+            m_Module = VK_NULL_HANDLE;
+        }
+        for (auto& [key, module] : m_Permutations) {
+            vkDestroyShaderModule(m_Logical, module, IAllocator::get());
+        }
+        m_Permutations.clear();
+    }
+
+    VkShaderModule Shader::create_module(std::span<const u32> spirv) const {
+        VkShaderModuleCreateInfo smci = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .codeSize = spirv.size() * sizeof(u32),
+            .pCode = spirv.data(),
+        };
+        VkShaderModule module = VK_NULL_HANDLE;
+        VK_CHECK(vkCreateShaderModule(m_Logical, &smci, IAllocator::get(), &module));
+        return module;
+    }
+
+    bool Shader::has_permutation(const std::string& permutation) const {
+        return permutation.empty() || m_Permutations.contains(permutation);
+    }
+
+    const std::vector<fs::path>& Shader::sources() const {
+        return m_Sources;
     }
 
     const ShaderDescriptor& Shader::descriptor() const {
@@ -415,7 +758,7 @@ namespace aby::vk {
         return m_Layout;
     }
     
-    VkPipelineShaderStageCreateInfo Shader::stage() const {
+    VkPipelineShaderStageCreateInfo Shader::stage(const std::string& permutation) const {
         VkShaderStageFlagBits stage_flags;
         switch (m_Type) {
             case EShader::VERTEX:
@@ -427,14 +770,16 @@ namespace aby::vk {
             default:
                 throw std::out_of_range("EShader");
         }
+        // Stages that do not declare the permutation use their default module.
+        auto variant = m_Permutations.find(permutation);
         VkPipelineShaderStageCreateInfo ci = {
            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
            .pNext = nullptr,
            .flags = 0,
            .stage = stage_flags,
-           .module = m_Module,
+           .module = variant != m_Permutations.end() ? variant->second : m_Module,
            .pName = "main",  // Entry point name
-           .pSpecializationInfo = nullptr,
+           .pSpecializationInfo = &m_Specialization,
         };
         return ci;
     }
@@ -449,20 +794,61 @@ namespace aby::vk {
 // ShaderModule
 namespace aby::vk {
 
-    ShaderModule::ShaderModule(vk::Context* ctx, const fs::path& vertex, const fs::path& frag) :
+    /**
+    * @brief The module depends on every stage, they are compiled in parallel on the job system.
+    *        All stages are awaited before failing so each broken file reports its own error.
+    */
+    static const ShaderDescriptor& await_stages(vk::Context* ctx, std::initializer_list<std::pair<Resource, const fs::path*>> stages) {
+        auto& loader = ctx->loader();
+        std::string failed;
+        for (const auto& [stage, path] : stages) {
+            if (stage && loader.wait(stage) == EResourceState::FAILED) {
+                failed += std::format("{}{}", failed.empty() ? "" : ", ", path->string());
+            }
+        }
+        if (!failed.empty()) {
+            throw std::runtime_error(std::format("ShaderModule: Failed to load shader stage(s) {}", failed));
+        }
+        return std::static_pointer_cast<vk::Shader>(ctx->shaders().at(stages.begin()->first))->descriptor();
+    }
+
+    ShaderModule::ShaderModule(vk::Context* ctx, const fs::path& vertex, const fs::path& frag, const fs::path& instance) :
         m_Ctx(ctx),
         m_Layout(VK_NULL_HANDLE),
         m_Vertex(aby::Shader::create(ctx, vertex, EShader::VERTEX)),
         m_Fragment(aby::Shader::create(ctx, frag, EShader::FRAGMENT)),
+        m_Instance(instance.empty() ? Resource{} : aby::Shader::create(ctx, instance, EShader::VERTEX)),
         m_Pool(VK_NULL_HANDLE),
         m_Descriptors(),
         m_Uniforms(VK_NULL_HANDLE),
-        m_UniformMemory(VK_NULL_HANDLE),
-        m_Class(std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex))->descriptor(), 10000, 0)
+        m_UniformMemory{},
+        m_UniformBindings(),
+        m_UniformSizes(),
+        m_UniformOffsets(),
+        m_Ring(),
+        m_PushConstants{},
+        m_TextureMutex(),
+        m_TextureWrites(),
+        m_TextureReleases(),
+        m_Replaced{},
+        m_Class(await_stages(ctx, { { m_Vertex, &vertex }, { m_Fragment, &frag }, { m_Instance, &instance } }), 10000, 0)
     {
         m_Ctx->textures().add_handler(create_unique<TextureResourceHandler>(this));
         auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex));
         auto frag_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Fragment));
+        if (m_Instance) {
+            ABY_ASSERT(instance_descriptor().uniform_binding_sizes() == vert_shader->descriptor().uniform_binding_sizes(),
+                "ShaderModule: The instance stage must declare the same uniforms as the vertex stage");
+        }
+        ABY_ASSERT(frag_shader->descriptor().uniforms.empty(), "ShaderModule: Uniforms are set through the vertex stage");
+
+        const u32 vertex_push = std::max(vert_shader->descriptor().push_constants, m_Instance ? instance_descriptor().push_constants : 0u);
+        const u32 frag_push   = frag_shader->descriptor().push_constants;
+        m_PushConstants = VkPushConstantRange{
+            .stageFlags = (vertex_push ? VK_SHADER_STAGE_VERTEX_BIT : 0u) | (frag_push ? VK_SHADER_STAGE_FRAGMENT_BIT : 0u),
+            .offset     = 0,
+            .size       = std::max(vertex_push, frag_push),
+        };
 
         std::vector<VkDescriptorSetLayout> descriptor_set_layouts{
            vert_shader->layout(),
@@ -475,20 +861,22 @@ namespace aby::vk {
             .flags = 0,
             .setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size()),
             .pSetLayouts = descriptor_set_layouts.data(),
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges    = nullptr,
+            .pushConstantRangeCount = m_PushConstants.size ? 1u : 0u,
+            .pPushConstantRanges    = m_PushConstants.size ? &m_PushConstants : nullptr,
         };
 
+        auto uniform_bindings = vert_shader->descriptor().uniform_binding_sizes();
+        // The bindless array plus one ImGui set (a single sampler) per texture.
         std::vector<VkDescriptorPoolSize> pool_sizes = {
-           { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1 }, // Adjust counts based on needs
-           { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_BINDLESS_RESOURCES }
+           { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, std::max<u32>(1, static_cast<u32>(uniform_bindings.size())) },
+           { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * MAX_BINDLESS_RESOURCES }
         };
 
         VkDescriptorPoolCreateInfo ci{
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
             .pNext = nullptr,
             .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT | VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
-            .maxSets = 20,
+            .maxSets = static_cast<u32>(descriptor_set_layouts.size()) + MAX_BINDLESS_RESOURCES,
             .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
             .pPoolSizes = pool_sizes.data(),
         };
@@ -499,9 +887,9 @@ namespace aby::vk {
         
         auto descriptor_set_count = static_cast<u32>(descriptor_set_layouts.size());
 
+        // Only set 1 has a variable count binding, the bindless array.
         VkDescriptorSetVariableDescriptorCountAllocateInfoEXT alloc_count_info{};
-        auto max_binding = MAX_BINDLESS_RESOURCES - 1;
-        std::vector<u32> max_bindings(descriptor_set_count, max_binding);
+        std::vector<u32> max_bindings{ 0, m_Ctx->devices().max_texture_slots() };
         alloc_count_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
         alloc_count_info.pNext = nullptr;
         alloc_count_info.descriptorSetCount = static_cast<u32>(max_bindings.size());
@@ -520,48 +908,68 @@ namespace aby::vk {
         
         VK_CHECK(vkCreatePipelineLayout(logical, &pipelineLayoutInfo, IAllocator::get(), &m_Layout));
     
-        if (vert_shader->descriptor().uniforms.empty()) {
-            create_uniform_buffer(0);
-            update_descriptor_set(0, 0);
+        for (const auto& [binding, size] : uniform_bindings) {
+            m_UniformBindings.push_back(static_cast<u32>(binding));
+            m_UniformSizes.push_back(size);
+        }
+        m_UniformOffsets.assign(m_UniformBindings.size(), 0);
+        if (!m_UniformBindings.empty()) {
+            create_uniform_ring();
         }
     }
 
 
-    Ref<ShaderModule> ShaderModule::create(vk::Context* ctx, const fs::path& vert, const fs::path& frag) {
-        return create_ref<ShaderModule>(ctx, vert, frag);
+    Ref<ShaderModule> ShaderModule::create(vk::Context* ctx, const fs::path& vert, const fs::path& frag, const fs::path& instance) {
+        return create_ref<ShaderModule>(ctx, vert, frag, instance);
     }
 
-    void ShaderModule::create_uniform_buffer(std::size_t size) {
-        if (size == 0) {
-            size = 16;
-        }
+    void ShaderModule::create_uniform_ring() {
+        m_Ring = UniformRing(m_UniformSizes, m_Ctx->devices().min_uniform_alignment(), UNIFORM_WRITES_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
 
         auto logical = m_Ctx->devices().logical();
-        auto physical = m_Ctx->devices().physical();
 
         VkBufferCreateInfo buffer_info = {};
         buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        buffer_info.size = size;
+        buffer_info.size = m_Ring.size();
         buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
         buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
         VK_CHECK(vkCreateBuffer(logical, &buffer_info, IAllocator::get(), &m_Uniforms));
 
-        VkMemoryRequirements mem_requirements;
-        vkGetBufferMemoryRequirements(logical, m_Uniforms, &mem_requirements);
-
-        VkMemoryAllocateInfo alloc_info = {};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = mem_requirements.size;
-        alloc_info.memoryTypeIndex = helper::find_mem_type(mem_requirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, physical);
-
-        VK_CHECK(vkAllocateMemory(logical, &alloc_info, IAllocator::get(), &m_UniformMemory));
-        VK_CHECK(vkBindBufferMemory(logical, m_Uniforms, m_UniformMemory, 0));
+        // Host coherent and mapped for the lifetime of the module, a write is a memcpy.
+        m_UniformMemory = m_Ctx->devices().memory().bind(m_Uniforms, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // The descriptors never change, only the dynamic offsets passed when binding them.
+        std::vector<VkDescriptorBufferInfo> buffer_infos;
+        std::vector<VkWriteDescriptorSet>   writes;
+        buffer_infos.reserve(m_UniformBindings.size());
+        for (std::size_t i = 0; i < m_UniformBindings.size(); i++) {
+            buffer_infos.push_back(VkDescriptorBufferInfo{
+                .buffer = m_Uniforms,
+                .offset = 0,
+                .range  = m_UniformSizes[i],
+            });
+            writes.push_back(VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_Descriptors[0],
+                .dstBinding = m_UniformBindings[i],
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .pImageInfo = nullptr,
+                .pBufferInfo = &buffer_infos.back(),
+                .pTexelBufferView = nullptr
+            });
+        }
+        vkUpdateDescriptorSets(logical, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
     }
 
     void ShaderModule::destroy() {
+        // Every pipeline built from the module destroys it, only the first call does anything.
+        if (m_Pool == VK_NULL_HANDLE) {
+            return;
+        }
         auto logical = m_Ctx->devices().logical();
 
         if (m_Uniforms != VK_NULL_HANDLE) {
@@ -569,12 +977,12 @@ namespace aby::vk {
             m_Uniforms = VK_NULL_HANDLE;
         }
 
-        if (m_UniformMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(logical, m_UniformMemory, IAllocator::get());
-            m_UniformMemory = VK_NULL_HANDLE;
+        if (m_UniformMemory) {
+            m_Ctx->devices().memory().free(m_UniformMemory);
         }
         if (m_Layout != VK_NULL_HANDLE) {
             vkDestroyPipelineLayout(logical, m_Layout, IAllocator::get());
+            m_Layout = VK_NULL_HANDLE;
         }
 
         if (!m_Descriptors.empty()) {
@@ -583,66 +991,120 @@ namespace aby::vk {
             }
             m_Descriptors.clear();
         }
-        if (m_Pool != VK_NULL_HANDLE) {
-            vkDestroyDescriptorPool(logical, m_Pool, IAllocator::get());
+        vkDestroyDescriptorPool(logical, m_Pool, IAllocator::get());
+        m_Pool = VK_NULL_HANDLE;
+        std::vector<TextureRelease> releases;
+        {
+            // Freed with the pool.
+            std::lock_guard lock(m_TextureMutex);
+            m_TextureWrites.clear();
+            releases.swap(m_TextureReleases);
+        }
+        for (const auto& release : releases) {
+            m_Ctx->textures().release(release.handle);
         }
 
         auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex));
         auto frag_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Fragment));
         vert_shader->destroy();
         frag_shader->destroy();
+        if (m_Instance) {
+            std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Instance))->destroy();
+        }
+        // The descriptor sets were allocated with the layouts of the first stages, they live until now.
+        for (Resource stage : { m_Replaced.vertex, m_Replaced.fragment, m_Replaced.instance }) {
+            if (stage) {
+                std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(stage))->destroy();
+            }
+        }
+        m_Replaced = {};
     }
 
-    void ShaderModule::set_uniforms(const void* data, std::size_t bytes, u32 binding) {
-        std::size_t expected_size = 0;
-        auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex));
-        for (auto& uniform : vert_shader->descriptor().uniforms) {
-
-            expected_size += uniform.size;
+    void ShaderModule::flush_texture_writes() {
+        auto logical = m_Ctx->devices().logical();
+        std::vector<TextureWrite> pending;
+        std::vector<TextureRelease> expired;
+        {
+            std::lock_guard lock(m_TextureMutex);
+            pending.swap(m_TextureWrites);
+            for (auto it = m_TextureReleases.begin(); it != m_TextureReleases.end();) {
+                if (--it->frames > 0) {
+                    ++it;
+                    continue;
+                }
+                if (it->imgui != VK_NULL_HANDLE) {
+                    vkFreeDescriptorSets(logical, m_Pool, 1, &it->imgui);
+                }
+                expired.push_back(std::move(*it));
+                it = m_TextureReleases.erase(it);
+            }
+        }
+        // Outside the lock, ResourceClass::erase calls on_erase with its own lock held.
+        for (const auto& release : expired) {
+            m_Ctx->textures().release(release.handle);
+        }
+        expired.clear(); // Last reference, destroys the textures
+        if (pending.empty()) {
+            return;
         }
-        ABY_ASSERT(bytes == expected_size, "Expected size {}, but got {}", expected_size, bytes);
 
-        if (m_Uniforms == VK_NULL_HANDLE || m_UniformMemory == VK_NULL_HANDLE) {
-            create_uniform_buffer(bytes);
+        // Update after bind: the sets may be bound by frames in flight, none of them uses the new elements.
+        std::vector<VkWriteDescriptorSet> writes;
+        writes.reserve(pending.size() * 2);
+        for (const auto& texture : pending) {
+            writes.push_back(VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = m_Descriptors[1],
+                .dstBinding = BINDLESS_TEXTURE_BINDING,
+                .dstArrayElement = texture.handle,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &texture.image,
+                .pBufferInfo = nullptr,
+                .pTexelBufferView = nullptr,
+            });
+            writes.push_back(VkWriteDescriptorSet{
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .pNext = nullptr,
+                .dstSet = texture.imgui,
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &texture.image,
+                .pBufferInfo = nullptr,
+                .pTexelBufferView = nullptr,
+            });
         }
-        
-        update_uniform_memory(data, bytes);
-        update_descriptor_set(binding, bytes);
+        vkUpdateDescriptorSets(logical, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
     }
 
-    void ShaderModule::update_uniform_memory(const void* data, std::size_t bytes) {
-        auto logical = m_Ctx->devices().logical();
-        void* mapped;
-        vkMapMemory(logical, m_UniformMemory, 0, bytes, 0, &mapped);
-        memcpy(mapped, data, bytes);
-        vkUnmapMemory(logical, m_UniformMemory);
+    void ShaderModule::begin_frame(u32 frame) {
+        m_Ring.begin_frame(frame);
     }
 
-    void ShaderModule::update_descriptor_set(u32 binding, std::size_t bytes) {
-        auto logical = m_Ctx->devices().logical();
-        std::vector<VkWriteDescriptorSet> writes;
-        if (bytes == 0) {
-            return;
+    void ShaderModule::set_uniforms(const void* data, std::size_t bytes, u32 binding) {
+        auto it = std::find(m_UniformBindings.begin(), m_UniformBindings.end(), binding);
+        ABY_ASSERT(it != m_UniformBindings.end(), "The vertex stage has no uniform binding {}", binding);
+        const auto index = static_cast<std::size_t>(it - m_UniformBindings.begin());
+        ABY_ASSERT(bytes == m_UniformSizes[index], "Expected size {}, but got {}", m_UniformSizes[index], bytes);
+
+        if (!m_Ring.fits(bytes)) {
+            // Only happens past UNIFORM_WRITES_PER_FRAME, reusing the slice overwrites blocks of this frame.
+            IF_DBG(ABY_WARN("ShaderModule: More than {} uniform writes this frame", UNIFORM_WRITES_PER_FRAME), ;);
         }
-        VkDescriptorBufferInfo buffer_info{
-            .buffer = m_Uniforms,
-            .offset = 0,
-            .range = bytes,
-        };
-        VkWriteDescriptorSet write_uniforms{
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .pNext = nullptr,
-            .dstSet = m_Descriptors[0],
-            .dstBinding = binding,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pImageInfo = nullptr,
-            .pBufferInfo = &buffer_info,
-            .pTexelBufferView = nullptr
-        };
-        writes.push_back(write_uniforms);
-        vkUpdateDescriptorSets(logical, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+        const std::size_t offset = m_Ring.push(bytes);
+        std::memcpy(static_cast<std::byte*>(m_UniformMemory.mapped) + offset, data, bytes);
+        m_UniformOffsets[index] = static_cast<u32>(offset);
+    }
+
+    std::span<const u32> ShaderModule::dynamic_offsets() const {
+        return m_UniformOffsets;
+    }
+
+    const VkPushConstantRange& ShaderModule::push_constants() const {
+        return m_PushConstants;
     }
 
     Resource ShaderModule::vert() const {
@@ -652,6 +1114,14 @@ namespace aby::vk {
     Resource ShaderModule::frag() const {
         return m_Fragment;
     }
+
+    Resource ShaderModule::instance() const {
+        return m_Instance;
+    }
+
+    bool ShaderModule::has_instance_stage() const {
+        return static_cast<bool>(m_Instance);
+    }
         
     VkPipelineLayout ShaderModule::layout() const {
         return m_Layout;
@@ -665,10 +1135,56 @@ namespace aby::vk {
         return m_Descriptors;
     }
 
-    std::vector<VkPipelineShaderStageCreateInfo> ShaderModule::stages() const {
-        auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex));
-        auto frag_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Fragment));
-        return { vert_shader->stage(), frag_shader->stage() };
+    std::vector<VkPipelineShaderStageCreateInfo> ShaderModule::stages(bool instanced, const std::string& permutation) const {
+        return stages(instanced, stage_resources(), permutation);
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> ShaderModule::stages(bool instanced, const Stages& from, const std::string& permutation) const {
+        ABY_ASSERT(!instanced || from.instance, "ShaderModule has no instance stage");
+        auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(instanced ? from.instance : from.vertex));
+        auto frag_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(from.fragment));
+        ABY_ASSERT(vert_shader->has_permutation(permutation) || frag_shader->has_permutation(permutation),
+            "ShaderModule: No stage declares the permutation");
+        return { vert_shader->stage(permutation), frag_shader->stage(permutation) };
+    }
+
+    ShaderModule::Stages ShaderModule::stage_resources() const {
+        return Stages{ .vertex = m_Vertex, .fragment = m_Fragment, .instance = m_Instance };
+    }
+
+    bool ShaderModule::compatible(const Stages& stages) const {
+        auto descriptor = [this](Resource stage) {
+            return std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(stage))->descriptor().serialize();
+        };
+        const Stages current = stage_resources();
+        return descriptor(stages.vertex) == descriptor(current.vertex) &&
+            descriptor(stages.fragment) == descriptor(current.fragment) &&
+            (!current.instance || descriptor(stages.instance) == descriptor(current.instance));
+    }
+
+    ShaderModule::Stages ShaderModule::swap_stages(const Stages& stages) {
+        ABY_ASSERT(compatible(stages), "ShaderModule: The new stages must declare the same interface");
+        Stages released{};
+        for (auto [from, to, first, release] : {
+            std::tuple{ m_Vertex,   stages.vertex,   &m_Replaced.vertex,   &released.vertex },
+            std::tuple{ m_Fragment, stages.fragment, &m_Replaced.fragment, &released.fragment },
+            std::tuple{ m_Instance, stages.instance, &m_Replaced.instance, &released.instance } })
+        {
+            if (!from || from == to) {
+                continue;
+            }
+            if (*first) {
+                *release = from;
+            }
+            else {
+                *first = from;
+                std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(from))->destroy_module();
+            }
+        }
+        m_Vertex   = stages.vertex;
+        m_Fragment = stages.fragment;
+        m_Instance = stages.instance;
+        return released;
     }
     
     const VertexClass& ShaderModule::vertex_class() const {
@@ -679,6 +1195,12 @@ namespace aby::vk {
         auto vert_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Vertex));
         return vert_shader->descriptor();
     }
+
+    const ShaderDescriptor& ShaderModule::instance_descriptor() const {
+        ABY_ASSERT(m_Instance, "ShaderModule has no instance stage");
+        auto instance_shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(m_Instance));
+        return instance_shader->descriptor();
+    }
     
     VkDescriptorPool ShaderModule::pool() {
         return m_Pool;
@@ -688,6 +1210,145 @@ namespace aby::vk {
 }
 
 namespace aby::vk {
+
+    static constexpr u32 DESCRIPTOR_MAGIC = 0x52594241; // "ABYR"
+
+    class DescriptorWriter {
+    public:
+        void word(u32 value) {
+            auto bytes = std::as_bytes(std::span(&value, 1));
+            m_Data.insert(m_Data.end(), bytes.begin(), bytes.end());
+        }
+        void string(const std::string& value) {
+            word(static_cast<u32>(value.size()));
+            auto bytes = std::as_bytes(std::span(value.data(), value.size()));
+            m_Data.insert(m_Data.end(), bytes.begin(), bytes.end());
+        }
+        std::vector<std::byte> take() { return std::move(m_Data); }
+    private:
+        std::vector<std::byte> m_Data;
+    };
+
+    class DescriptorReader {
+    public:
+        explicit DescriptorReader(std::span<const std::byte> data) : m_Data(data) { }
+
+        bool word(u32& value) {
+            return read(&value, sizeof(value));
+        }
+        bool string(std::string& value) {
+            u32 size = 0;
+            if (!word(size) || size > m_Data.size()) {
+                return false;
+            }
+            value.resize(size);
+            return read(value.data(), size);
+        }
+        bool count(u32& value, std::size_t min_entry_bytes) {
+            // Rejects corrupt counts before anything is allocated for them.
+            return word(value) && static_cast<std::size_t>(value) * min_entry_bytes <= m_Data.size();
+        }
+        bool done() const { return m_Data.empty(); }
+    private:
+        bool read(void* dst, std::size_t bytes) {
+            if (bytes > m_Data.size()) {
+                return false;
+            }
+            std::memcpy(dst, m_Data.data(), bytes);
+            m_Data = m_Data.subspan(bytes);
+            return true;
+        }
+    private:
+        std::span<const std::byte> m_Data;
+    };
+
+    std::vector<std::byte> ShaderDescriptor::serialize() const {
+        DescriptorWriter out;
+        out.word(DESCRIPTOR_MAGIC);
+        out.word(VERSION);
+        out.word(static_cast<u32>(uniforms.size()));
+        for (const auto& u : uniforms) {
+            out.string(u.name);
+            out.word(u.set);
+            out.word(u.binding);
+            out.word(u.size);
+        }
+        out.word(static_cast<u32>(storages.size()));
+        for (const auto& s : storages) {
+            out.string(s.name);
+            out.word(s.set);
+            out.word(s.binding);
+        }
+        out.word(static_cast<u32>(samplers.size()));
+        for (const auto& s : samplers) {
+            out.string(s.name);
+            out.word(s.set);
+            out.word(s.binding);
+            out.word(s.count);
+        }
+        out.word(static_cast<u32>(inputs.size()));
+        for (const auto& i : inputs) {
+            out.word(i.location);
+            out.word(i.binding);
+            out.word(i.offset);
+            out.word(i.stride);
+            out.word(static_cast<u32>(i.format));
+        }
+        out.word(push_constants);
+        return out.take();
+    }
+
+    std::optional<ShaderDescriptor> ShaderDescriptor::deserialize(std::span<const std::byte> data) {
+        DescriptorReader in(data);
+        ShaderDescriptor out;
+        u32 magic = 0, version = 0, count = 0;
+        if (!in.word(magic) || magic != DESCRIPTOR_MAGIC || !in.word(version) || version != VERSION) {
+            return std::nullopt;
+        }
+        if (!in.count(count, 16)) {
+            return std::nullopt;
+        }
+        out.uniforms.resize(count);
+        for (auto& u : out.uniforms) {
+            if (!in.string(u.name) || !in.word(u.set) || !in.word(u.binding) || !in.word(u.size)) {
+                return std::nullopt;
+            }
+        }
+        if (!in.count(count, 12)) {
+            return std::nullopt;
+        }
+        out.storages.resize(count);
+        for (auto& s : out.storages) {
+            if (!in.string(s.name) || !in.word(s.set) || !in.word(s.binding)) {
+                return std::nullopt;
+            }
+        }
+        if (!in.count(count, 16)) {
+            return std::nullopt;
+        }
+        out.samplers.resize(count);
+        for (auto& s : out.samplers) {
+            if (!in.string(s.name) || !in.word(s.set) || !in.word(s.binding) || !in.word(s.count)) {
+                return std::nullopt;
+            }
+        }
+        if (!in.count(count, 20)) {
+            return std::nullopt;
+        }
+        out.inputs.resize(count);
+        for (auto& i : out.inputs) {
+            u32 format = 0;
+            if (!in.word(i.location) || !in.word(i.binding) || !in.word(i.offset) || !in.word(i.stride) || !in.word(format)) {
+                return std::nullopt;
+            }
+            i.format = static_cast<VkFormat>(format);
+        }
+        if (!in.word(out.push_constants) || !in.done()) {
+            return std::nullopt;
+        }
+        return out;
+    }
+
     std::map<std::size_t, std::size_t> ShaderDescriptor::uniform_binding_sizes() const {
         std::map<std::size_t, std::size_t> binding_size_map;
         for (const auto& uniform : uniforms) {
@@ -724,6 +1385,8 @@ namespace aby::vk {
             case VK_FORMAT_R32G32_UINT: return 8;
             case VK_FORMAT_R32G32B32_UINT: return 12;
             case VK_FORMAT_R32G32B32A32_UINT: return 16;
+            case VK_FORMAT_R8G8B8A8_UNORM: return 4;
+            case VK_FORMAT_R16G16_SFLOAT: return 4;
             default: return 0;
         }
     }
@@ -0,0 +1,206 @@
+#include "Platform/vk/VkShaderReloader.h"
+#include "Platform/vk/VkRenderModule.h"
+#include "Platform/vk/VkContext.h"
+#include "Platform/vk/VkAllocator.h"
+#include "Core/App.h"
+#include "Core/Log.h"
+#include <algorithm>
+
+namespace aby::vk {
+
+    ShaderReloader::ShaderReloader(vk::Context* ctx, Ref<ShaderModule> module) :
+        m_Ctx(ctx),
+        m_Module(module),
+        m_Watcher(sys::FileWatcher::create([this](const fs::path& file) {
+            std::lock_guard lock(m_Mutex);
+            m_Changed.insert(file);
+        })),
+        m_Mutex(),
+        m_Changed(),
+        m_Rebuild(),
+        m_Retired()
+    {
+        watch(m_Module->stage_resources());
+    }
+
+    void ShaderReloader::update(std::span<RenderModule* const> modules, const Swapchain& swapchain) {
+        std::erase_if(m_Retired, [this](Retired& retired) {
+            if (--retired.frames > 0) {
+                return false;
+            }
+            destroy(retired);
+            return true;
+        });
+
+        if (m_Rebuild) {
+            // True only once the job's done() let go of the group, finish() frees it.
+            if (!m_Rebuild->done->is_done()) {
+                return;
+            }
+            finish(modules, swapchain);
+        }
+
+        std::set<fs::path> changed;
+        {
+            std::lock_guard lock(m_Mutex);
+            changed.swap(m_Changed);
+        }
+        if (!changed.empty()) {
+            start(modules, swapchain, changed);
+        }
+    }
+
+    void ShaderReloader::destroy() {
+        m_Watcher.reset();
+        if (m_Rebuild) {
+            m_Ctx->app()->jobs().wait(*m_Rebuild->done);
+            discard(*m_Rebuild);
+            m_Rebuild.reset();
+        }
+        for (auto& retired : m_Retired) {
+            destroy(retired);
+        }
+        m_Retired.clear();
+    }
+
+    void ShaderReloader::watch(const ShaderModule::Stages& stages) {
+        for (Resource stage : { stages.vertex, stages.fragment, stages.instance }) {
+            if (!stage) {
+                continue;
+            }
+            auto shader = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(stage));
+            for (const auto& source : shader->sources()) {
+                if (!m_Watcher->watch(source)) {
+                    ABY_WARN("ShaderReloader: Cannot watch {}", source.string());
+                }
+            }
+        }
+    }
+
+    void ShaderReloader::start(std::span<RenderModule* const> modules, const Swapchain& swapchain, const std::set<fs::path>& changed) {
+        auto rebuild    = create_unique<Rebuild>();
+        rebuild->stages = m_Module->stage_resources();
+        rebuild->done   = create_unique<WaitGroup>();
+        // The job never touches the swapchain, it may be recreated meanwhile.
+        rebuild->format = swapchain.format();
+
+        for (Resource* stage : { &rebuild->stages.vertex, &rebuild->stages.fragment, &rebuild->stages.instance }) {
+            if (!*stage) {
+                continue;
+            }
+            auto shader   = std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(*stage));
+            auto& sources = shader->sources();
+            bool affected = std::any_of(sources.begin(), sources.end(), [&changed](const fs::path& source) {
+                std::error_code ec;
+                return changed.contains(fs::weakly_canonical(source, ec));
+            });
+            if (affected) {
+                ABY_LOG("ShaderReloader: Recompiling {}", sources.front().string());
+                *stage = aby::Shader::create(m_Ctx, sources.front(), shader->type());
+                rebuild->compiled.push_back(*stage);
+            }
+        }
+        if (rebuild->compiled.empty()) {
+            return;
+        }
+
+        // Same order as finish() hands them out, every pipeline is rebuilt with its own permutation.
+        std::vector<std::pair<bool, std::string>> targets;
+        for (RenderModule* module : modules) {
+            targets.emplace_back(false, module->pipeline().permutation());
+            if (m_Module->has_instance_stage()) {
+                targets.emplace_back(true, module->instance_pipeline().permutation());
+            }
+        }
+
+        // Compile, validate and build off the render thread, only finish() touches what is drawn.
+        m_Ctx->app()->jobs().submit([this, targets = std::move(targets), state = rebuild.get()]() {
+            // Every stage is awaited, discard() must not race a compile. The loader already logged why one failed.
+            bool failed = false;
+            for (Resource stage : state->compiled) {
+                failed |= m_Ctx->loader().wait(stage) == EResourceState::FAILED;
+            }
+            if (failed) {
+                return;
+            }
+            if (!m_Module->compatible(state->stages)) {
+                ABY_WARN("ShaderReloader: The descriptors of the shaders changed, restart to apply the edit");
+                return;
+            }
+            try {
+                for (const auto& [instanced, permutation] : targets) {
+                    auto stages = m_Module->stages(instanced, state->stages, permutation);
+                    state->pipelines.emplace_back(m_Ctx->window(), m_Ctx->devices(), m_Module, state->format, instanced, permutation, stages);
+                }
+                state->ok = true;
+            }
+            catch (const std::exception& e) {
+                ABY_ERR("ShaderReloader: {}", e.what());
+            }
+        }, EJobPriority::LOW, rebuild->done.get());
+        m_Rebuild = std::move(rebuild);
+    }
+
+    void ShaderReloader::finish(std::span<RenderModule* const> modules, const Swapchain& swapchain) {
+        auto rebuild = std::move(m_Rebuild);
+        if (rebuild->ok && rebuild->format != swapchain.format()) {
+            ABY_WARN("ShaderReloader: The swapchain format changed during the rebuild, save the shader again to apply the edit");
+            rebuild->ok = false;
+        }
+        if (!rebuild->ok) {
+            discard(*rebuild);
+            return;
+        }
+
+        // Frames still in flight draw with the old pipelines, the current one already waited on its fence.
+        Retired retired{ .pipelines = {}, .stages = {}, .frames = MAX_FRAMES_IN_FLIGHT };
+        auto    next = rebuild->pipelines.begin();
+        for (RenderModule* module : modules) {
+            retired.pipelines.push_back(module->pipeline().replace(std::move(*next++)));
+            if (m_Module->has_instance_stage()) {
+                retired.pipelines.push_back(module->instance_pipeline().replace(std::move(*next++)));
+            }
+        }
+
+        // The first stages stay with the module for their descriptor set layouts, later ones retire with the pipelines.
+        ShaderModule::Stages released = m_Module->swap_stages(rebuild->stages);
+        for (Resource stage : { released.vertex, released.fragment, released.instance }) {
+            if (stage) {
+                retired.stages.push_back(stage);
+            }
+        }
+        m_Retired.push_back(std::move(retired));
+        watch(rebuild->stages);
+        ABY_LOG("ShaderReloader: Reloaded {} shader stage(s)", rebuild->compiled.size());
+    }
+
+    void ShaderReloader::destroy(Retired& retired) {
+        auto* logical = m_Ctx->devices().logical();
+        for (VkPipeline pipeline : retired.pipelines) {
+            vkDestroyPipeline(logical, pipeline, IAllocator::get());
+        }
+        for (Resource stage : retired.stages) {
+            std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(stage))->destroy();
+            m_Ctx->shaders().erase(stage);
+        }
+        retired.pipelines.clear();
+        retired.stages.clear();
+    }
+
+    void ShaderReloader::discard(Rebuild& rebuild) {
+        auto* logical = m_Ctx->devices().logical();
+        for (auto& pipeline : rebuild.pipelines) {
+            vkDestroyPipeline(logical, pipeline, IAllocator::get());
+        }
+        for (Resource stage : rebuild.compiled) {
+            if (m_Ctx->shaders().is_ready(stage)) {
+                std::static_pointer_cast<vk::Shader>(m_Ctx->shaders().at(stage))->destroy();
+                m_Ctx->shaders().erase(stage);
+            }
+            else {
+                m_Ctx->shaders().drop(stage); // Failed to compile, the job waited on every stage
+            }
+        }
+    }
+
+}
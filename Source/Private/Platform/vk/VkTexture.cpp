@@ -1,6 +1,9 @@
 #include "Platform/vk/VkTexture.h"
 #include "Platform/vk/VkContext.h"
 #include "Platform/vk/VkAllocator.h"
+#include <array>
+#include <cstring>
+#include <utility>
 
 namespace aby::vk {
     
@@ -11,52 +14,80 @@ namespace aby::vk {
         m_Layout(VK_IMAGE_LAYOUT_UNDEFINED),
         m_Image(VK_NULL_HANDLE),
         m_View(VK_NULL_HANDLE),
-        m_ImageMemory(VK_NULL_HANDLE),
+        m_Memory(&ctx->devices().memory()),
+        m_Allocation{},
         m_Sampler(VK_NULL_HANDLE),
         m_ImGuiID(VK_NULL_HANDLE)
     {
     }
 
     Texture::Texture(vk::Context* ctx, const glm::u32vec2& size, const glm::vec4& color) :
-        aby::Texture(size, color),
+        aby::Texture(size, 4),
         m_Logical(ctx->devices().logical()),
         m_Format(VK_FORMAT_R8G8B8A8_UINT),
         m_Layout(VK_IMAGE_LAYOUT_UNDEFINED),
         m_Image(VK_NULL_HANDLE),
         m_View(VK_NULL_HANDLE),
-        m_ImageMemory(VK_NULL_HANDLE),
+        m_Memory(&ctx->devices().memory()),
+        m_Allocation{},
         m_Sampler(VK_NULL_HANDLE),
         m_ImGuiID(VK_NULL_HANDLE)
     {
-        init(ctx);
+        const std::array<std::byte, 4> rgba = {
+            static_cast<std::byte>(static_cast<uint8_t>(color.r * 255.0f)),
+            static_cast<std::byte>(static_cast<uint8_t>(color.g * 255.0f)),
+            static_cast<std::byte>(static_cast<uint8_t>(color.b * 255.0f)),
+            static_cast<std::byte>(static_cast<uint8_t>(color.a * 255.0f))
+        };
+        init(ctx, [&rgba](std::span<std::byte> dst) {
+            for (std::size_t i = 0; i + 4 <= dst.size(); i += 4) {
+                std::memcpy(&dst[i], rgba.data(), 4);
+            }
+        });
     }
     
-    Texture::Texture(vk::Context* ctx, const fs::path& path) :
-        aby::Texture(path),
+    Texture::Texture(vk::Context* ctx, const fs::path& path, bool retain_data) :
+        Texture(ctx, path, read_info(path), retain_data)
+    {
+    }
+
+    Texture::Texture(vk::Context* ctx, const fs::path& path, const std::pair<glm::u32vec2, u32>& info, bool retain_data) :
+        aby::Texture(info.first, info.second),
         m_Logical(ctx->devices().logical()),
         m_Format(VK_FORMAT_UNDEFINED),
         m_Layout(VK_IMAGE_LAYOUT_UNDEFINED),
         m_Image(VK_NULL_HANDLE),
         m_View(VK_NULL_HANDLE),
-        m_ImageMemory(VK_NULL_HANDLE),
+        m_Memory(&ctx->devices().memory()),
+        m_Allocation{},
         m_Sampler(VK_NULL_HANDLE),
         m_ImGuiID(VK_NULL_HANDLE)
     {
-        init(ctx);
+        init(ctx, [this, &path, retain_data](std::span<std::byte> dst) {
+            decode(path, this->size(), this->channels(), dst);
+            if (retain_data) {
+                retain(dst);
+            }
+        });
     }
 
     Texture::Texture(vk::Context* ctx, const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels) :
-        aby::Texture(size, data, channels),
+        aby::Texture(size, channels),
         m_Logical(ctx->devices().logical()),
         m_Format(VK_FORMAT_UNDEFINED),
         m_Layout(VK_IMAGE_LAYOUT_UNDEFINED),
         m_Image(VK_NULL_HANDLE),
         m_View(VK_NULL_HANDLE),
-        m_ImageMemory(VK_NULL_HANDLE),
+        m_Memory(&ctx->devices().memory()),
+        m_Allocation{},
         m_Sampler(VK_NULL_HANDLE),
         m_ImGuiID(VK_NULL_HANDLE)
     {
-        init(ctx);
+        ABY_ASSERT(data.size() % channels == 0, "Invalid texture data size");
+        ABY_ASSERT(size.x * size.y * channels == data.size(), "Data size does not match square image");
+        init(ctx, [&data](std::span<std::byte> dst) {
+            std::memcpy(dst.data(), data.data(), data.size());
+        });
     }
 
 
@@ -67,7 +98,8 @@ namespace aby::vk {
         m_Layout(VK_IMAGE_LAYOUT_UNDEFINED),
         m_Image(other.m_Image),
         m_View(other.m_View),
-        m_ImageMemory(other.m_ImageMemory),
+        m_Memory(other.m_Memory),
+        m_Allocation(other.m_Allocation),
         m_Sampler(other.m_Sampler),
         m_ImGuiID(other.m_ImGuiID)
     {
@@ -81,23 +113,22 @@ namespace aby::vk {
         m_Layout(other.m_Layout),
         m_Image(std::move(other.m_Image)),
         m_View(std::move(other.m_View)),
-        m_ImageMemory(std::move(other.m_ImageMemory)),
+        m_Memory(other.m_Memory),
+        m_Allocation(std::exchange(other.m_Allocation, Allocation{})),
         m_Sampler(std::move(other.m_Sampler)),
-        m_ImGuiID(std::move(other.m_ImGuiID))
+        m_ImGuiID(std::move(other.m_ImGuiID)),
+        m_Staging(std::move(other.m_Staging))
     {
     }
 
-    void Texture::init(vk::Context* ctx) {
+    void Texture::init(vk::Context* ctx, const Fill& fill) {
         auto c = this->channels();
         auto size = this->size();
+        ABY_ASSERT(this->bytes() > 0, "Texture has no pixels");
 
-        const std::byte* p = this->data().data();
-        const void* vp = static_cast<const void*>(p);
-        ABY_ASSERT(p, "Data is not valid");
-        ABY_ASSERT(vp, "Data is not valid");
-
-        vk::Buffer staging(vp, this->bytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ctx->devices());
-        Ref<CmdPool> cmd_pool = ctx->devices().create_cmd_pool();
+        m_Staging = create_ref<vk::StagingBuffer>(this->bytes(), ctx->devices());
+        fill(m_Staging->map());
+        m_Staging->unmap();
 
         switch (c) {
             case 4:
@@ -110,55 +141,26 @@ namespace aby::vk {
                 m_Format = VK_FORMAT_R8G8_SRGB;
                 break;
             case 1:
-                m_Format = VK_FORMAT_R8_SRGB;
+                // Single channel textures are masks (glyph coverage, distance fields), not colors.
+                m_Format = VK_FORMAT_R8_UNORM;
                 break;
             default:
                 break;
         }
 
+        // Written on the transfer queue and sampled on the graphics queue.
+        auto families = ctx->devices().queue_families();
         helper::create_img(
             size.x, size.y, m_Format,
             VK_IMAGE_TILING_OPTIMAL,
             VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            m_Image, m_ImageMemory,
-            ctx->devices().logical(),
-            ctx->devices().physical()
-        );
-        VkCommandBuffer cmd = helper::begin_single_time_commands(m_Logical, cmd_pool.get()->operator const VkCommandPool());
-
-        helper::transition_image_layout(
-            cmd,
             m_Image,
-            &m_Layout,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            0,                                 // No access required for VK_IMAGE_LAYOUT_UNDEFINED
-            VK_ACCESS_TRANSFER_WRITE_BIT,      // We are going to write to it using a buffer copy
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, // Before anything happens
-            VK_PIPELINE_STAGE_TRANSFER_BIT     // Ensure the transfer completes before use
-        );
-
-        helper::copy_buffer_to_img(cmd, staging, m_Image, size.x, size.y);
-
-        helper::transition_image_layout(
-            cmd,
-            m_Image,
-            &m_Layout,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            VK_ACCESS_TRANSFER_WRITE_BIT,
-            VK_ACCESS_SHADER_READ_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,    // Ensure transfer completes
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT // The fragment shader will sample this image
-        );
-
-        helper::end_single_time_commands(
-            cmd,
-            m_Logical,
-            cmd_pool.get()->operator const VkCommandPool(),
-            ctx->devices().graphics().Queue
+            ctx->devices().logical(),
+            families
         );
-
-        staging.destroy();
+        m_Allocation = m_Memory->bind(m_Image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // The Uploader leaves the image in this layout.
+        m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         helper::create_img_view(m_Logical, m_Image, m_Format, m_View);
 
         VkSamplerCreateInfo samplerInfo{};
@@ -179,15 +181,21 @@ namespace aby::vk {
         samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // If you have mipmaps, adjust accordingly
 
         VK_CHECK(vkCreateSampler(m_Logical, &samplerInfo, IAllocator::get(), &m_Sampler));
-        cmd_pool->destroy(m_Logical);
     }
 
+    void Texture::upload(vk::Context* ctx, std::function<void()>&& on_complete) {
+        ABY_ASSERT(m_Staging, "Texture was already uploaded");
+        ctx->uploader().upload(std::move(m_Staging), m_Image, size(), std::move(on_complete));
+    }
 
     Texture::~Texture() {
+        if (m_Staging) {
+            m_Staging->destroy();
+        }
         vkDestroySampler(m_Logical, m_Sampler, IAllocator::get());
         vkDestroyImageView(m_Logical, m_View, IAllocator::get());
         vkDestroyImage(m_Logical, m_Image, IAllocator::get());
-        vkFreeMemory(m_Logical, m_ImageMemory, IAllocator::get());
+        m_Memory->free(m_Allocation);
     }
 
     VkImage Texture::img() {
@@ -0,0 +1,172 @@
+#include "Platform/vk/VkUploader.h"
+#include "Platform/vk/VkAllocator.h"
+#include "Core/Thread.h"
+#include "Core/Log.h"
+
+namespace aby::vk {
+
+    // Requests arriving within this window of each other share a submission.
+    static constexpr auto COALESCE_WINDOW = std::chrono::microseconds(500);
+
+    Uploader::Uploader() :
+        m_Devices(nullptr),
+        m_Pool(),
+        m_Cmd(VK_NULL_HANDLE),
+        m_Fence(VK_NULL_HANDLE),
+        m_Pending(),
+        m_Stop(false),
+        m_Thread(nullptr)
+    {
+    }
+
+    Uploader::~Uploader() {
+        destroy();
+    }
+
+    void Uploader::create(DeviceManager& devices) {
+        m_Devices = &devices;
+        auto logical = devices.logical();
+        m_Pool.create(logical, devices.transfer().FamilyIdx);
+
+        VkCommandBufferAllocateInfo alloc_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = static_cast<VkCommandPool>(m_Pool),
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        VK_CHECK(vkAllocateCommandBuffers(logical, &alloc_info, &m_Cmd));
+
+        VkFenceCreateInfo fence_info{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+        };
+        VK_CHECK(vkCreateFence(logical, &fence_info, IAllocator::get(), &m_Fence));
+
+        m_Stop   = false;
+        m_Thread = create_unique<Thread>([this]() { work(); }, "Upload Thread");
+    }
+
+    void Uploader::destroy() {
+        if (!m_Thread) {
+            return;
+        }
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_CondVar.notify_all();
+        m_Thread.reset(); // Joins after the remaining requests were submitted.
+
+        auto logical = m_Devices->logical();
+        vkDestroyFence(logical, m_Fence, IAllocator::get());
+        m_Pool.destroy(logical);
+        m_Fence = VK_NULL_HANDLE;
+        m_Cmd   = VK_NULL_HANDLE;
+    }
+
+    void Uploader::upload(Ref<StagingBuffer> staging, VkImage image, const glm::u32vec2& size, OnComplete&& on_complete) {
+        {
+            std::lock_guard lock(m_Mutex);
+            m_Pending.push_back(Request{ std::move(staging), image, size, std::move(on_complete) });
+        }
+        m_CondVar.notify_one();
+    }
+
+    std::size_t Uploader::pending() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Pending.size();
+    }
+
+    void Uploader::work() {
+        std::vector<Request> batch;
+        while (true) {
+            {
+                std::unique_lock lock(m_Mutex);
+                m_CondVar.wait(lock, [this]() { return m_Stop || !m_Pending.empty(); });
+                if (m_Pending.empty()) {
+                    break; // Stopped and drained.
+                }
+                // Give concurrent loads a moment to join this batch.
+                std::size_t count = m_Pending.size();
+                while (!m_Stop && count < MAX_BATCH) {
+                    m_CondVar.wait_for(lock, COALESCE_WINDOW);
+                    if (m_Pending.size() == count) break;
+                    count = m_Pending.size();
+                }
+                std::size_t take = std::min(m_Pending.size(), MAX_BATCH);
+                batch.assign(std::make_move_iterator(m_Pending.begin()), std::make_move_iterator(m_Pending.begin() + take));
+                m_Pending.erase(m_Pending.begin(), m_Pending.begin() + take);
+            }
+            submit(batch);
+            batch.clear();
+        }
+    }
+
+    void Uploader::submit(std::vector<Request>& batch) {
+        auto logical = m_Devices->logical();
+
+        VkCommandBufferBeginInfo begin_info{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr,
+        };
+        VK_CHECK(vkBeginCommandBuffer(m_Cmd, &begin_info));
+        for (auto& request : batch) {
+            helper::transition_image_layout(
+                m_Cmd,
+                request.image,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_ACCESS_2_NONE,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT
+            );
+            helper::copy_buffer_to_img(m_Cmd, *request.staging, request.image, request.size.x, request.size.y);
+            // Visibility for the fragment shader comes from the fence wait that precedes any
+            // use of the texture, transfer queues do not support fragment shader stages.
+            helper::transition_image_layout(
+                m_Cmd,
+                request.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_ACCESS_2_NONE,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_2_NONE
+            );
+        }
+        VK_CHECK(vkEndCommandBuffer(m_Cmd));
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &m_Cmd,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr,
+        };
+        {
+            std::lock_guard lock(m_Devices->transfer_mutex());
+            VK_CHECK(vkQueueSubmit(m_Devices->transfer().Queue, 1, &submit_info, m_Fence));
+        }
+        VK_CHECK(vkWaitForFences(logical, 1, &m_Fence, VK_TRUE, UINT64_MAX));
+        VK_CHECK(vkResetFences(logical, 1, &m_Fence));
+        VK_CHECK(vkResetCommandPool(logical, static_cast<VkCommandPool>(m_Pool), 0));
+
+        ABY_DBG("vk::Uploader::submit: {} image(s)", batch.size());
+        for (auto& request : batch) {
+            request.staging->destroy();
+            if (request.on_complete) {
+                request.on_complete();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,238 @@
+#include "Rendering/BatchKernels.h"
+#include "Core/Simd.h"
+#include <cstddef>
+#include <memory>
+
+#ifdef ABY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace aby::kernels {
+
+    // The SIMD kernels address the records as flat arrays of 32 bit words.
+    static constexpr std::size_t QUAD_FLOATS    = sizeof(Quad) / sizeof(float);
+    static constexpr std::size_t GLYPH_FLOATS   = sizeof(GlyphQuad) / sizeof(float);
+    static constexpr std::size_t INSTANCE_WORDS = sizeof(QuadInstance) / sizeof(u32);
+    static_assert(QUAD_FLOATS == 15 && offsetof(Quad, texinfo) == 7 * sizeof(float) && offsetof(Quad, size) == 12 * sizeof(float));
+    static_assert(GLYPH_FLOATS == 9 && offsetof(GlyphQuad, uv_rect) == 5 * sizeof(float));
+    static_assert(INSTANCE_WORDS == 14 && offsetof(QuadInstance, col) == 6 * sizeof(u32) && offsetof(QuadInstance, uvs) == 11 * sizeof(u32));
+
+    static constexpr glm::vec4 UNIT_UV_RECT = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+    static void write_quads_scalar(std::span<const Quad> quads, QuadInstance* out, bool flat) {
+        for (std::size_t i = 0; i < quads.size(); i++) {
+            const Quad& q = quads[i];
+            std::construct_at(out + i, q.pos, glm::vec3(q.size.x, q.size.y, flat ? 0.f : q.size.z), q.col, UNIT_UV_RECT, q.texinfo.z, q.uvs);
+        }
+    }
+
+    static void write_glyphs_scalar(std::span<const GlyphQuad> glyphs, const GlyphRun& run, QuadInstance* out) {
+        for (std::size_t i = 0; i < glyphs.size(); i++) {
+            const GlyphQuad& g = glyphs[i];
+            glm::vec2 size = g.size * run.scale;
+            glm::vec3 pos  = {
+                run.origin.x + g.pen + g.bearing.x * run.scale + size.x / 2,
+                run.origin.y + (run.height - g.bearing.y) * run.scale + size.y / 2,
+                run.origin.z
+            };
+            QuadInstance instance(pos, glm::vec3(size, 0.f), run.color, g.uv_rect, run.texture);
+            instance.texture |= run.flags;
+            std::construct_at(out + i, instance);
+        }
+    }
+
+#ifdef ABY_SIMD_X86
+
+    /**
+    * @brief rgba (lanes 0-3) to R8G8B8A8_UNORM in lane 0, the other lanes are zero. Matches pack_unorm8.
+    */
+    ABY_SIMD_TARGET("sse4.1")
+    static inline __m128i pack_unorm8_sse(__m128 rgba) {
+        __m128  c = _mm_min_ps(_mm_max_ps(rgba, _mm_setzero_ps()), _mm_set1_ps(1.f));
+        __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+        i = _mm_packus_epi16(_mm_packus_epi32(i, i), i);
+        return _mm_cvtsi32_si128(_mm_cvtsi128_si32(i));
+    }
+
+    ABY_SIMD_TARGET("sse4.1")
+    static void write_quads_sse(std::span<const Quad> quads, QuadInstance* out, bool flat) {
+        const __m128  rect = _mm_setr_ps(0.f, 1.f, 1.f, 0.f);
+        const __m128i tex  = _mm_setr_epi32(0, -1, 0, 0);
+        // Clears the z size (lane 1 of the second store) of flat quads.
+        const __m128  keep = _mm_castsi128_ps(flat ? _mm_setr_epi32(-1, 0, -1, -1) : _mm_set1_epi32(-1));
+
+        const float* src = reinterpret_cast<const float*>(quads.data());
+        float*       dst = reinterpret_cast<float*>(out);
+        for (std::size_t i = 0; i < quads.size(); i++, src += QUAD_FLOATS, dst += INSTANCE_WORDS) {
+            __m128 a = _mm_loadu_ps(src + 0);  // px  py pz r
+            __m128 b = _mm_loadu_ps(src + 4);  // g   b  a  tx
+            __m128 c = _mm_loadu_ps(src + 8);  // ty  tz uu uv
+            __m128 d = _mm_loadu_ps(src + 11); // uv  sx sy sz
+
+            __m128i col = pack_unorm8_sse(_mm_castsi128_ps(_mm_alignr_epi8(_mm_castps_si128(b), _mm_castps_si128(a), 12)));
+            int     uvs = static_cast<int>(pack_half2({ src[10], src[11] }));
+
+            __m128 o0 = _mm_blend_ps(a, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 0, 0)), 0b1000);           // px py pz sx
+            __m128 o1 = _mm_shuffle_ps(d, _mm_castsi128_ps(col), _MM_SHUFFLE(1, 0, 3, 2));                // sy sz C  0
+            __m128 o2 = _mm_castsi128_ps(_mm_insert_epi32(_mm_castps_si128(rect), uvs, 3));              // 0  1  1  UV
+
+            _mm_storeu_ps(dst + 0, o0);
+            _mm_storeu_ps(dst + 4, _mm_and_ps(o1, keep));
+            _mm_storeu_ps(dst + 8, o2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 12), _mm_and_si128(_mm_cvttps_epi32(c), tex)); // 0 tz
+        }
+    }
+
+    ABY_SIMD_TARGET("avx2,f16c")
+    static void write_quads_avx2(std::span<const Quad> quads, QuadInstance* out, bool flat) {
+        // lo = px py pz r g b a tx, hi = tx ty tz uu uv sx sy sz (floats 0-7 and 7-14 of a Quad)
+        const __m256i lo_first = _mm256_setr_epi32(0, 1, 2, 0, 0, 0, 0, 0);
+        const __m256i hi_first = _mm256_setr_epi32(0, 0, 0, 5, 6, 7, 0, 0);
+        const __m256i lo_color = _mm256_setr_epi32(3, 4, 5, 6, 0, 0, 0, 0);
+        const __m256i hi_uvs   = _mm256_setr_epi32(3, 4, 0, 0, 0, 0, 0, 0);
+        const __m256i to_color = _mm256_setr_epi32(1, 1, 1, 1, 1, 1, 0, 1); // Lane 6, lane 1 is zero
+        const __m128  rect     = _mm_setr_ps(0.f, 1.f, 1.f, 0.f);
+        const __m128i tex      = _mm_setr_epi32(0, -1, 0, 0);
+        const __m256  keep     = _mm256_castsi256_ps(flat ? _mm256_setr_epi32(-1, -1, -1, -1, -1, 0, -1, -1) : _mm256_set1_epi32(-1));
+
+        const float* src = reinterpret_cast<const float*>(quads.data());
+        float*       dst = reinterpret_cast<float*>(out);
+        for (std::size_t i = 0; i < quads.size(); i++, src += QUAD_FLOATS, dst += INSTANCE_WORDS) {
+            __m256 lo = _mm256_loadu_ps(src);
+            __m256 hi = _mm256_loadu_ps(src + 7);
+
+            __m128i col = pack_unorm8_sse(_mm256_castps256_ps128(_mm256_permutevar8x32_ps(lo, lo_color)));
+            __m128i uvs = _mm_cvtps_ph(_mm256_castps256_ps128(_mm256_permutevar8x32_ps(hi, hi_uvs)), _MM_FROUND_TO_NEAREST_INT);
+
+            // px py pz sx sy sz C 0
+            __m256 o0 = _mm256_blend_ps(_mm256_permutevar8x32_ps(lo, lo_first), _mm256_permutevar8x32_ps(hi, hi_first), 0b00111000);
+            o0 = _mm256_blend_ps(o0, _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castsi128_ps(col)), to_color), 0b11000000);
+            // 0 1 1 UV
+            __m128 o1 = _mm_castsi128_ps(_mm_insert_epi32(_mm_castps_si128(rect), _mm_cvtsi128_si32(uvs), 3));
+
+            _mm256_storeu_ps(dst + 0, _mm256_and_ps(o0, keep));
+            _mm_storeu_ps(dst + 8, o1);
+            __m128i tail = _mm_shuffle_epi32(_mm_cvttps_epi32(_mm256_castps256_ps128(hi)), _MM_SHUFFLE(0, 0, 2, 0)); // tx tz
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 12), _mm_and_si128(tail, tex));                          // 0  tz
+        }
+    }
+    /**
+    * @brief Constants of a glyph run, laid out for write_glyph_sse.
+    */
+    struct GlyphConstants {
+        __m128  scale; // s s s -s
+        __m128  half;  // .5 .5 1 1
+        __m128  base;  // x y+height*s 0 0
+        __m128  z;
+        __m128  color; // R8G8B8A8_UNORM in every lane
+        __m128  uvs;   // (1, 1) as R16G16_SFLOAT in every lane
+        __m128i tail;  // rotation texture
+    };
+
+    ABY_SIMD_TARGET("sse4.1")
+    static inline void write_glyph_sse(const float* src, float* dst, const GlyphConstants& k) {
+        const __m128 zero = _mm_setzero_ps();
+
+        __m128 g     = _mm_loadu_ps(src + 1);                // sx sy bx by
+        __m128 uv    = _mm_loadu_ps(src + 5);                // u0 v0 u1 v1
+        __m128 sized = _mm_mul_ps(g, k.scale);               // sx*s sy*s bx*s -by*s
+        __m128 t     = _mm_mul_ps(sized, k.half);
+        __m128 p     = _mm_add_ps(_mm_add_ps(t, _mm_movehl_ps(t, t)), _mm_add_ss(k.base, _mm_load_ss(src)));
+
+        _mm_storeu_ps(dst + 0, _mm_movelh_ps(p, _mm_unpacklo_ps(k.z, sized)));                                                                 // px py pz sx
+        _mm_storeu_ps(dst + 4, _mm_movelh_ps(_mm_unpacklo_ps(_mm_shuffle_ps(sized, sized, _MM_SHUFFLE(1, 1, 1, 1)), zero), _mm_unpacklo_ps(k.color, uv))); // sy 0 C u0
+        _mm_storeu_ps(dst + 8, _mm_shuffle_ps(uv, _mm_unpackhi_ps(uv, k.uvs), _MM_SHUFFLE(3, 2, 2, 1)));                                      // v0 u1 v1 UV
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 12), k.tail);
+    }
+
+    ABY_SIMD_TARGET("sse4.1")
+    static GlyphConstants glyph_constants(const GlyphRun& run) {
+        return GlyphConstants{
+            .scale = _mm_setr_ps(run.scale, run.scale, run.scale, -run.scale),
+            .half  = _mm_setr_ps(0.5f, 0.5f, 1.f, 1.f),
+            .base  = _mm_setr_ps(run.origin.x, run.origin.y + run.height * run.scale, 0.f, 0.f),
+            .z     = _mm_set1_ps(run.origin.z),
+            .color = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(pack_unorm8(run.color)))),
+            .uvs   = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(pack_half2({ 1.f, 1.f })))),
+            .tail  = _mm_setr_epi32(0, static_cast<int>(static_cast<u32>(run.texture) | run.flags), 0, 0),
+        };
+    }
+
+    ABY_SIMD_TARGET("sse4.1")
+    static void write_glyphs_sse(std::span<const GlyphQuad> glyphs, const GlyphRun& run, QuadInstance* out) {
+        const GlyphConstants k = glyph_constants(run);
+        const float* src = reinterpret_cast<const float*>(glyphs.data());
+        float*       dst = reinterpret_cast<float*>(out);
+        for (std::size_t i = 0; i < glyphs.size(); i++, src += GLYPH_FLOATS, dst += INSTANCE_WORDS) {
+            write_glyph_sse(src, dst, k);
+        }
+    }
+
+    ABY_SIMD_TARGET("avx2,f16c")
+    static void write_glyphs_avx2(std::span<const GlyphQuad> glyphs, const GlyphRun& run, QuadInstance* out) {
+        // Two glyphs per iteration, one per 128 bit lane.
+        const GlyphConstants k = glyph_constants(run);
+        const __m256 scale = _mm256_set_m128(k.scale, k.scale);
+        const __m256 half  = _mm256_set_m128(k.half, k.half);
+        const __m256 base  = _mm256_set_m128(k.base, k.base);
+        const __m256 z     = _mm256_set_m128(k.z, k.z);
+        const __m256 color = _mm256_set_m128(k.color, k.color);
+        const __m256 uvs   = _mm256_set_m128(k.uvs, k.uvs);
+        const __m256 zero  = _mm256_setzero_ps();
+
+        const float* src = reinterpret_cast<const float*>(glyphs.data());
+        float*       dst = reinterpret_cast<float*>(out);
+        std::size_t  i   = 0;
+        for (; i + 2 <= glyphs.size(); i += 2, src += 2 * GLYPH_FLOATS, dst += 2 * INSTANCE_WORDS) {
+            __m256 g     = _mm256_set_m128(_mm_loadu_ps(src + GLYPH_FLOATS + 1), _mm_loadu_ps(src + 1));
+            __m256 uv    = _mm256_set_m128(_mm_loadu_ps(src + GLYPH_FLOATS + 5), _mm_loadu_ps(src + 5));
+            __m256 pen   = _mm256_setr_ps(src[0], 0.f, 0.f, 0.f, src[GLYPH_FLOATS], 0.f, 0.f, 0.f);
+            __m256 sized = _mm256_mul_ps(g, scale);
+            __m256 t     = _mm256_mul_ps(sized, half);
+            __m256 p     = _mm256_add_ps(_mm256_add_ps(t, _mm256_permute_ps(t, _MM_SHUFFLE(3, 2, 3, 2))), _mm256_add_ps(base, pen));
+
+            __m256 a = _mm256_shuffle_ps(p, _mm256_unpacklo_ps(z, sized), _MM_SHUFFLE(1, 0, 1, 0));                                                                   // px py pz sx
+            __m256 b = _mm256_shuffle_ps(_mm256_unpacklo_ps(_mm256_permute_ps(sized, _MM_SHUFFLE(1, 1, 1, 1)), zero), _mm256_unpacklo_ps(color, uv), _MM_SHUFFLE(1, 0, 1, 0)); // sy 0 C u0
+            __m256 c = _mm256_shuffle_ps(uv, _mm256_unpackhi_ps(uv, uvs), _MM_SHUFFLE(3, 2, 2, 1));                                                                  // v0 u1 v1 UV
+
+            _mm256_storeu_ps(dst + 0, _mm256_permute2f128_ps(a, b, 0x20));
+            _mm_storeu_ps(dst + 8, _mm256_castps256_ps128(c));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 12), k.tail);
+            _mm256_storeu_ps(dst + INSTANCE_WORDS + 0, _mm256_permute2f128_ps(a, b, 0x31));
+            _mm_storeu_ps(dst + INSTANCE_WORDS + 8, _mm256_extractf128_ps(c, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + INSTANCE_WORDS + 12), k.tail);
+        }
+        if (i < glyphs.size()) {
+            write_glyph_sse(src, dst, k);
+        }
+    }
+
+#endif
+
+    void write_quads(std::span<const Quad> quads, QuadInstance* out, bool flat) {
+        switch (simd_level()) {
+#ifdef ABY_SIMD_X86
+            case ESimd::AVX2:
+                return write_quads_avx2(quads, out, flat);
+            case ESimd::SSE4_1:
+                return write_quads_sse(quads, out, flat);
+#endif
+            default:
+                return write_quads_scalar(quads, out, flat);
+        }
+    }
+
+    void write_glyphs(std::span<const GlyphQuad> glyphs, const GlyphRun& run, QuadInstance* out) {
+        switch (simd_level()) {
+#ifdef ABY_SIMD_X86
+            case ESimd::AVX2:
+                return write_glyphs_avx2(glyphs, run, out);
+            case ESimd::SSE4_1:
+                return write_glyphs_sse(glyphs, run, out);
+#endif
+            default:
+                return write_glyphs_scalar(glyphs, run, out);
+        }
+    }
+
+}
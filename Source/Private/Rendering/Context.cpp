@@ -13,20 +13,37 @@ namespace aby {
         m_Shaders{},
         m_Textures{},
         m_Fonts{},
-        m_LoadThread([this](EResource type) -> Resource::Handle {
+        m_Loader(app->jobs(), [this](EResource type) -> Resource::Handle {
             switch (type) {
                 using enum EResource;
                 case SHADER:
-                    return static_cast<Resource::Handle>(this->shaders().size());
+                    return this->shaders().reserve();
                 case TEXTURE:
-                    return static_cast<Resource::Handle>(this->textures().size());
+                    return this->textures().reserve();
                 case FONT:
-                    return static_cast<Resource::Handle>(this->fonts().size());
+                    return this->fonts().reserve();
                 case MAX_ENUM:
                 case NONE:
                 default:
                     throw std::runtime_error("Resource must have a type");
             }
+        }, [this](Resource resource) {
+            switch (resource.type()) {
+                using enum EResource;
+                case SHADER:
+                    this->shaders().fail(resource);
+                    break;
+                case TEXTURE:
+                    this->textures().fail(resource);
+                    break;
+                case FONT:
+                    this->fonts().fail(resource);
+                    break;
+                case MAX_ENUM:
+                case NONE:
+                default:
+                    break;
+            }
         })
     {
 
@@ -77,12 +94,25 @@ namespace aby {
         return m_Fonts;
     }
     
-    LoadThread& Context::load_thread() {
-        return m_LoadThread;
+    ResourceLoader& Context::loader() {
+        return m_Loader;
     }
     
-    const LoadThread& Context::load_thread() const {
-        return m_LoadThread;
+    const ResourceLoader& Context::loader() const {
+        return m_Loader;
+    }
+
+    EResourceState Context::state(Resource resource) const {
+        switch (resource.type()) {
+            case EResource::SHADER:
+                return m_Shaders.state(resource);
+            case EResource::TEXTURE:
+                return m_Textures.state(resource);
+            case EResource::FONT:
+                return m_Fonts.state(resource);
+            default:
+                return EResourceState::NONE;
+        }
     }
 
 }
\ No newline at end of file
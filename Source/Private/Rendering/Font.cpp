@@ -1,37 +1,191 @@
 #include "Rendering/Font.h"
 #include "Rendering/Context.h"
 #include "Core/App.h"
-#include <stb_image/stb_image_write.h>
-#include <FT/abyft.h>
+#include "Utility/AtomicFile.h"
+#include "Utility/Utf8.h"
 #include <imgui/imgui.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
 
 namespace aby {
 
-    Resource Font::create(Context* ctx, const fs::path& path, u32 pt) {
-        return ctx->load_thread().add_task(EResource::FONT, [ctx, path, pt]() {
+    // The FreeType library handle is shared, font loads can run on any worker.
+    static std::mutex s_FtMutex;
+
+    // Code points rasterized when the font loads, into Font::texture().
+    static constexpr char32_t PREBAKED_FIRST = 32;
+    static constexpr char32_t PREBAKED_LAST  = 128; // Exclusive
+
+    // Every face is opened with this library, it rasterizes the prebaked range and the glyphs outside it.
+    static FT_Library rasterizer() {
+        static FT_Library library = []() {
+            FT_Library lib = nullptr;
+            if (FT_Init_FreeType(&lib) != 0) {
+                throw std::runtime_error("[FreeType::FT_Init_FreeType]: Failed to initialize");
+            }
+            // Outline ("sdf") and bitmap ("bsdf") glyphs, FreeType pads the field by the spread on every side.
+            FT_Int spread = static_cast<FT_Int>(Font::SDF_SPREAD);
+            FT_Property_Set(lib, "sdf", "spread", &spread);
+            FT_Property_Set(lib, "bsdf", "spread", &spread);
+            return lib;
+        }();
+        return library;
+    }
+
+    static FT_Face open_face(const fs::path& path, const glm::vec2& dpi, u32 pt, EFontMode mode) {
+        std::lock_guard lock(s_FtMutex);
+        auto    str  = path.string();
+        FT_Face face = nullptr;
+        if (FT_New_Face(rasterizer(), str.c_str(), 0, &face) != 0) {
+            throw std::runtime_error(std::format("[FreeType::FT_New_Face]: Failed to open {}", str));
+        }
+        if (mode == EFontMode::SDF) {
+            FT_Set_Pixel_Sizes(face, 0, Font::SDF_SIZE);
+        }
+        else {
+            // Same size as the prebaked glyphs, see prebake().
+            FT_Set_Char_Size(face, 0, static_cast<FT_F26Dot6>(pt) * 64, static_cast<FT_UInt>(dpi.x), static_cast<FT_UInt>(dpi.y));
+        }
+        return face;
+    }
+
+    struct RenderedGlyph {
+        FontGlyph        glyph;  // Page MISSING, EMPTY or 0 with the pixels in bitmap, uv_rect is up to the caller
+        const FT_Bitmap* bitmap;
+        const std::byte* top;    // First row of bitmap, rows are bitmap->pitch bytes apart
+        u32              inset;  // Texels of bitmap around glyph.size on every side
+    };
+
+    // Renders into face->glyph, the caller holds s_FtMutex. Metrics are scaled to the font's size.
+    static RenderedGlyph render_glyph(FT_Face face, char32_t c, EFontMode mode, float scale) {
+        RenderedGlyph out{
+            .glyph  = FontGlyph{ .size = {}, .bearing = {}, .advance = 0.f, .uv_rect = {}, .page = FontGlyph::MISSING },
+            .bitmap = nullptr,
+            .top    = nullptr,
+            .inset  = 0,
+        };
+        const bool    sdf   = mode == EFontMode::SDF;
+        const FT_UInt index = FT_Get_Char_Index(face, c);
+        if (index == 0 || FT_Load_Glyph(face, index, FT_LOAD_DEFAULT) != 0) {
+            return out;
+        }
+        const FT_GlyphSlot slot  = face->glyph;
+        // Whitespace has no outline, only an advance.
+        const bool         blank = slot->format == FT_GLYPH_FORMAT_OUTLINE && slot->outline.n_points == 0;
+        if (!blank && (FT_Render_Glyph(slot, sdf ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL) != 0 || slot->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)) {
+            return out;
+        }
+        const FT_Bitmap& bitmap = slot->bitmap;
+        out.glyph.advance = static_cast<float>(slot->advance.x) / 64.f * scale;
+        if (blank || bitmap.width == 0 || bitmap.rows == 0) {
+            out.glyph.page = FontGlyph::EMPTY;
+            return out;
+        }
+        // A negative pitch means the rows are stored bottom up.
+        out.top = reinterpret_cast<const std::byte*>(bitmap.buffer);
+        if (bitmap.pitch < 0) {
+            out.top -= static_cast<std::ptrdiff_t>(bitmap.rows - 1) * bitmap.pitch;
+        }
+        // A distance field is padded by the spread, the quad keeps one texel of it for the antialiased edge.
+        out.inset         = sdf ? std::min({ Font::SDF_SPREAD - 1, bitmap.width / 2, bitmap.rows / 2 }) : 0;
+        out.bitmap        = &bitmap;
+        out.glyph.size    = glm::vec2(bitmap.width - 2 * out.inset, bitmap.rows - 2 * out.inset) * scale;
+        out.glyph.bearing = glm::vec2(slot->bitmap_left + static_cast<i32>(out.inset), slot->bitmap_top - static_cast<i32>(out.inset)) * scale;
+        out.glyph.page    = 0;
+        return out;
+    }
+
+    // Metrics of c without rendering it, what render_glyph would report for a distance field.
+    // The caller holds s_FtMutex.
+    static FontGlyph outline_glyph(FT_Face face, char32_t c, float scale) {
+        FontGlyph glyph{ .size = {}, .bearing = {}, .advance = 0.f, .uv_rect = {}, .page = FontGlyph::MISSING };
+        const FT_UInt index = FT_Get_Char_Index(face, c);
+        if (index == 0 || FT_Load_Glyph(face, index, FT_LOAD_NO_BITMAP) != 0) {
+            return glyph;
+        }
+        const FT_Glyph_Metrics& metrics = face->glyph->metrics;
+        glyph.advance = static_cast<float>(face->glyph->advance.x) / 64.f * scale;
+        if (metrics.width == 0 || metrics.height == 0) {
+            glyph.page = FontGlyph::EMPTY;
+            return glyph;
+        }
+        // The quad keeps one texel of the spread on every side, see render_glyph.
+        const glm::vec2 size(static_cast<float>(metrics.width) / 64.f, static_cast<float>(metrics.height) / 64.f);
+        const glm::vec2 bearing(static_cast<float>(metrics.horiBearingX) / 64.f, static_cast<float>(metrics.horiBearingY) / 64.f);
+        glyph.size    = (size + 2.f) * scale;
+        glyph.bearing = (bearing + glm::vec2(-1.f, 1.f)) * scale;
+        glyph.page    = FontGlyph::EVICTED;
+        return glyph;
+    }
+
+    // One blob per file, size, dpi and mode.
+    static fs::path blob_path(Context* ctx, const fs::path& path, const glm::vec2& dpi, u32 pt, EFontMode mode) {
+        return ctx->app()->cache() / "Fonts" / std::format("{}-{}pt-{}x{}{}.atlas",
+            path.stem().string(), pt, static_cast<u32>(dpi.x), static_cast<u32>(dpi.y), mode == EFontMode::SDF ? "-sdf" : "");
+    }
+
+    Resource Font::create(Context* ctx, const fs::path& path, u32 pt, EFontMode mode) {
+        auto&    loader = ctx->loader();
+        Resource font   = loader.reserve(EResource::FONT);
+        Resource atlas  = loader.reserve(EResource::TEXTURE);
+        loader.add_task(font, [ctx, path, pt, mode, atlas](Resource resource) {
             Timer timer;
-            auto font = CreateRefEnabler<Font>::create(ctx, path, ctx->window()->dpi(), pt);
+            auto font_obj = CreateRefEnabler<Font>::create(ctx, path, ctx->window()->dpi(), pt, mode, atlas);
             ABY_LOG("Loaded Font: {}ms", timer.elapsed().milli());
-            ABY_LOG("  Name: \"{}\"", font->name());
-            ABY_LOG("  Size:  {}pt", font->size());
-            return ctx->fonts().add(font);
+            ABY_LOG("  Name: \"{}\"", font_obj->name());
+            ABY_LOG("  Size:  {}pt", font_obj->size());
+            ABY_LOG("  Mode:  {}", mode == EFontMode::SDF ? "SDF" : "Bitmap");
+            ctx->fonts().add(resource, font_obj);
         });
+        // The atlas pixels are produced by the font load, upload them as soon as that finished.
+        loader.add_async_task(atlas, [ctx, font](Resource resource, ResourceLoader::Done done) {
+            auto font_obj = ctx->fonts().at(font);
+            auto pixels   = std::exchange(font_obj->m_Pixels, {});
+            Texture::load(ctx, resource, font_obj->m_PixelsSize, pixels, 1, std::move(done));
+        }, { font });
+        return font;
     }
 
-    Font::Font(Context* ctx, const fs::path& path, const glm::vec2& dpi, u32 pt) :
+    Font::Font(Context* ctx, const fs::path& path, const glm::vec2& dpi, u32 pt, EFontMode mode, Resource atlas) :
         m_SizePt(pt),
-        m_Data(ft::Library::get().create_font_data(ctx->app()->cache(), ft::FontCfg{
-            .pt      = pt, 
-            .dpi     = { dpi.x, dpi.y }, 
-            .range   = ft::CharRange(32, 128),
-            .path    = path,
-            .verbose = true,
-        }))
+        m_Mode(mode),
+        m_SdfScale(static_cast<float>(pt) * dpi.y / 72.f / static_cast<float>(SDF_SIZE)),
+        m_Name(),
+        m_TextHeight(0.f),
+        m_IsMono(false),
+        m_Table(),
+        m_Atlas(ctx),
+        m_Face(open_face(path, dpi, pt, mode)),
+        m_Texture(atlas),
+        m_PixelsSize(1, 1),
+        m_Pixels(1)
     {
-        m_Texture            = Texture::create(ctx, m_Data.png);
+        const fs::path blob = blob_path(ctx, path, dpi, pt, mode);
+        if (!load(blob, path)) {
+            // Everything comes from m_Face, the prebaked range is rendered once (bitmap) or not at all (SDF).
+            describe(path);
+            if (m_Mode == EFontMode::BITMAP) {
+                prebake();
+            }
+            save(blob, path);
+        }
+        m_Atlas.on_evict([this](u32 page) {
+            for (auto& glyph : m_Table) {
+                if (glyph.page == page) {
+                    glyph.page = FontGlyph::EVICTED;
+                }
+            }
+        });
     }
 
     Font::~Font() {
+        std::lock_guard lock(s_FtMutex);
+        FT_Done_Face(m_Face);
     }
 
 
@@ -44,39 +198,276 @@ namespace aby {
     }
 
     std::string_view Font::name() const {
-        return m_Data.name;
+        return m_Name;
     }
 
-    const ft::Glyphs& Font::glyphs() const {
-        return m_Data.glyphs;
+    const GlyphTable& Font::glyph_table() const {
+        return m_Table;
     }
     
+    const FontGlyph* Font::glyph(char32_t c) {
+        FontGlyph* glyph = m_Table.find(c);
+        if (glyph && glyph->page == FontGlyph::MISSING) {
+            return nullptr;
+        }
+        if (glyph && glyph->resident()) {
+            if (glyph->page < m_Atlas.pages()) {
+                m_Atlas.touch(glyph->page);
+            }
+            return glyph;
+        }
+        return rasterize(c);
+    }
+
+    GlyphAtlas& Font::atlas() {
+        return m_Atlas;
+    }
+
+    EFontMode Font::mode() const {
+        return m_Mode;
+    }
+
+    const FontGlyph* Font::rasterize(char32_t c) {
+        std::lock_guard lock(s_FtMutex);
+        RenderedGlyph rendered = render_glyph(m_Face, c, m_Mode, m_Mode == EFontMode::SDF ? m_SdfScale : 1.f);
+        FontGlyph&    glyph    = rendered.glyph;
+        if (glyph.page == FontGlyph::MISSING) {
+            m_Table.insert(c, glyph);
+            return nullptr;
+        }
+        if (glyph.page == FontGlyph::EMPTY) {
+            return &m_Table.insert(c, glyph);
+        }
+
+        const FT_Bitmap& bitmap = *rendered.bitmap;
+        auto region = m_Atlas.allocate({ bitmap.width, bitmap.rows });
+        if (!region) {
+            // Retried on the next use, the advance is still good for measuring.
+            glyph.page = FontGlyph::EVICTED;
+            m_Table.insert(c, glyph);
+            return nullptr;
+        }
+        m_Atlas.write(*region, rendered.top, bitmap.pitch);
+
+        const glm::vec2 texel = glm::vec2(1.f) / glm::vec2(GlyphAtlas::PAGE_SIZE);
+        glyph.uv_rect = region->uv_rect + glm::vec4(texel, -texel) * static_cast<float>(rendered.inset);
+        glyph.page    = region->page;
+        return &m_Table.insert(c, glyph);
+    }
+
+    void Font::describe(const fs::path& path) {
+        std::lock_guard lock(s_FtMutex);
+        const float scale = m_Mode == EFontMode::SDF ? m_SdfScale : 1.f;
+        m_Name       = m_Face->family_name ? m_Face->family_name : path.stem().string();
+        m_IsMono     = FT_IS_FIXED_WIDTH(m_Face);
+        m_TextHeight = static_cast<float>(m_Face->size->metrics.height) / 64.f * scale;
+        if (m_Mode == EFontMode::SDF) {
+            // Rasterized on first use, until then the metrics are enough for measuring.
+            for (char32_t c = PREBAKED_FIRST; c < PREBAKED_LAST; c++) {
+                m_Table.insert(c, outline_glyph(m_Face, c, scale));
+            }
+        }
+    }
+
+    void Font::prebake() {
+        struct Bitmap {
+            char32_t               code;
+            FontGlyph              glyph;
+            glm::u32vec2           size;
+            std::vector<std::byte> pixels;
+        };
+        std::vector<Bitmap> bitmaps;
+        {
+            std::lock_guard lock(s_FtMutex);
+            for (char32_t c = PREBAKED_FIRST; c < PREBAKED_LAST; c++) {
+                RenderedGlyph rendered = render_glyph(m_Face, c, m_Mode, 1.f);
+                if (rendered.glyph.page != 0) {
+                    m_Table.insert(c, rendered.glyph);
+                    continue;
+                }
+                const FT_Bitmap& bitmap = *rendered.bitmap;
+                Bitmap& out = bitmaps.emplace_back(Bitmap{ c, rendered.glyph, { bitmap.width, bitmap.rows }, {} });
+                out.pixels.resize(static_cast<std::size_t>(bitmap.width) * bitmap.rows);
+                for (u32 row = 0; row < bitmap.rows; row++) {
+                    std::memcpy(out.pixels.data() + static_cast<std::size_t>(row) * bitmap.width,
+                        rendered.top + static_cast<std::ptrdiff_t>(row) * bitmap.pitch, bitmap.width);
+                }
+            }
+        }
+
+        // Tallest first, then grow the smaller side until everything fits. Padding on the top and left
+        // like GlyphAtlas, so row and column 0 stay empty for the repeating sampler.
+        std::sort(bitmaps.begin(), bitmaps.end(), [](const Bitmap& a, const Bitmap& b) { return a.size.y > b.size.y; });
+        glm::u32vec2              size(64, 64);
+        std::vector<glm::u32vec2> offsets;
+        for (bool packed = false; !packed;) {
+            SkylinePacker packer(size);
+            offsets.clear();
+            packed = true;
+            for (const Bitmap& bitmap : bitmaps) {
+                auto corner = packer.pack(bitmap.size + GlyphAtlas::PADDING);
+                if (!corner) {
+                    packed = false;
+                    (size.x <= size.y ? size.x : size.y) *= 2;
+                    break;
+                }
+                offsets.push_back(*corner + GlyphAtlas::PADDING);
+            }
+        }
+
+        m_PixelsSize = size;
+        m_Pixels.assign(static_cast<std::size_t>(size.x) * size.y, std::byte{ 0 });
+        const glm::vec2 extent = size;
+        for (std::size_t i = 0; i < bitmaps.size(); i++) {
+            const Bitmap&       bitmap = bitmaps[i];
+            const glm::u32vec2& offset = offsets[i];
+            for (u32 row = 0; row < bitmap.size.y; row++) {
+                std::memcpy(m_Pixels.data() + static_cast<std::size_t>(offset.y + row) * size.x + offset.x,
+                    bitmap.pixels.data() + static_cast<std::size_t>(row) * bitmap.size.x, bitmap.size.x);
+            }
+            FontGlyph glyph = bitmap.glyph;
+            glyph.uv_rect   = glm::vec4(glm::vec2(offset) / extent, glm::vec2(offset + bitmap.size) / extent);
+            glyph.page      = FontGlyph::PREBAKED;
+            m_Table.insert(bitmap.code, glyph);
+        }
+    }
+
+    // Raw prebaked glyphs of one font, uploaded as is on the next start.
+    // Layout: header, name, header.glyphs BlobGlyph records, header.size.x * header.size.y pixels.
+    struct BlobHeader {
+        static constexpr u32 MAGIC   = 0x46594241; // "ABYF"
+        static constexpr u32 VERSION = 2; // 2: metrics read from the face instead of ft::Library
+
+        u32          magic;
+        u32          version;
+        u64          source_size;
+        i64          source_time; // Font file's last write, the blob is stale once it changes
+        float        text_height;
+        u32          is_mono;
+        glm::u32vec2 size;
+        u32          glyphs;
+        u32          name_length;
+    };
+
+    struct BlobGlyph {
+        char32_t  code;
+        FontGlyph glyph;
+    };
+
+    bool Font::load(const fs::path& blob, const fs::path& source) {
+        std::error_code ec;
+        const u64 source_size = fs::file_size(source, ec);
+        const i64 source_time = ec ? 0 : fs::last_write_time(source, ec).time_since_epoch().count();
+        const u64 blob_size = ec ? 0 : fs::file_size(blob, ec);
+        std::ifstream in(blob, std::ios::binary);
+        if (ec || !in || blob_size < sizeof(BlobHeader)) {
+            return false;
+        }
+        BlobHeader header{};
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in || header.magic != BlobHeader::MAGIC || header.version != BlobHeader::VERSION ||
+            header.source_size != source_size || header.source_time != source_time) {
+            return false;
+        }
+        // Rejects corrupt counts before anything is allocated for them.
+        u64 remaining = blob_size - sizeof(BlobHeader);
+        for (u64 bytes : { u64{ header.name_length }, u64{ header.glyphs } * sizeof(BlobGlyph), u64{ header.size.x } * header.size.y }) {
+            if (bytes > remaining) {
+                return false;
+            }
+            remaining -= bytes;
+        }
+
+        std::string            name(header.name_length, '\0');
+        std::vector<BlobGlyph> glyphs(header.glyphs);
+        std::vector<std::byte> pixels(static_cast<std::size_t>(header.size.x) * header.size.y);
+        in.read(name.data(), name.size());
+        in.read(reinterpret_cast<char*>(glyphs.data()), glyphs.size() * sizeof(BlobGlyph));
+        in.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+        if (!in) {
+            return false;
+        }
+
+        m_Name       = std::move(name);
+        m_TextHeight = header.text_height;
+        m_IsMono     = header.is_mono != 0;
+        for (const BlobGlyph& g : glyphs) {
+            m_Table.insert(g.code, g.glyph);
+        }
+        if (!pixels.empty()) {
+            m_PixelsSize = header.size;
+            m_Pixels     = std::move(pixels);
+        }
+        return true;
+    }
+
+    void Font::save(const fs::path& blob, const fs::path& source) const {
+        std::error_code ec;
+        fs::create_directories(blob.parent_path(), ec);
+        const u64 source_size = fs::file_size(source, ec);
+        const i64 source_time = ec ? 0 : fs::last_write_time(source, ec).time_since_epoch().count();
+        if (ec) {
+            return;
+        }
+
+        std::vector<BlobGlyph> glyphs;
+        for (char32_t c = PREBAKED_FIRST; c < PREBAKED_LAST; c++) {
+            if (const FontGlyph* glyph = m_Table.find(c)) {
+                glyphs.push_back(BlobGlyph{ c, *glyph });
+            }
+        }
+        // Distance field fonts have no prebaked pixels, m_Pixels is the 1x1 placeholder.
+        const bool pixels = m_Mode == EFontMode::BITMAP;
+        const BlobHeader header{
+            .magic       = BlobHeader::MAGIC,
+            .version     = BlobHeader::VERSION,
+            .source_size = source_size,
+            .source_time = source_time,
+            .text_height = m_TextHeight,
+            .is_mono     = m_IsMono ? 1u : 0u,
+            .size        = pixels ? m_PixelsSize : glm::u32vec2(0, 0),
+            .glyphs      = static_cast<u32>(glyphs.size()),
+            .name_length = static_cast<u32>(m_Name.size()),
+        };
+
+        // Written atomically, a font loading in parallel never reads half a file.
+        ec = util::write_atomic(blob, [&](std::ostream& out) {
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(m_Name.data(), m_Name.size());
+            out.write(reinterpret_cast<const char*>(glyphs.data()), glyphs.size() * sizeof(BlobGlyph));
+            if (pixels) {
+                out.write(reinterpret_cast<const char*>(m_Pixels.data()), m_Pixels.size());
+            }
+        });
+        if (ec) {
+            IF_DBG(ABY_WARN("Font: could not write {}", blob), ;);
+        }
+    }
+
     bool Font::is_mono() const {
-        return m_Data.is_mono;
+        return m_IsMono;
     }
     float Font::text_height() const {
-        return m_Data.text_height;
+        return m_TextHeight;
     }
 
     float Font::char_width() const {
-        ABY_ASSERT(m_Data.is_mono, "Font is not monospaced! Do not call Font::char_width()");
-        return m_Data.glyphs.at(U'a').size.x;
+        ABY_ASSERT(m_IsMono, "Font is not monospaced! Do not call Font::char_width()");
+        return m_Table.at(U'a').size.x;
     }
 
 
     glm::vec2 Font::measure(const std::string& text) const {
-        glm::vec2 size(0, m_Data.text_height);
-        if (m_Data.is_mono) {
-            size.x = text.length() * m_Data.glyphs.at(U'a').size.x;
+        glm::vec2 size(0, m_TextHeight);
+        if (m_IsMono) {
+            size.x = util::utf8_length(text) * m_Table.at(U'a').size.x;
             return size;
         }
-        for (std::size_t i = 0; i < text.size(); i++) {
-            char32_t c = text[i];
-            if (auto it = m_Data.glyphs.find(c); it != m_Data.glyphs.end()) {
-                const auto& g = it->second;
-                size.x += g.advance;
+        util::for_each_codepoint(text, [this, &size](char32_t c) {
+            if (const FontGlyph* g = m_Table.find(c)) {
+                size.x += g->advance;
             }
-        }
+        });
         return size;
     }
 
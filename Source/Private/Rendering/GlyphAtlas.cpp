@@ -0,0 +1,247 @@
+#include "Rendering/GlyphAtlas.h"
+#include "Rendering/Context.h"
+#include "Rendering/Texture.h"
+#include "Core/Log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace aby {
+
+    SkylinePacker::SkylinePacker(const glm::u32vec2& size) :
+        m_Size(size),
+        m_Skyline{ Segment{ 0, 0, size.x } }
+    {
+    }
+
+    std::optional<u32> SkylinePacker::fit(std::size_t i, u32 w, u32 h) const {
+        const u32 x = m_Skyline[i].x;
+        if (x + w > m_Size.x) {
+            return std::nullopt;
+        }
+        // The rectangle rests on the highest segment below it.
+        u32 y    = 0;
+        u32 left = w;
+        for (std::size_t j = i; left > 0; j++) {
+            y    = std::max(y, m_Skyline[j].y);
+            left = left > m_Skyline[j].w ? left - m_Skyline[j].w : 0;
+        }
+        if (y + h > m_Size.y) {
+            return std::nullopt;
+        }
+        return y;
+    }
+
+    std::optional<glm::u32vec2> SkylinePacker::pack(const glm::u32vec2& size) {
+        if (size.x == 0 || size.y == 0) {
+            return glm::u32vec2(0, 0);
+        }
+        std::size_t best       = m_Skyline.size();
+        u32         best_top   = ~0u;
+        u32         best_width = ~0u;
+        u32         best_y     = 0;
+        for (std::size_t i = 0; i < m_Skyline.size(); i++) {
+            auto y = fit(i, size.x, size.y);
+            if (!y) {
+                continue;
+            }
+            const u32 top = *y + size.y;
+            if (top < best_top || (top == best_top && m_Skyline[i].w < best_width)) {
+                best       = i;
+                best_top   = top;
+                best_width = m_Skyline[i].w;
+                best_y     = *y;
+            }
+        }
+        if (best == m_Skyline.size()) {
+            return std::nullopt;
+        }
+
+        const u32 x = m_Skyline[best].x;
+        m_Skyline.insert(m_Skyline.begin() + best, Segment{ x, best_top, size.x });
+
+        // Cut the segments now covered by the new one.
+        const u32 right = x + size.x;
+        for (std::size_t i = best + 1; i < m_Skyline.size();) {
+            Segment& s = m_Skyline[i];
+            if (s.x >= right) {
+                break;
+            }
+            if (s.x + s.w <= right) {
+                m_Skyline.erase(m_Skyline.begin() + i);
+                continue;
+            }
+            s.w -= right - s.x;
+            s.x  = right;
+            break;
+        }
+        // Merge neighbours of equal height.
+        for (std::size_t i = 0; i + 1 < m_Skyline.size();) {
+            if (m_Skyline[i].y == m_Skyline[i + 1].y) {
+                m_Skyline[i].w += m_Skyline[i + 1].w;
+                m_Skyline.erase(m_Skyline.begin() + i + 1);
+                continue;
+            }
+            i++;
+        }
+        return glm::u32vec2(x, best_y);
+    }
+
+    void SkylinePacker::clear() {
+        m_Skyline.assign(1, Segment{ 0, 0, m_Size.x });
+    }
+
+}
+
+namespace aby {
+
+    static constexpr std::size_t PAGE_BYTES = static_cast<std::size_t>(GlyphAtlas::PAGE_SIZE.x) * GlyphAtlas::PAGE_SIZE.y;
+
+    GlyphAtlas::GlyphAtlas(Context* ctx, std::size_t budget) :
+        m_Ctx(ctx),
+        m_Budget(budget),
+        m_Pages(),
+        m_Frame(0),
+        m_Generation(0),
+        m_OnEvict()
+    {
+    }
+
+    std::optional<GlyphAtlas::Region> GlyphAtlas::allocate(const glm::u32vec2& size) {
+        // Padding on the top and left of every glyph, the right and bottom neighbours (or the
+        // wrapped around first row and column, the sampler repeats) bring their own.
+        const glm::u32vec2 padded = size + PADDING;
+        if (padded.x > PAGE_SIZE.x || padded.y > PAGE_SIZE.y) {
+            return std::nullopt;
+        }
+
+        auto place = [this, &size, &padded](u32 page) -> std::optional<Region> {
+            auto corner = m_Pages[page].packer.pack(padded);
+            if (!corner) {
+                return std::nullopt;
+            }
+            m_Pages[page].last_used = m_Frame;
+            const glm::u32vec2 offset = *corner + PADDING;
+            const glm::vec2    extent = PAGE_SIZE;
+            return Region{
+                .page    = page,
+                .offset  = offset,
+                .size    = size,
+                .uv_rect = glm::vec4(glm::vec2(offset) / extent, glm::vec2(offset + size) / extent),
+            };
+        };
+
+        for (u32 page = 0; page < m_Pages.size(); page++) {
+            if (auto region = place(page)) {
+                return region;
+            }
+        }
+
+        std::optional<u32> page;
+        if (m_Pages.empty() || (m_Pages.size() + 1) * PAGE_BYTES <= m_Budget) {
+            page = add_page();
+        }
+        else {
+            page = evict();
+        }
+        if (!page) {
+            return std::nullopt;
+        }
+        return place(*page);
+    }
+
+    void GlyphAtlas::write(const Region& region, const std::byte* pixels, i32 pitch) {
+        Page& page = m_Pages[region.page];
+        for (u32 row = 0; row < region.size.y; row++) {
+            std::byte* dst = page.pixels.data() + static_cast<std::size_t>(region.offset.y + row) * PAGE_SIZE.x + region.offset.x;
+            std::memcpy(dst, pixels + static_cast<std::ptrdiff_t>(row) * pitch, region.size.x);
+        }
+        mark_dirty(page, region.offset, region.offset + region.size);
+    }
+
+    void GlyphAtlas::touch(u32 page) {
+        m_Pages[page].last_used = m_Frame;
+    }
+
+    void GlyphAtlas::upload(const Upload& upload) {
+        for (auto& page : m_Pages) {
+            if (page.dirty_max.x <= page.dirty_min.x || page.dirty_max.y <= page.dirty_min.y) {
+                continue;
+            }
+            const std::size_t first  = static_cast<std::size_t>(page.dirty_min.y) * PAGE_SIZE.x + page.dirty_min.x;
+            auto              pixels = std::span<const std::byte>(page.pixels).subspan(first);
+            if (upload(page.texture, page.dirty_min, page.dirty_max - page.dirty_min, pixels)) {
+                page.dirty_min = PAGE_SIZE;
+                page.dirty_max = { 0, 0 };
+            }
+        }
+    }
+
+    void GlyphAtlas::next_frame() {
+        m_Frame++;
+    }
+
+    void GlyphAtlas::on_evict(OnEvict&& callback) {
+        m_OnEvict = std::move(callback);
+    }
+
+    Resource GlyphAtlas::texture(u32 page) const {
+        return m_Pages[page].texture;
+    }
+
+    std::size_t GlyphAtlas::pages() const {
+        return m_Pages.size();
+    }
+
+    std::size_t GlyphAtlas::bytes() const {
+        return m_Pages.size() * PAGE_BYTES;
+    }
+
+    u64 GlyphAtlas::generation() const {
+        return m_Generation;
+    }
+
+    u32 GlyphAtlas::add_page() {
+        std::vector<std::byte> pixels(PAGE_BYTES);
+        m_Pages.push_back(Page{
+            .texture   = Texture::create(m_Ctx, PAGE_SIZE, pixels, 1),
+            .pixels    = std::move(pixels),
+            .packer    = SkylinePacker(PAGE_SIZE),
+            .dirty_min = PAGE_SIZE,
+            .dirty_max = { 0, 0 },
+            .last_used = m_Frame,
+        });
+        return static_cast<u32>(m_Pages.size() - 1);
+    }
+
+    std::optional<u32> GlyphAtlas::evict() {
+        std::optional<u32> lru;
+        for (u32 i = 0; i < m_Pages.size(); i++) {
+            const u64 last_used = m_Pages[i].last_used;
+            if (last_used < m_Frame && (!lru || last_used < m_Pages[*lru].last_used)) {
+                lru = i;
+            }
+        }
+        if (!lru) {
+            IF_DBG(ABY_WARN("GlyphAtlas: every page was used this frame, raise the budget ({} bytes)", m_Budget), ;);
+            return std::nullopt;
+        }
+        if (m_OnEvict) {
+            m_OnEvict(*lru);
+        }
+        // The copy into the texture is recorded before this frame's draws, the GPU is done with
+        // the old glyphs by then (same queue), see RenderModule::upload_glyphs.
+        Page& page = m_Pages[*lru];
+        page.packer.clear();
+        std::fill(page.pixels.begin(), page.pixels.end(), std::byte{ 0 });
+        mark_dirty(page, { 0, 0 }, PAGE_SIZE);
+        page.last_used = m_Frame;
+        m_Generation++;
+        return lru;
+    }
+
+    void GlyphAtlas::mark_dirty(Page& page, const glm::u32vec2& min, const glm::u32vec2& max) {
+        page.dirty_min = glm::min(page.dirty_min, min);
+        page.dirty_max = glm::max(page.dirty_max, max);
+    }
+
+}
@@ -0,0 +1,70 @@
+#include "Rendering/GlyphTable.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+namespace aby {
+
+    GlyphTable::GlyphTable() :
+        m_Glyphs(),
+        m_Direct(),
+        m_Slots(),
+        m_Wide(0),
+        m_Shift(64)
+    {
+        m_Direct.fill(NONE);
+    }
+
+    const FontGlyph& GlyphTable::at(char32_t c) const {
+        const FontGlyph* glyph = find(c);
+        if (!glyph) {
+            throw std::out_of_range("GlyphTable::at");
+        }
+        return *glyph;
+    }
+
+    FontGlyph& GlyphTable::insert(char32_t c, const FontGlyph& glyph) {
+        if (FontGlyph* existing = find(c)) {
+            *existing = glyph;
+            return *existing;
+        }
+        if (c >= DIRECT_RANGE && (m_Wide + 1) * 2 > m_Slots.size()) {
+            rehash(std::max<std::size_t>(m_Slots.size() * 2, 16));
+        }
+        const u32 index = static_cast<u32>(m_Glyphs.size());
+        m_Glyphs.push_back(glyph);
+        place(c, index);
+        return m_Glyphs.back();
+    }
+
+    std::size_t GlyphTable::size() const {
+        return m_Glyphs.size();
+    }
+
+    void GlyphTable::rehash(std::size_t capacity) {
+        std::vector<Slot> old = std::exchange(m_Slots, std::vector<Slot>(capacity, Slot{ 0, NONE }));
+        m_Shift = 64 - static_cast<u32>(std::countr_zero(capacity));
+        m_Wide  = 0;
+        for (const Slot& s : old) {
+            if (s.code != 0) {
+                place(s.code, s.index);
+            }
+        }
+    }
+
+    void GlyphTable::place(char32_t c, u32 index) {
+        if (c < DIRECT_RANGE) {
+            m_Direct[c] = index;
+            return;
+        }
+        const u32 mask = static_cast<u32>(m_Slots.size() - 1);
+        u32 i = slot(c);
+        while (m_Slots[i].code != 0) {
+            i = (i + 1) & mask;
+        }
+        m_Slots[i] = Slot{ c, index };
+        m_Wide++;
+    }
+
+}
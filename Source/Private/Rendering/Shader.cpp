@@ -23,8 +23,8 @@ namespace std {
 
 namespace aby {
 	
-	Shader::Shader(const std::vector<u32>& data, EShader type) : 
-		m_Type(type), m_Data(data)
+	Shader::Shader(std::vector<u32> data, EShader type) : 
+		m_Type(type), m_Data(std::move(data))
 	{
 		
 	}
@@ -32,13 +32,15 @@ namespace aby {
 	Resource Shader::create(Context* ctx, const fs::path& path, EShader type) {
 		switch (ctx->backend()) {
 			case EBackend::VULKAN: {
-				auto shader = vk::Shader::create(
-					ctx->app(),
-					static_cast<vk::Context*>(ctx)->devices(),
-					path,
-					type
-				);
-				return ctx->shaders().add(shader);
+				return ctx->loader().add_task(EResource::SHADER, [ctx, path, type](Resource resource) {
+					auto shader = vk::Shader::create(
+						ctx->app(),
+						static_cast<vk::Context*>(ctx)->devices(),
+						path,
+						type
+					);
+					ctx->shaders().add(resource, shader);
+				});
 			}
 			default:
 				ABY_ASSERT(false, "Ctx backend is invalid");
@@ -0,0 +1,224 @@
+#include "Rendering/TextLayout.h"
+#include "Utility/TagParser.h"
+#include "Utility/Utf8.h"
+#include <algorithm>
+#include <bit>
+#include <string_view>
+
+namespace aby {
+
+    static constexpr bool is_escape_character(char32_t c) {
+        switch (c) {
+            case 0x27: // '''
+            case 0x22: // '"'
+            case 0x3f: // '?'
+            case 0x5c: // '\'
+            case 0x07: // '\a'
+            case 0x08: // '\b'
+            case 0x0c: // '\f'
+            case 0x0a: // '\n'
+            case 0x0d: // '\r'
+            case 0x09: // '\t'
+            case 0x0b: // '\v'
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static GlyphQuad to_glyph_quad(const FontGlyph& g, float pen) {
+        return GlyphQuad{
+            .pen     = pen,
+            .size    = g.size,
+            .bearing = g.bearing,
+            .uv_rect = g.uv_rect,
+        };
+    }
+
+    /**
+    * @brief Reorder the glyphs so each page is one contiguous run, pages holds the page of every glyph.
+    *        Text rarely spans more than one or two pages.
+    */
+    static void group_by_page(TextLayout& layout, const std::vector<u32>& pages) {
+        if (pages.empty()) {
+            return;
+        }
+        if (std::all_of(pages.begin(), pages.end(), [&pages](u32 page) { return page == pages.front(); })) {
+            layout.runs.push_back(TextLayout::Run{ pages.front(), 0, static_cast<u32>(pages.size()) });
+            return;
+        }
+        std::vector<GlyphQuad> grouped;
+        grouped.reserve(layout.glyphs.size());
+        for (std::size_t i = 0; i < pages.size(); i++) {
+            const u32 page = pages[i];
+            if (std::find(pages.begin(), pages.begin() + i, page) != pages.begin() + i) {
+                continue; // Grouped with its first occurrence
+            }
+            const u32 first = static_cast<u32>(grouped.size());
+            for (std::size_t j = i; j < pages.size(); j++) {
+                if (pages[j] == page) {
+                    grouped.push_back(layout.glyphs[j]);
+                }
+            }
+            layout.runs.push_back(TextLayout::Run{ page, first, static_cast<u32>(grouped.size()) - first });
+        }
+        layout.glyphs = std::move(grouped);
+    }
+
+    /**
+    * @brief parse_and_strip_tags reports byte offsets into the stripped text, the layout counts code points.
+    */
+    static void to_codepoint_ranges(std::string_view text, std::vector<util::TextDecor>& decors) {
+        if (decors.empty() || util::ascii_run(text) == text.size()) {
+            return;
+        }
+        // Code point index of every byte, one past the end maps to the code point count.
+        std::vector<std::size_t> index(text.size() + 1);
+        std::size_t pos   = 0;
+        std::size_t count = 0;
+        while (pos < text.size()) {
+            const std::size_t begin = pos;
+            util::decode_utf8(text, pos);
+            std::fill(index.begin() + begin, index.begin() + pos, count++);
+        }
+        index.back() = count;
+        for (auto& decor : decors) {
+            decor.range.start = index[std::min(decor.range.start, text.size())];
+            decor.range.end   = decor.range.end == std::string::npos ? decor.range.end : index[std::min(decor.range.end, text.size())];
+        }
+    }
+
+    TextLayout layout_text(Font& font, const Text& text) {
+        const GlyphTable& glyphs = font.glyph_table();
+
+        TextLayout layout;
+        layout.generation = font.atlas().generation();
+
+        std::string stripped_text = text.prefix + text.text;
+        auto        text_decors   = util::parse_and_strip_tags(stripped_text);
+        to_codepoint_ranges(stripped_text, text_decors);
+        float       pen           = 0.f;
+        std::size_t cursor        = 0;
+        std::vector<u32> pages;
+
+        auto push_glyph = [&layout, &pages](const FontGlyph& glyph, float at) {
+            if (glyph.page == FontGlyph::EMPTY) {
+                return;
+            }
+            layout.glyphs.push_back(to_glyph_quad(glyph, at));
+            pages.push_back(glyph.page);
+        };
+
+        util::for_each_codepoint(stripped_text, [&](char32_t c) {
+            // Index of c, the decoration ranges count every code point.
+            const std::size_t index = cursor++;
+            // Skip escape characters
+            if (is_escape_character(c)) {
+                if (c == U'\t') {
+                    pen += (glyphs.at(U' ').advance * text.scale * 4);
+                }
+                return;
+            }
+            // Copied, rasterizing the decoration glyph may move the table.
+            const FontGlyph* found = font.glyph(c);
+            if (!found) {
+                if (const FontGlyph* g = glyphs.find(c); g && g->page == FontGlyph::EVICTED) {
+                    layout.generation = TextLayout::STALE; // No room in the atlas this frame, try again
+                }
+                return;
+            }
+            const FontGlyph glyph = *found;
+            push_glyph(glyph, pen);
+
+            for (auto& decor : text_decors) {
+                if (index >= decor.range.start && index <= decor.range.end) {
+                    switch (decor.type) {
+                    case util::ETextDecor::UNDERLINE: {
+                            const FontGlyph* decor_glyph = font.glyph(U'_');
+                            if (!decor_glyph) {
+                                IF_DBG(ABY_WARN("Font Glyph for character '{:#x}' not found", (int32_t)c), ;);
+                                continue;
+                            }
+                            push_glyph(*decor_glyph, pen);
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            pen += glyph.advance * text.scale;
+        });
+        group_by_page(layout, pages);
+
+        // Measured once every glyph was looked up, the ones rasterized above have metrics now.
+        layout.size = font.measure(text.text) * text.scale;
+
+        for (auto& decor : text_decors) {
+            if (decor.type != util::ETextDecor::HIGHLIGHT)
+                continue;
+
+            if (!font.is_mono())
+                throw std::runtime_error("TODO: Implement ETextDecoration::HIGHLIGHT for non mono fonts");
+
+            auto underline_start = glm::vec2{
+                font.char_width() * decor.range.start,
+                -2.f
+            };
+
+            auto underline_end = glm::vec2{
+                font.char_width() * (decor.range.end + 1),
+                0.f
+            };
+            layout.highlights.emplace_back(glm::vec2{ (underline_end - underline_start).x, layout.size.y + 4.f }, underline_start, glm::vec4{ 0.1, 0.1, 1.0, 1.f });
+        }
+        return layout;
+    }
+
+}
+
+namespace aby {
+
+    static u64 layout_key(const Text& text) {
+        u64 key = std::hash<std::string_view>{}(text.text);
+        auto mix = [&key](u64 value) {
+            key ^= value + 0x9e3779b97f4a7c15ull + (key << 6) + (key >> 2);
+        };
+        mix(std::hash<std::string_view>{}(text.prefix));
+        mix(text.font);
+        mix(std::bit_cast<u32>(text.scale));
+        return key;
+    }
+
+    const TextLayout& TextLayoutCache::get(const Ref<Font>& font, const Text& text) {
+        // The strings are compared on a hit, a colliding text replaces the entry instead of drawing the wrong glyphs.
+        Entry& entry = m_Entries[layout_key(text)];
+        entry.last_used = m_Frame;
+        if (entry.font.lock() == font && entry.layout.generation == font->atlas().generation() && entry.scale == text.scale && entry.text == text.text && entry.prefix == text.prefix) {
+            return entry.layout;
+        }
+        entry.layout = layout_text(*font, text); // May throw, the key fields are only updated after
+        entry.font   = font;
+        entry.prefix = text.prefix;
+        entry.text   = text.text;
+        entry.scale  = text.scale;
+        return entry.layout;
+    }
+
+    void TextLayoutCache::next_frame() {
+        m_Frame++;
+        std::erase_if(m_Entries, [this](const auto& pair) {
+            return m_Frame - pair.second.last_used > MAX_IDLE_FRAMES;
+        });
+    }
+
+    void TextLayoutCache::clear() {
+        m_Entries.clear();
+    }
+
+    std::size_t TextLayoutCache::size() const {
+        return m_Entries.size();
+    }
+
+}
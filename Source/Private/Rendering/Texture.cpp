@@ -5,31 +5,53 @@
 #include "Platform/vk/VkContext.h"
 #include <stb_image/stb_image.h>
 #include <array>
+#include <cstring>
 
 
 namespace aby {
 
-    Resource Texture::create(Context* ctx, const fs::path& path) {
+    Resource Texture::create(Context* ctx, const fs::path& path, bool retain_data) {
+        ABY_ASSERT(ctx, "(aby::Context*)ctx is invalid!");
+        return ctx->loader().add_async_task(EResource::TEXTURE, [ctx = ctx, path = path, retain_data](Resource resource, ResourceLoader::Done done) {
+            Texture::load(ctx, resource, path, std::move(done), retain_data);
+        });
+    }
+
+    void Texture::load(Context* ctx, Resource reserved, const fs::path& path, ResourceLoader::Done done, bool retain_data) {
         ABY_ASSERT(ctx, "(aby::Context*)ctx is invalid!");
         switch (ctx->backend()) {
             case EBackend::VULKAN: {
-                return ctx->load_thread().add_task(EResource::TEXTURE, [ctx = ctx, path = path]() {
-                    Timer timer;
-                    auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx), path);
-                    auto elapsed = timer.elapsed();
-                    ABY_LOG("Loaded Texture: {}ms", elapsed.milli());
-                    ABY_LOG("  Path:     {}", path);
-                    ABY_LOG("  Size:     ({}, {})", EXPAND_VEC2(tex->size()));
-                    ABY_LOG("  Channels: {}", tex->channels());
-                    ABY_LOG("  Bytes:    {}", tex->bytes());
-                    return ctx->textures().add(tex);
+                Timer timer;
+                auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx), path, retain_data);
+                auto elapsed = timer.elapsed();
+                ABY_LOG("Loaded Texture: {}ms", elapsed.milli());
+                ABY_LOG("  Path:     {}", path);
+                ABY_LOG("  Size:     ({}, {})", EXPAND_VEC2(tex->size()));
+                ABY_LOG("  Channels: {}", tex->channels());
+                ABY_LOG("  Bytes:    {}", tex->bytes());
+                upload(ctx, reserved, tex, std::move(done));
+                break;
+            }
+            default:
+                ABY_ASSERT(false, "Unsupported ctx backend");
+                break;
+        }
+    }
+
+    void Texture::upload(Context* ctx, Resource reserved, Ref<Texture> texture, ResourceLoader::Done done) {
+        switch (ctx->backend()) {
+            case EBackend::VULKAN: {
+                auto tex = std::static_pointer_cast<vk::Texture>(texture);
+                tex->upload(static_cast<vk::Context*>(ctx), [ctx, reserved, tex, done = std::move(done)]() {
+                    ctx->textures().add(reserved, tex);
+                    done(true);
                 });
+                break;
             }
             default:
                 ABY_ASSERT(false, "Unsupported ctx backend");
                 break;
         }
-        return {};
     }
 
     Resource Texture::create(Context* ctx) {
@@ -37,9 +59,9 @@ namespace aby {
         switch (ctx->backend()) {
             case EBackend::VULKAN:
             {
-                return ctx->load_thread().add_task(EResource::TEXTURE, [ctx]() {
+                return ctx->loader().add_task(EResource::TEXTURE, [ctx](Resource resource) {
                     auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx));
-                    return ctx->textures().add(tex);
+                    ctx->textures().add(resource, tex);
                 });
             }
             default:
@@ -53,7 +75,7 @@ namespace aby {
         switch (ctx->backend()) {
             case EBackend::VULKAN:
             {
-                return ctx->load_thread().add_task(EResource::TEXTURE, [ctx, size, color]() {
+                return ctx->loader().add_async_task(EResource::TEXTURE, [ctx, size, color](Resource resource, ResourceLoader::Done done) {
                     Timer timer;
                     auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx), size, color);
                     auto elapsed = timer.elapsed();
@@ -62,7 +84,7 @@ namespace aby {
                     ABY_LOG("  Size:     ({}, {})", EXPAND_VEC2(tex->size()));
                     ABY_LOG("  Channels: {}", tex->channels());
                     ABY_LOG("  Bytes:    {}", tex->bytes());
-                    return ctx->textures().add(tex);
+                    upload(ctx, resource, tex, std::move(done));
                 });
             }
             default:
@@ -78,15 +100,8 @@ namespace aby {
         switch (ctx->backend()) {
             case EBackend::VULKAN:
             {
-                return ctx->load_thread().add_task(EResource::TEXTURE, [ctx, size, data, channels]() {
-                    Timer timer;
-                    auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx), size, data, channels);
-                    auto elapsed = timer.elapsed();
-                    ABY_LOG("Loaded Texture: {}ms", elapsed.milli());
-                    ABY_LOG("  Size:     ({}, {})", EXPAND_VEC2(tex->size()));
-                    ABY_LOG("  Channels: {}", tex->channels());
-                    ABY_LOG("  Bytes:    {}", tex->bytes());
-                    return ctx->textures().add(tex);
+                return ctx->loader().add_async_task(EResource::TEXTURE, [ctx, size, data, channels](Resource resource, ResourceLoader::Done done) {
+                    Texture::load(ctx, resource, size, data, channels, std::move(done));
                 });
             }
             default:
@@ -96,60 +111,34 @@ namespace aby {
         return {};
     }
 
+    void Texture::load(Context* ctx, Resource reserved, const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels, ResourceLoader::Done done) {
+        ABY_ASSERT(ctx, "(aby::Context*)ctx is invalid!");
+        switch (ctx->backend()) {
+            case EBackend::VULKAN: {
+                Timer timer;
+                auto tex = create_ref<vk::Texture>(static_cast<vk::Context*>(ctx), size, data, channels);
+                auto elapsed = timer.elapsed();
+                ABY_LOG("Loaded Texture: {}ms", elapsed.milli());
+                ABY_LOG("  Size:     ({}, {})", EXPAND_VEC2(tex->size()));
+                ABY_LOG("  Channels: {}", tex->channels());
+                ABY_LOG("  Bytes:    {}", tex->bytes());
+                upload(ctx, reserved, tex, std::move(done));
+                break;
+            }
+            default:
+                ABY_ASSERT(false, "Unsupported ctx backend");
+                break;
+        }
+    }
+
     Texture::Texture() :
         m_Size(0, 0),
         m_Channels(0) { }
 
-    Texture::Texture(const fs::path& path) :
-        m_Size(0, 0),
-        m_Channels(0)
-    {
-        auto str = path.string();
-        const char* file = str.c_str();
-        int w, h, c;
-        constexpr int LOAD_ALL_CHANNELS = 0;
-
-        unsigned char* data = stbi_load(file, &w, &h, &c, LOAD_ALL_CHANNELS);
-        if (!data) {
-            ABY_ERR("[stbi_image::stbi_load]: {}", stbi_failure_reason());
-            return;  
-        }
-        auto ptr   = reinterpret_cast<std::byte*>(data);
-        m_Size.x   = static_cast<unsigned int>(w);
-        m_Size.y   = static_cast<unsigned int>(h);
-        m_Channels = static_cast<unsigned int>(c);
-        m_Data.assign(ptr, ptr + (w * h * c));
-        stbi_image_free(data);
-    }
-
-    Texture::Texture(const glm::u32vec2& size, const glm::vec4& color) :
-        m_Size(size),
-        m_Channels(4)  
-    {
-        size_t byte_count = m_Size.x * m_Size.y * m_Channels;
-        std::array<std::byte, 4> rgba = {
-            static_cast<std::byte>(static_cast<uint8_t>(color.r * 255.0f)),
-            static_cast<std::byte>(static_cast<uint8_t>(color.g * 255.0f)),
-            static_cast<std::byte>(static_cast<uint8_t>(color.b * 255.0f)),
-            static_cast<std::byte>(static_cast<uint8_t>(color.a * 255.0f))
-        };
-        m_Data.resize(byte_count);
-        for (size_t i = 0; i < byte_count; i += 4) {
-            m_Data[i + 0] = rgba[0];
-            m_Data[i + 1] = rgba[1];
-            m_Data[i + 2] = rgba[2];
-            m_Data[i + 3] = rgba[3];
-            //std::memcpy(&m_Data[i], rgba.data(), 4);
-        }
-    }
-    
-    Texture::Texture(const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels) :
+    Texture::Texture(const glm::u32vec2& size, u32 channels) :
         m_Size(size),
-        m_Channels(channels), 
-        m_Data(data) 
+        m_Channels(channels)
     {
-        ABY_ASSERT(data.size() % channels == 0, "Invalid texture data size");
-        ABY_ASSERT(m_Size.x * m_Size.y * channels == data.size(), "Data size does not match square image");
     }
 
     Texture::Texture(const Texture& other) :
@@ -177,11 +166,44 @@ namespace aby {
     }
 
     std::size_t Texture::bytes() const {
-        return m_Data.size();
+        return static_cast<std::size_t>(m_Size.x) * m_Size.y * m_Channels;
     }
 
     std::span<const std::byte> Texture::data() const {
         return std::span(m_Data.cbegin(), m_Data.size());
     }
 
+    std::pair<glm::u32vec2, u32> Texture::read_info(const fs::path& path) {
+        auto str = path.string();
+        int w, h, c;
+        if (!stbi_info(str.c_str(), &w, &h, &c)) {
+            throw std::runtime_error(std::format("[stbi_image::stbi_info]: {} ({})", stbi_failure_reason(), str));
+        }
+        // RGB formats are rarely supported for optimally tiled sampled images.
+        u32 channels = c == 3 ? 4 : static_cast<u32>(c);
+        return std::make_pair(glm::u32vec2(static_cast<u32>(w), static_cast<u32>(h)), channels);
+    }
+
+    void Texture::decode(const fs::path& path, const glm::u32vec2& size, u32 channels, std::span<std::byte> dst) {
+        auto str = path.string();
+        int w, h, c;
+        // stb_image always decodes into its own allocation, it is released as soon as
+        // the pixels are in dst so no intermediate copy outlives the decode.
+        unsigned char* data = stbi_load(str.c_str(), &w, &h, &c, static_cast<int>(channels));
+        if (!data) {
+            throw std::runtime_error(std::format("[stbi_image::stbi_load]: {} ({})", stbi_failure_reason(), str));
+        }
+        std::size_t bytes = static_cast<std::size_t>(w) * h * channels;
+        if (static_cast<u32>(w) != size.x || static_cast<u32>(h) != size.y || bytes > dst.size()) {
+            stbi_image_free(data);
+            throw std::runtime_error(std::format("Texture::decode: {} changed while loading", str));
+        }
+        std::memcpy(dst.data(), data, bytes);
+        stbi_image_free(data);
+    }
+
+    void Texture::retain(std::span<const std::byte> data) {
+        m_Data.assign(data.begin(), data.end());
+    }
+
 }
\ No newline at end of file
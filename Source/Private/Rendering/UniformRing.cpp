@@ -0,0 +1,61 @@
+#include "Rendering/UniformRing.h"
+#include <stdexcept>
+
+namespace aby {
+
+    UniformRing::UniformRing() :
+        m_Alignment(1),
+        m_Slice(0),
+        m_Head(0),
+        m_Frame(0),
+        m_Frames(0)
+    {
+    }
+
+    UniformRing::UniformRing(std::span<const std::size_t> sizes, std::size_t alignment, u32 writes, u32 frames) :
+        m_Alignment(alignment ? alignment : 1),
+        m_Slice(0),
+        m_Head(0),
+        m_Frame(0),
+        m_Frames(frames)
+    {
+        for (std::size_t size : sizes) {
+            m_Slice += align(size) * writes;
+        }
+    }
+
+    void UniformRing::begin_frame(u32 frame) {
+        m_Frame = frame;
+        m_Head  = 0;
+    }
+
+    bool UniformRing::fits(std::size_t bytes) const {
+        return m_Head + align(bytes) <= m_Slice;
+    }
+
+    std::size_t UniformRing::push(std::size_t bytes) {
+        const std::size_t stride = align(bytes);
+        if (stride > m_Slice) {
+            throw std::length_error("UniformRing: Block is larger than a slice");
+        }
+        if (!fits(bytes)) {
+            m_Head = 0;
+        }
+        const std::size_t offset = m_Frame * m_Slice + m_Head;
+        m_Head += stride;
+        return offset;
+    }
+
+    std::size_t UniformRing::align(std::size_t bytes) const {
+        return (bytes + m_Alignment - 1) / m_Alignment * m_Alignment;
+    }
+
+    std::size_t UniformRing::slice() const {
+        return m_Slice;
+    }
+
+    std::size_t UniformRing::size() const {
+        return m_Slice * m_Frames;
+    }
+
+}
@@ -1,4 +1,6 @@
 #include "Rendering/Vertex.h"
+#include <algorithm>
+#include <bit>
 
 namespace aby {
 
@@ -35,6 +37,17 @@ namespace aby {
 
 }
 
+namespace aby {
+
+    PackedVertex::PackedVertex(const Vertex& vertex) :
+        pos(vertex.pos),
+        col(pack_unorm8(vertex.col)),
+        texcoord(vertex.texinfo.x, vertex.texinfo.y),
+        texture(static_cast<u32>(vertex.texinfo.z)),
+        uvs(pack_half2(vertex.uvs)) {}
+
+}
+
 namespace aby {
 
     Quad::Quad(const glm::vec2& size, const glm::vec2& pos, const glm::vec4& col, float texture, const glm::vec2& uvs) :
@@ -45,6 +58,60 @@ namespace aby {
 
 }
 
+namespace aby {
+
+    QuadInstance::QuadInstance(const glm::vec3& pos, const glm::vec3& size, const glm::vec4& col, const glm::vec4& uv_rect, float texture, const glm::vec2& uvs, float rotation) :
+        pos(pos), size(size), col(pack_unorm8(col)), uv_rect(uv_rect), uvs(pack_half2(uvs)), rotation(rotation), texture(static_cast<u32>(texture)) {}
+
+}
+
+namespace aby {
+
+    u32 pack_unorm8(const glm::vec4& v) {
+        // Same operations as the SIMD kernels (max, min, mul, add, truncate) so both produce identical bytes.
+        auto channel = [](float c) {
+            return static_cast<u32>(std::min(std::max(c, 0.f), 1.f) * 255.f + 0.5f);
+        };
+        return channel(v.x) | (channel(v.y) << 8) | (channel(v.z) << 16) | (channel(v.w) << 24);
+    }
+
+    u16 pack_half(float v) {
+        const u32 bits = std::bit_cast<u32>(v);
+        const u32 sign = (bits >> 16) & 0x8000;
+        const u32 abs  = bits & 0x7fffffff;
+
+        if (abs >= 0x7f800000) { // Inf or NaN, NaNs stay quiet
+            return static_cast<u16>(sign | 0x7c00 | (abs > 0x7f800000 ? 0x0200 | ((abs >> 13) & 0x03ff) : 0));
+        }
+        if (abs >= 0x477ff000) { // Rounds past 65504
+            return static_cast<u16>(sign | 0x7c00);
+        }
+        if (abs >= 0x38800000) { // Normal, rebias the exponent and round the 13 dropped bits
+            u32 h = abs - 0x38000000;
+            h = (h + 0x0fff + ((h >> 13) & 1)) >> 13;
+            return static_cast<u16>(sign | h);
+        }
+        // Subnormal or zero
+        const u32 shift = 126 - (abs >> 23);
+        if (shift > 24) {
+            return static_cast<u16>(sign);
+        }
+        const u32 mantissa = (abs & 0x007fffff) | 0x00800000;
+        const u32 rest     = mantissa & ((1u << shift) - 1);
+        const u32 halfway  = 1u << (shift - 1);
+        u32 h = mantissa >> shift;
+        if (rest > halfway || (rest == halfway && (h & 1))) {
+            h++;
+        }
+        return static_cast<u16>(sign | h);
+    }
+
+    u32 pack_half2(const glm::vec2& v) {
+        return static_cast<u32>(pack_half(v.x)) | (static_cast<u32>(pack_half(v.y)) << 16);
+    }
+
+}
+
 namespace aby {
 
     Text::Text(const std::string& text, const glm::vec2& pos, const glm::vec4& color, float scale, u32 font) :
@@ -0,0 +1,34 @@
+#include "Utility/AtomicFile.h"
+#include <format>
+#include <fstream>
+#include <thread>
+
+namespace aby::util {
+
+    std::error_code write_atomic(const fs::path& path, const std::function<void(std::ostream&)>& write) {
+        // Named after the thread, writers of the same path never share a temporary file.
+        fs::path tmp = path;
+        tmp += std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+        std::error_code ec;
+        {
+            std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (out) {
+                write(out);
+                out.flush();
+            }
+            if (!out) {
+                ec = std::make_error_code(std::errc::io_error);
+            }
+        }
+        if (!ec) {
+            fs::rename(tmp, path, ec);
+        }
+        if (ec) {
+            std::error_code ignored;
+            fs::remove(tmp, ignored);
+        }
+        return ec;
+    }
+
+}
@@ -0,0 +1,27 @@
+#include "Utility/Hash.h"
+#include <format>
+
+namespace aby::util {
+
+    Hasher& Hasher::update(std::span<const std::byte> bytes) {
+        for (std::byte b : bytes) {
+            m_State ^= static_cast<u64>(b);
+            m_State *= 0x100000001B3ull;
+        }
+        return *this;
+    }
+
+    Hasher& Hasher::update_string(std::string_view text) {
+        update_value(static_cast<u64>(text.size()));
+        return update(std::as_bytes(std::span(text.data(), text.size())));
+    }
+
+    u64 Hasher::digest() const {
+        return m_State;
+    }
+
+    std::string Hasher::hex() const {
+        return std::format("{:016x}", m_State);
+    }
+
+}
@@ -0,0 +1,116 @@
+#include "Utility/Utf8.h"
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define ABY_UTF8_SSE2 // Part of x86-64, no runtime dispatch needed
+#endif
+
+namespace aby::util {
+
+    static bool is_continuation(std::string_view text, std::size_t pos, u8 min = 0x80, u8 max = 0xBF) {
+        if (pos >= text.size()) {
+            return false;
+        }
+        const u8 byte = static_cast<u8>(text[pos]);
+        return byte >= min && byte <= max;
+    }
+
+    char32_t decode_utf8(std::string_view text, std::size_t& pos) {
+        const u8 lead = static_cast<u8>(text[pos]);
+        if (lead < 0x80) {
+            pos += 1;
+            return lead;
+        }
+
+        // Valid ranges of the second byte per lead byte (RFC 3629), the others are 0x80 - 0xBF.
+        std::size_t length = 0;
+        u8          min    = 0x80;
+        u8          max    = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) min = 0xA0; // Overlong
+            if (lead == 0xED) max = 0x9F; // Surrogates
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) min = 0x90; // Overlong
+            if (lead == 0xF4) max = 0x8F; // Above U+10FFFF
+        }
+
+        bool valid = length != 0 && is_continuation(text, pos + 1, min, max);
+        for (std::size_t i = 2; valid && i < length; i++) {
+            valid = is_continuation(text, pos + i);
+        }
+        if (!valid) {
+            pos += 1;
+            return REPLACEMENT_CHARACTER;
+        }
+
+        char32_t code = lead & (0x7F >> length);
+        for (std::size_t i = 1; i < length; i++) {
+            code = (code << 6) | (static_cast<u8>(text[pos + i]) & 0x3F);
+        }
+        pos += length;
+        return code;
+    }
+
+    std::size_t ascii_run(std::string_view text) {
+        const char*       data = text.data();
+        const std::size_t size = text.size();
+        std::size_t       i    = 0;
+#ifdef ABY_UTF8_SSE2
+        for (; i + 16 <= size; i += 16) {
+            const u32 mask = static_cast<u32>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+            if (mask != 0) {
+                return i + std::countr_zero(mask);
+            }
+        }
+#endif
+        if constexpr (std::endian::native == std::endian::little) {
+            for (; i + 8 <= size; i += 8) {
+                u64 word;
+                std::memcpy(&word, data + i, sizeof(word));
+                word &= 0x8080808080808080ull;
+                if (word != 0) {
+                    return i + std::countr_zero(word) / 8;
+                }
+            }
+        }
+        for (; i < size; i++) {
+            if (static_cast<u8>(data[i]) & 0x80) {
+                return i;
+            }
+        }
+        return size;
+    }
+
+    std::size_t utf8_length(std::string_view text) {
+        std::size_t length = 0;
+        std::size_t pos    = 0;
+        while (pos < text.size()) {
+            const std::size_t ascii = ascii_run(text.substr(pos));
+            length += ascii;
+            pos    += ascii;
+            if (pos < text.size()) {
+                decode_utf8(text, pos);
+                length++;
+            }
+        }
+        return length;
+    }
+
+    std::u32string decode_utf8(std::string_view text) {
+        std::u32string out;
+        out.reserve(text.size());
+        for_each_codepoint(text, [&out](char32_t c) {
+            out.push_back(c);
+        });
+        return out;
+    }
+
+}
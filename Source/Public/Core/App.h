@@ -29,6 +29,7 @@ namespace aby {
 		const Context&  ctx() const;
 		Renderer&		renderer();
 		const Renderer& renderer() const;
+		JobSystem&		jobs();
 		std::span<Ref<Object>> objects();
 		std::span<const Ref<Object>> objects() const;
 		const AppInfo& info() const;
@@ -45,6 +46,7 @@ namespace aby {
 	private:
 		static fs::path m_ExePath;
 		AppInfo         m_Info;
+		Unique<JobSystem> m_Jobs;
 		Unique<Window>  m_Window;
 		Ref<Context>    m_Ctx;
 		Ref<Renderer>   m_Renderer;
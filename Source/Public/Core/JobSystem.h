@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Core/Common.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace aby {
+
+    class Thread;
+
+    enum class EJobPriority : u32 {
+        HIGH     = 0,
+        NORMAL   = 1,
+        LOW      = 2,
+        MAX_ENUM = 3,
+    };
+
+    /**
+    * @brief Counter of outstanding jobs. Jobs submitted with a WaitGroup
+    *        decrement it when they finish, JobSystem::wait blocks until it reaches zero.
+    */
+    class WaitGroup {
+    public:
+        WaitGroup();
+        WaitGroup(const WaitGroup&) = delete;
+        WaitGroup(WaitGroup&&) noexcept = delete;
+
+        void add(std::size_t count = 1);
+        void done();
+        void wait();
+        /**
+        * @brief Once true, the last done() has returned and the group may be destroyed.
+        */
+        bool is_done() const;
+        std::size_t count() const;
+
+        WaitGroup& operator=(const WaitGroup&) = delete;
+        WaitGroup& operator=(WaitGroup&&) = delete;
+    private:
+        friend class JobSystem;
+    private:
+        std::atomic<std::size_t> m_Count;
+        mutable std::mutex       m_Mutex;
+        std::condition_variable  m_CondVar;
+    };
+
+    /**
+    * @brief Fixed pool of worker threads. Every worker owns one deque per priority,
+    *        pops its own work LIFO and steals from the front of other workers deques
+    *        when it runs dry.
+    */
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+    public:
+        /**
+        * @param workers Worker thread count, 0 uses hardware_concurrency - 1
+        *        (the submitting thread helps while it waits).
+        */
+        explicit JobSystem(u32 workers = 0);
+        JobSystem(const JobSystem&) = delete;
+        JobSystem(JobSystem&&) noexcept = delete;
+        ~JobSystem();
+
+        void submit(Job&& job, EJobPriority priority = EJobPriority::NORMAL, WaitGroup* wg = nullptr);
+        /**
+        * @brief Block until the wait group is done, executing queued jobs in the meantime.
+        *        Safe to call from inside a job.
+        */
+        void wait(WaitGroup& wg);
+        /**
+        * @brief Execute one queued job on the calling thread.
+        * @return false if there was nothing to run.
+        */
+        bool help();
+
+        /**
+        * @brief Split [0, count) into chunks of at most grain elements and run
+        *        fn(begin, end) for each chunk across all workers. Returns when every chunk ran.
+        * @param grain Chunk size, 0 picks one based on the worker count.
+        */
+        template <typename Fn> requires (std::is_invocable_v<Fn, std::size_t, std::size_t>)
+        void parallel_for(std::size_t count, Fn&& fn, std::size_t grain = 0, EJobPriority priority = EJobPriority::NORMAL) {
+            if (count == 0) return;
+            if (grain == 0) {
+                std::size_t chunks = static_cast<std::size_t>(workers() + 1) * 4;
+                grain = std::max<std::size_t>(1, (count + chunks - 1) / chunks);
+            }
+            if (count <= grain) {
+                fn(std::size_t{ 0 }, count);
+                return;
+            }
+            WaitGroup wg;
+            for (std::size_t begin = 0; begin < count; begin += grain) {
+                std::size_t end = std::min(count, begin + grain);
+                submit([&fn, begin, end]() { fn(begin, end); }, priority, &wg);
+            }
+            wait(wg);
+        }
+
+        u32 workers() const;
+        std::size_t pending() const;
+        /**
+        * @return true if the calling thread is one of this job system's workers.
+        */
+        bool is_worker() const;
+    private:
+        struct Entry {
+            Job        job;
+            WaitGroup* wg = nullptr;
+        };
+
+        struct Queue {
+            std::array<std::deque<Entry>, static_cast<std::size_t>(EJobPriority::MAX_ENUM)> entries;
+            std::mutex mutex;
+        };
+
+        void work(u32 index);
+        bool try_run(u32 index);
+        bool pop(u32 index, Entry& out);
+        bool steal(u32 thief, Entry& out);
+        void execute(Entry& entry);
+    private:
+        std::vector<Unique<Queue>>  m_Queues;
+        std::vector<Unique<Thread>> m_Workers;
+        std::atomic<std::size_t>    m_Pending;
+        std::atomic<u32>            m_NextQueue;
+        std::atomic<bool>           m_Stop;
+        std::mutex                  m_WakeMutex;
+        std::condition_variable     m_Wake;
+    };
+
+}
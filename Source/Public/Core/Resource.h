@@ -2,6 +2,7 @@
 #include "Core/Common.h"
 #include "Core/Log.h"
 #include <unordered_map>
+#include <shared_mutex>
 #include <queue>
 #include <vector>
 #include <any>
@@ -21,6 +22,14 @@ namespace aby {
         MAX_ENUM,
     };
 
+    enum class EResourceState : u32 {
+        NONE    = 0, // Handle was never reserved
+        PENDING,     // Handle reserved, load in flight
+        READY,
+        FAILED,
+        MAX_ENUM,
+    };
+
     template <typename T>
     concept CIsResource = std::is_same_v<T, Shader> || std::is_same_v<T, Texture> || std::is_same_v<T, Font>;
 
@@ -70,7 +79,11 @@ namespace aby {
         virtual ~IResourceHandler() = default;
 
         virtual void on_add(Handle handle, Ref<T> resource) = 0;
-        virtual void on_erase(Handle handle, Ref<T> resource) = 0;
+        /**
+        * @return True to hold the handle back from reuse until ResourceClass::release, e.g. while
+        *         frames in flight may still refer to it.
+        */
+        virtual bool on_erase(Handle handle, Ref<T> resource) = 0;
     protected:
         std::any m_UserData;
     };
@@ -86,63 +99,189 @@ namespace aby {
         using Map = std::unordered_map<Handle, Value>;
 
         void assert_contains(Resource resource) const {
-            ABY_ASSERT(resource.type() == TypeToEResource<T>(), "Resource type mismatch");
-            ABY_ASSERT(m_Resources.contains(resource.handle()), "Resource(Type: {}, Handle: {}) not found!",
-                static_cast<std::underlying_type_t<EResource>>(resource.type()),
-                resource.handle()
-            );
+            std::shared_lock lock(m_Mutex);
+            assert_contains_unlocked(resource);
         }
     public:
         ResourceClass() : m_NextHandle(0) {}
 
+        /**
+        * @brief Reserve a handle for a resource that is added later through add(Resource, Ref<T>).
+        */
+        Handle reserve() {
+            std::lock_guard lock(m_Mutex);
+            Handle handle = get_next_handle();
+            m_States[handle] = EResourceState::PENDING;
+            return handle;
+        }
+
+        /**
+        * @brief Mark a reserved handle whose load did not complete.
+        */
+        void fail(Resource reserved) {
+            ABY_ASSERT(reserved.type() == TypeToEResource<T>(), "Resource type mismatch");
+            std::lock_guard lock(m_Mutex);
+            m_States[reserved.handle()] = EResourceState::FAILED;
+        }
+
         Resource add(Ref<T> ptr) {
+            std::lock_guard lock(m_Mutex);
             Handle handle = get_next_handle();
-            for (auto& handler : m_Handlers) {
-                handler->on_add(handle, ptr);
-            }
-            m_Resources.emplace(handle, std::move(ptr));
+            insert(handle, std::move(ptr));
             return Resource(TypeToEResource<T>(), handle);
         }
 
+        Resource add(Resource reserved, Ref<T> ptr) {
+            ABY_ASSERT(reserved.type() == TypeToEResource<T>(), "Resource type mismatch");
+            std::lock_guard lock(m_Mutex);
+            insert(reserved.handle(), std::move(ptr));
+            m_States.erase(reserved.handle());
+            return reserved;
+        }
+
         void add_handler(Unique<Handler>&& handler) {
+            std::lock_guard lock(m_Mutex);
             m_Handlers.push_back(std::move(handler));
         }
 
         template <typename... Args> requires (std::is_constructible_v<T, Args...>)
         Resource emplace(Args&&... args) {
+            std::lock_guard lock(m_Mutex);
             Handle handle = get_next_handle();
             m_Resources.emplace(handle, std::make_shared<T>(std::forward<Args>(args)...));
             return Resource(TypeToEResource<T>(), handle);
         }
 
         void erase(Resource resource) {
-            assert_contains(resource);
+            std::lock_guard lock(m_Mutex);
+            assert_contains_unlocked(resource);
             auto handle = resource.handle();
+            u32 holds = 0;
             for (auto& handler : m_Handlers) {
-                handler->on_erase(handle, m_Resources.at(handle));
+                holds += handler->on_erase(handle, m_Resources.at(handle)) ? 1 : 0;
             }
             m_Resources.erase(handle);
-            m_RecycledHandles.push(handle);
+            m_States.erase(handle);
+            if (holds) {
+                m_Held[handle] = holds;
+            }
+            else {
+                m_RecycledHandles.push(handle);
+            }
+        }
+
+        /**
+        * @brief Drop a reservation marked with fail(), its handle is reused.
+        */
+        void drop(Resource failed) {
+            ABY_ASSERT(failed.type() == TypeToEResource<T>(), "Resource type mismatch");
+            std::lock_guard lock(m_Mutex);
+            auto it = m_States.find(failed.handle());
+            ABY_ASSERT(it != m_States.end() && it->second == EResourceState::FAILED, "Handle {} is not a failed reservation", failed.handle());
+            m_States.erase(it);
+            m_RecycledHandles.push(failed.handle());
+        }
+
+        /**
+        * @brief Let go of an erased handle a handler held back (see IResourceHandler::on_erase),
+        *        it is reused once every handler that held it released it.
+        */
+        void release(Handle handle) {
+            std::lock_guard lock(m_Mutex);
+            auto it = m_Held.find(handle);
+            ABY_ASSERT(it != m_Held.end(), "Handle {} is not held", handle);
+            if (--it->second == 0) {
+                m_Held.erase(it);
+                m_RecycledHandles.push(handle);
+            }
         }
 
         Ref<T> at(Resource resource) {
-            assert_contains(resource);
+            std::shared_lock lock(m_Mutex);
+            assert_contains_unlocked(resource);
             return m_Resources.at(resource.handle());
         }
 
         Ref<T> at(Resource resource) const {
-            assert_contains(resource);
+            std::shared_lock lock(m_Mutex);
+            assert_contains_unlocked(resource);
             return m_Resources.at(resource.handle());
         }
 
+        bool contains(Resource resource) const {
+            std::shared_lock lock(m_Mutex);
+            return resource.type() == TypeToEResource<T>() && m_Resources.contains(resource.handle());
+        }
+
+        /**
+        * @return nullptr if the resource is not ready.
+        */
+        Ref<T> try_at(Resource resource) const {
+            std::shared_lock lock(m_Mutex);
+            return find_unlocked(resource);
+        }
+
+        /**
+        * @return The resource if it is ready, otherwise the fallback (nullptr if there is none).
+        */
+        Ref<T> at_or_fallback(Resource resource) const {
+            std::shared_lock lock(m_Mutex);
+            if (auto ptr = find_unlocked(resource)) {
+                return ptr;
+            }
+            return find_unlocked(m_Fallback);
+        }
+
+        /**
+        * @return The resource if it is ready, otherwise the fallback resource.
+        */
+        Resource resolve(Resource resource) const {
+            std::shared_lock lock(m_Mutex);
+            return find_unlocked(resource) ? resource : m_Fallback;
+        }
+
+        EResourceState state(Resource resource) const {
+            if (resource.type() != TypeToEResource<T>()) {
+                return EResourceState::NONE;
+            }
+            std::shared_lock lock(m_Mutex);
+            if (m_Resources.contains(resource.handle())) {
+                return EResourceState::READY;
+            }
+            if (auto it = m_States.find(resource.handle()); it != m_States.end()) {
+                return it->second;
+            }
+            return EResourceState::NONE;
+        }
+
+        bool is_ready(Resource resource) const {
+            return state(resource) == EResourceState::READY;
+        }
+
+        /**
+        * @brief Resource substituted by at_or_fallback and resolve while a load is pending or failed.
+        */
+        void set_fallback(Resource fallback) {
+            std::lock_guard lock(m_Mutex);
+            m_Fallback = fallback;
+        }
+
+        Resource fallback() const {
+            std::shared_lock lock(m_Mutex);
+            return m_Fallback;
+        }
+
         std::size_t size() const {
+            std::shared_lock lock(m_Mutex);
             return m_Resources.size();
         }
 
         void clear() {
+            std::lock_guard lock(m_Mutex);
             m_Resources.clear();
         }
 
+        // Iteration is not guarded, only iterate once the ResourceLoader has been synced.
         auto begin() {
             return m_Resources.begin();
         }
@@ -156,6 +295,29 @@ namespace aby {
             return m_Resources.end();
         }
     private:
+        void assert_contains_unlocked(Resource resource) const {
+            ABY_ASSERT(resource.type() == TypeToEResource<T>(), "Resource type mismatch");
+            ABY_ASSERT(m_Resources.contains(resource.handle()), "Resource(Type: {}, Handle: {}) not found!",
+                static_cast<std::underlying_type_t<EResource>>(resource.type()),
+                resource.handle()
+            );
+        }
+
+        Ref<T> find_unlocked(Resource resource) const {
+            if (resource.type() != TypeToEResource<T>()) {
+                return nullptr;
+            }
+            auto it = m_Resources.find(resource.handle());
+            return it != m_Resources.end() ? it->second : nullptr;
+        }
+
+        void insert(Handle handle, Ref<T> ptr) {
+            for (auto& handler : m_Handlers) {
+                handler->on_add(handle, ptr);
+            }
+            m_Resources.emplace(handle, std::move(ptr));
+        }
+
         Handle get_next_handle() {
             if (!m_RecycledHandles.empty()) {
                 Handle handle = m_RecycledHandles.front();
@@ -167,8 +329,12 @@ namespace aby {
     private:
         Handle m_NextHandle;
         Map<Ref<T>> m_Resources;
+        Map<EResourceState> m_States;
+        Resource m_Fallback;
         std::queue<Handle> m_RecycledHandles;
+        Map<u32> m_Held; // Erased handles not yet released, by the number of handlers holding them
         std::vector<Unique<Handler>> m_Handlers;
+        mutable std::shared_mutex m_Mutex;
     };
     
 
@@ -0,0 +1,43 @@
+#pragma once
+#include "Core/Common.h"
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ABY_SIMD_X86
+#endif
+
+// Compile a single function for an instruction set the rest of the build does not assume,
+// it may only be called after simd_support() reported that set.
+#if defined(__GNUC__) || defined(__clang__)
+#define ABY_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ABY_SIMD_TARGET(isa)
+#endif
+
+namespace aby {
+
+    enum class ESimd : u32 {
+        SCALAR   = 0,
+        SSE4_1   = 1,
+        AVX2     = 2, // With F16C
+        MAX_ENUM = 3,
+    };
+
+    /**
+    * @brief Widest instruction set supported by both the CPU and the OS, detected once.
+    */
+    ESimd simd_support();
+    /**
+    * @brief Instruction set the batch kernels dispatch to, simd_support() unless lowered by set_simd_level().
+    */
+    ESimd simd_level();
+    /**
+    * @brief Lower (or restore) the dispatched instruction set, clamped to simd_support().
+    */
+    void set_simd_level(ESimd level);
+
+}
+
+namespace std {
+    string to_string(aby::ESimd simd);
+}
@@ -2,6 +2,9 @@
 
 #include "Core/Resource.h"
 #include "Core/Log.h"
+#include "Core/JobSystem.h"
+#include <functional>
+#include <future>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
@@ -26,37 +29,77 @@ namespace aby {
         std::thread m_Thread;
     };
 
-    class LoadThread final : public Thread {
-    private:
-        enum class EFinishState {
-            FINISH           = 0,
-            LOAD_THEN_FINISH = 1,
-            CONTINUE         = 2,
-        };
+    /**
+    * @brief Dispatches resource loads onto the JobSystem. The resource handle is reserved
+    *        before the task is queued so it can be returned (and stored) immediately.
+    *        A task that throws marks its resource as EResourceState::FAILED.
+    *
+    *        Tasks may declare the resources they depend on. A task is only queued once all of
+    *        its dependencies finished, so independent branches load in parallel and a chain
+    *        takes as long as its slowest path. A failed dependency fails its dependents.
+    *
+    *        Async tasks finish when they invoke their Done callback rather than when they return,
+    *        so work handed off to another thread (e.g. a GPU upload) does not hold a worker.
+    */
+    class ResourceLoader {
     public:
-        using QueryResourceNextHandle = std::function<Resource::Handle(EResource)>;
-        using Task = std::function<void()>;
+        using ReserveHandle = std::function<Resource::Handle(EResource)>;
+        using OnFailed      = std::function<void(Resource)>;
+        using Task          = std::function<void(Resource)>;
+        using Done          = std::function<void(bool)>;
+        using AsyncTask     = std::function<void(Resource, Done)>;
+        using Future        = std::shared_future<EResourceState>;
 
-        explicit LoadThread(QueryResourceNextHandle query_next_handle);
-        ~LoadThread();
+        ResourceLoader(JobSystem& jobs, ReserveHandle reserve_handle, OnFailed on_failed);
+        ~ResourceLoader();
 
-        Resource add_task(EResource type, Task&& task);
+        /**
+        * @brief Reserve a handle without queuing a task, for resources whose
+        *        dependents must know the handle before the load is added.
+        */
+        Resource    reserve(EResource type);
+        Resource    add_task(EResource type, Task&& task, const std::vector<Resource>& dependencies = {});
+        Resource    add_task(Resource reserved, Task&& task, const std::vector<Resource>& dependencies = {});
+        /**
+        * @brief The resource is READY once done(true) was called, FAILED on done(false) or if the task throws.
+        *        done must be called exactly once and may be called from any thread.
+        */
+        Resource    add_async_task(EResource type, AsyncTask&& task, const std::vector<Resource>& dependencies = {});
+        Resource    add_async_task(Resource reserved, AsyncTask&& task, const std::vector<Resource>& dependencies = {});
+        /**
+        * @return Future resolving to READY or FAILED once the task finished (already ready if it did),
+        *         invalid if the resource was not loaded through this loader.
+        */
+        Future      future(Resource resource) const;
+        /**
+        * @brief Block until a single resource finished loading, executing queued jobs in the meantime.
+        */
+        EResourceState wait(Resource resource);
         std::size_t tasks() const;
-        void sync();
+        void        sync();
     private:
-        void load();
-    public:
-        QueryResourceNextHandle        m_QueryNextHandle;
-        std::multimap<EResource, Task> m_Tasks;
-        // Recursive mutex is necessary due
-        // to fonts and how they are loaded.
-        // The font needs to be loaded, then 
-        // a texture associated with a font needs
-        // to be loaded within the same scope as the font
-        // creation.
-        std::recursive_mutex           m_Mutex;
-        std::atomic<EFinishState>      m_FinishState;
-        std::condition_variable m_CondVar;
-        std::mutex m_CondMutex;
+        struct Node {
+            Resource                          resource;
+            AsyncTask                         task;
+            std::promise<EResourceState>      promise;
+            Future                            future;
+            std::atomic<u32>                  remaining{ 0 };     // Unfinished dependencies
+            std::atomic<bool>                 dependency_failed{ false };
+            std::atomic<bool>                 finished{ false };
+            std::vector<Ref<Node>>            dependents;          // Guarded by m_Mutex
+        };
+
+        void release(const Ref<Node>& node);
+        void run(const Ref<Node>& node);
+        void finish(const Ref<Node>& node, EResourceState state);
+        static u64 key(Resource resource);
+    private:
+        JobSystem&    m_Jobs;
+        ReserveHandle m_ReserveHandle;
+        OnFailed      m_OnFailed;
+        WaitGroup     m_Tasks;
+        mutable std::mutex m_Mutex;
+        std::unordered_map<u64, Ref<Node>> m_Nodes;            // Loads in flight
+        std::unordered_map<u64, EResourceState> m_Finished;   // Final state once the node was dropped, until the handle is reused
     };
 }
@@ -0,0 +1,33 @@
+#pragma once
+#include "Core/Common.h"
+#include <functional>
+
+namespace aby::sys {
+
+	/**
+	* @brief Reports changes to individual files from a background thread.
+	*        Saves that replace the file (write to a temporary, then rename) are reported as well.
+	*/
+	class FileWatcher {
+	public:
+		/**
+		* @brief Called on the watcher thread, possibly more than once per save.
+		*/
+		using OnChange = std::function<void(const fs::path& file)>;
+
+		static Unique<FileWatcher> create(OnChange on_change);
+		virtual ~FileWatcher() = default;
+
+		/**
+		* @brief Start reporting changes to file, watching it again does nothing.
+		*        Paths are reported in their canonical form.
+		* @return false if the file cannot be watched.
+		*/
+		virtual bool watch(const fs::path& file) = 0;
+	protected:
+		explicit FileWatcher(OnChange on_change);
+	protected:
+		OnChange m_OnChange;
+	};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Platform/FileWatcher.h"
+#include "Core/Thread.h"
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+namespace aby::sys::posix {
+
+	/**
+	* @brief inotify on the parent directory of every watched file, a rename onto the file is seen as well.
+	*/
+	class FileWatcher : public sys::FileWatcher {
+	public:
+		explicit FileWatcher(OnChange on_change);
+		~FileWatcher() final;
+
+		bool watch(const fs::path& file) override;
+	private:
+		void run();
+	private:
+		int m_Inotify;
+		int m_Wake; // eventfd, written by the destructor to stop run()
+		std::mutex m_Mutex;
+		std::unordered_map<int, fs::path> m_Dirs; // Watch descriptor to directory
+		std::set<fs::path> m_Files;
+		Unique<Thread> m_Thread;
+	};
+
+}
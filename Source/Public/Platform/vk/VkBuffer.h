@@ -4,6 +4,7 @@
 #include "Platform/vk/VkShader.h"
 #include "Core/Log.h"
 #include <cstring>
+#include <span>
 
 namespace aby::vk {
 	
@@ -27,6 +28,7 @@ namespace aby::vk {
         void destroy();
 
         VkDeviceMemory memory();
+        const Allocation& allocation() const;
         std::size_t size() const;
 
         operator VkBuffer();
@@ -37,11 +39,62 @@ namespace aby::vk {
     protected:
         VkDevice m_Logical;
         VkBuffer m_Buffer;
-        VkDeviceMemory m_Memory;
+        MemoryAllocator* m_Memory;
+        Allocation m_Allocation;
         VkBufferUsageFlags m_Flags;
         std::size_t m_Size;
     };
 
+    /**
+    * @brief Host visible transfer source. Written in place through map() so data can be
+    *        produced (decoded, generated) directly into device visible memory.
+    */
+    class StagingBuffer : public Buffer {
+    public:
+        StagingBuffer(std::size_t bytes, DeviceManager& manager);
+
+        std::span<std::byte> map();
+        void unmap();
+    private:
+        void* m_Mapped;
+    };
+
+    /**
+    * @brief Persistently mapped buffer split into one region per frame in flight.
+    *        Data for a frame is sub-allocated from its region with increasing offsets,
+    *        so the CPU never writes into a region the GPU may still be reading.
+    */
+    class RingBuffer : public Buffer {
+    public:
+        struct Slice {
+            VkDeviceSize         offset = 0; // From the start of the buffer
+            std::span<std::byte> data;
+
+            explicit operator bool() const { return !data.empty(); }
+        };
+    public:
+        RingBuffer(std::size_t frame_bytes, u32 frames, VkBufferUsageFlags flags, DeviceManager& manager);
+
+        /**
+        * @brief Start writing into the region of frame, the caller guarantees the GPU is done with it.
+        */
+        void  begin_frame(u32 frame);
+        /**
+        * @return Empty slice if the current region can not fit bytes.
+        */
+        Slice alloc(std::size_t bytes, std::size_t alignment = 16);
+
+        u32         frame() const;
+        u32         frames() const;
+        std::size_t frame_size() const;
+        std::size_t used() const;
+    private:
+        std::size_t m_FrameSize;
+        u32         m_Frames;
+        u32         m_Frame;
+        std::size_t m_Head;
+    };
+
     class VertexBuffer : public Buffer {
     public:
         // Data constructor
@@ -67,6 +120,10 @@ namespace aby::vk {
         std::size_t   m_Count;
     };
 
+    /**
+    * @brief Write cursor for a batch of vertices. Owns a heap scratch array by default,
+    *        after map() it writes straight into external (usually mapped device) memory instead.
+    */
     class VertexAccumulator {
     public:
         VertexAccumulator();
@@ -74,7 +131,17 @@ namespace aby::vk {
         ~VertexAccumulator();
 
         void set_class(const VertexClass& vertex_class);
+        /**
+        * @brief Write into memory instead of the owned scratch array, capacity becomes memory.size() / vertex_size().
+        *        The accumulator is reset and does not take ownership.
+        */
+        void map(std::span<std::byte> memory);
+        bool is_mapped() const;
         void reset();
+        /**
+        * @brief Claim up to count vertices for writing in place, fewer if the accumulator fills up.
+        */
+        std::span<std::byte> push(std::size_t count);
 
         std::size_t offset() const;
         std::size_t vertex_size() const;
@@ -100,14 +167,29 @@ namespace aby::vk {
         std::size_t m_VertexSize;
         std::byte* m_Ptr;
         std::byte* m_Base;
+        bool m_Owned;
     };
 
     class IndexBuffer : public Buffer {
     public:
-        IndexBuffer(const void* data, size_t size, DeviceManager& manager);
-        IndexBuffer(std::size_t bytes, DeviceManager& manager);
+        IndexBuffer(const void* data, size_t size, DeviceManager& manager, VkIndexType type = VK_INDEX_TYPE_UINT32);
+        IndexBuffer(std::size_t count, VkIndexType type, DeviceManager& manager);
+
+        /**
+        * @brief 16 bit indices if every vertex of a batch (indices restart at 0 per batch) can be addressed with them.
+        */
+        static VkIndexType fitting_type(std::size_t max_vertices);
+        static std::size_t index_size(VkIndexType type);
 
+        /**
+        * @brief Upload indices, narrowed to 16 bit for a VK_INDEX_TYPE_UINT16 buffer.
+        */
+        void set_indices(std::span<const u32> indices, DeviceManager& manager);
         void bind(VkCommandBuffer cmd) override;
+
+        VkIndexType type() const;
+    private:
+        VkIndexType m_Type;
     };
 
 }
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cstdint>
 #include <vector>
+#include <span>
 
 #define VK_CHECK(x) do {                                                          \
     VkResult result = (x);                                                        \
@@ -100,14 +101,22 @@ namespace aby::vk {
             VkPipelineStageFlags2 srcStage,
             VkPipelineStageFlags2 dstStage
         );
+        /**
+        * @brief Create the image only, memory is bound through MemoryAllocator::bind.
+        */
         void create_img(
             uint32_t width, uint32_t height,
             VkFormat format, VkImageTiling tiling,
-            VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-            VkImage& image, VkDeviceMemory& imageMemory,
-            VkDevice device, VkPhysicalDevice physicalDevice
+            VkImageUsageFlags usage,
+            VkImage& image,
+            VkDevice device,
+            std::span<const u32> queue_families = {}
         );
         void copy_buffer_to_img(VkCommandBuffer cmd, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+        /**
+        * @brief Copy tightly packed pixels at buffer_offset into the offset/extent rectangle of image (in TRANSFER_DST_OPTIMAL).
+        */
+        void copy_buffer_to_img(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize buffer_offset, VkImage image, VkOffset2D offset, VkExtent2D extent);
         void create_img_view(VkDevice device, VkImage image, VkFormat format, VkImageView& view);
         VkCommandBuffer begin_single_time_commands(VkDevice device, VkCommandPool commandPool);
         void end_single_time_commands(VkCommandBuffer commandBuffer, VkDevice device, VkCommandPool commandPool, VkQueue queue);
@@ -3,6 +3,7 @@
 #include "Platform/vk/VkInstance.h"
 #include "Platform/vk/VkDebugger.h"
 #include "Platform/vk/VkSurface.h"
+#include "Platform/vk/VkUploader.h"
 #include "Core/Window.h"
 #include "Rendering/Context.h"
 
@@ -23,6 +24,7 @@ namespace aby::vk {
         Debugger&      debugger();
         DeviceManager& devices();
         Surface&       surface();
+        Uploader&      uploader();
     private:
         void imgui_setup_style();
     private:
@@ -30,6 +32,7 @@ namespace aby::vk {
         Debugger m_Debugger;
         DeviceManager m_Devices;
         Surface m_Surface;
+        Uploader m_Uploader;
     };
 
 }
\ No newline at end of file
@@ -3,7 +3,10 @@
 #include "Platform/vk/VkInstance.h"
 #include "Platform/vk/VkCmdPool.h"
 #include "Platform/vk/VkDescriptorPool.h"
+#include "Platform/vk/VkMemoryAllocator.h"
+#include "Platform/vk/VkPipelineCache.h"
 #include "Core/Common.h"
+#include <mutex>
 
 namespace aby::vk {
 
@@ -28,15 +31,54 @@ namespace aby::vk {
         VkPhysicalDevice physical();
         VkDevice logical();
         const DeviceQueue& graphics() const;
+        /**
+        * @brief Dedicated transfer queue if the device exposes one, the graphics queue otherwise.
+        */
+        const DeviceQueue& transfer() const;
+        bool has_dedicated_transfer() const;
+        /**
+        * @brief Unique queue family indices in use, images shared between them use VK_SHARING_MODE_CONCURRENT.
+        */
+        std::vector<u32> queue_families() const;
+        /**
+        * @brief Guards every submission to the graphics queue, resources are uploaded from worker threads.
+        */
+        std::mutex& queue_mutex();
+        /**
+        * @brief Guards submissions to the transfer queue, same as queue_mutex() when there is no dedicated one.
+        */
+        std::mutex& transfer_mutex();
 
+        /**
+        * @brief Device memory sub-allocator every buffer and image allocates through.
+        */
+        MemoryAllocator& memory();
+        /**
+        * @brief Shared by every pipeline of the device, vk::Context loads it from App::cache().
+        */
+        PipelineCache& pipeline_cache();
+
+        /**
+        * @brief Elements of the bindless texture array, the update after bind per stage limits capped by MAX_BINDLESS_RESOURCES.
+        */
         u32 max_texture_slots() const;
+        /**
+        * @brief Dynamic uniform buffer offsets must be multiples of it.
+        */
+        VkDeviceSize min_uniform_alignment() const;
     protected:
         static VkPhysicalDevice choose_best_device(VkInstance inst);
     private:
         VkPhysicalDevice m_Physical;
         VkDevice m_Logical;
         DeviceQueue m_Graphics;
+        DeviceQueue m_Transfer;
         u32 m_MaxTextureSlots;
+        VkDeviceSize m_MinUniformAlignment;
+        std::mutex m_QueueMutex;
+        std::mutex m_TransferMutex;
+        MemoryAllocator m_Memory;
+        PipelineCache m_PipelineCache;
     };
 
 }
\ No newline at end of file
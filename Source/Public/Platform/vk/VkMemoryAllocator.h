@@ -0,0 +1,103 @@
+#pragma once
+#include "Platform/vk/VkCommon.h"
+#include "Core/Common.h"
+#include <array>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace aby::vk {
+
+    /**
+    * @brief A range of device memory handed out by the MemoryAllocator.
+    */
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize   offset = 0;
+        VkDeviceSize   size   = 0;
+        void*          mapped = nullptr; // Persistently mapped pointer to offset, null if not host visible.
+        u32            type   = UINT32_MAX;
+        u32            pool   = 0;
+        u32            block  = UINT32_MAX; // UINT32_MAX for dedicated allocations.
+        u32            order  = 0;
+
+        explicit operator bool() const { return memory != VK_NULL_HANDLE; }
+    };
+
+    struct HeapUsage {
+        VkDeviceSize size      = 0; // Heap size
+        VkDeviceSize budget    = 0; // VK_EXT_memory_budget budget, heap size if unsupported
+        VkDeviceSize usage     = 0; // VK_EXT_memory_budget process usage, allocated if unsupported
+        VkDeviceSize allocated = 0; // Bytes of device memory owned by the allocator
+        VkDeviceSize used      = 0; // Bytes handed out to resources
+        u32          blocks    = 0;
+    };
+
+    /**
+    * @brief Sub-allocates buffers and images from large device memory blocks, one set of blocks per memory type.
+    *        Ranges are placed with a buddy allocator, so every range is aligned to its (power of two) size.
+    *        Host visible blocks are mapped once for their whole lifetime.
+    *
+    *        If bufferImageGranularity is larger than the smallest range, linear (buffers) and optimal (images)
+    *        resources are kept in separate blocks so they can never share a granularity page.
+    */
+    class MemoryAllocator {
+    public:
+        static constexpr VkDeviceSize BLOCK_SIZE = 64ull * 1024 * 1024;
+        static constexpr VkDeviceSize MIN_SIZE   = 256;
+    public:
+        MemoryAllocator();
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator(MemoryAllocator&&) noexcept = delete;
+        ~MemoryAllocator();
+
+        /**
+        * @param budget VK_EXT_memory_budget is enabled on the device.
+        */
+        void create(VkPhysicalDevice physical, VkDevice logical, bool budget);
+        void destroy();
+
+        Allocation alloc(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+        /**
+        * @brief Allocate and bind memory for a buffer or image.
+        */
+        Allocation bind(VkBuffer buffer, VkMemoryPropertyFlags properties);
+        Allocation bind(VkImage image, VkMemoryPropertyFlags properties);
+        void       free(Allocation& allocation);
+
+        std::vector<HeapUsage> usage() const;
+        /**
+        * @return Number of live vkAllocateMemory allocations.
+        */
+        u32 device_allocations() const;
+    private:
+        struct Block {
+            VkDeviceMemory                      memory = VK_NULL_HANDLE;
+            std::byte*                          mapped = nullptr;
+            VkDeviceSize                        size   = 0;
+            VkDeviceSize                        used   = 0;
+            std::vector<std::set<VkDeviceSize>> free; // Free offsets per order, order n spans MIN_SIZE << n bytes
+        };
+        using Pool = std::vector<Unique<Block>>;
+
+        u32        find_type(u32 filter, VkMemoryPropertyFlags properties) const;
+        VkDeviceSize block_size(u32 type) const;
+        Allocation alloc_dedicated(VkDeviceSize size, u32 type);
+        bool       alloc_from(Block& block, u32 order, VkDeviceSize& offset);
+        void       free_to(Block& block, VkDeviceSize offset, u32 order);
+        std::byte* map(VkDeviceMemory memory, u32 type);
+        static u32 order_of(VkDeviceSize size);
+    private:
+        VkPhysicalDevice m_Physical;
+        VkDevice         m_Logical;
+        bool             m_Budget;
+        VkDeviceSize     m_Granularity;
+        VkPhysicalDeviceMemoryProperties m_Properties;
+        // [type][linear, optimal]
+        std::array<std::array<Pool, 2>, VK_MAX_MEMORY_TYPES> m_Pools;
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS>        m_Dedicated;
+        u32                m_DeviceAllocations;
+        mutable std::mutex m_Mutex;
+    };
+
+}
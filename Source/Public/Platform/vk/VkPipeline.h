@@ -4,6 +4,7 @@
 #include "Platform/vk/VkShader.h"
 #include "Platform/vk/VkDeviceManager.h"
 #include "Platform/vk/VkSwapchain.h"
+#include <span>
 
 namespace aby::vk {
 
@@ -12,14 +13,30 @@ namespace aby::vk {
 	class Pipeline {
 	public:
 		Pipeline();
-		Pipeline(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, Swapchain& swapchain);
+		/**
+		* @param color_format Format of the color attachment, the swapchain's.
+		* @param instanced   Build from the module's instance vertex stage, its inputs advance per instance.
+		* @param permutation Shader permutation to build, names separated by '+' (see ShaderCompiler::permutation_key).
+		* @param stages      Shader stages in place of the module's own, see ShaderModule::stages(bool, const Stages&, const std::string&).
+		*/
+		Pipeline(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, VkFormat color_format, bool instanced = false, std::string_view permutation = {}, std::span<const VkPipelineShaderStageCreateInfo> stages = {});
 		
-		void create(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, Swapchain& swapchain);
+		void create(Window* window, DeviceManager& manager, Ref<ShaderModule> shaders, VkFormat color_format, bool instanced = false, std::string_view permutation = {}, std::span<const VkPipelineShaderStageCreateInfo> stages = {});
 		void destroy();
+		/**
+		* @brief Take over the pipeline of other (built from the same module), see ShaderReloader.
+		* @return The previous pipeline, the caller destroys it once no frame in flight uses it.
+		*/
+		VkPipeline replace(Pipeline&& other);
 
-		void bind(VkCommandBuffer buffer);
+		/**
+		* @param dynamic_offsets Of the module's uniform bindings, see ShaderModule::dynamic_offsets (the default).
+		*/
+		void bind(VkCommandBuffer buffer, std::span<const u32> dynamic_offsets = {});
 
 		Ref<ShaderModule> shaders();
+		bool instanced() const;
+		const std::string& permutation() const;
 		VkPipelineRenderingCreateInfo create_info();
 
 		operator VkPipeline();
@@ -29,6 +46,8 @@ namespace aby::vk {
 		VkPipeline m_Pipeline;
 		VkPipelineRenderingCreateInfo m_CreateInfo;
 		VkFormat m_ColorAttachment;
+		bool m_Instanced;
+		std::string m_Permutation;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "Platform/vk/VkCommon.h"
+#include "Core/Common.h"
+
+namespace aby::vk {
+
+    /**
+    * @brief VkPipelineCache persisted across runs, shared by every pipeline of the device.
+    *        The file is only used if its header matches the device (vendor, device id and cache UUID),
+    *        drivers reject foreign data anyway but some only after a costly parse.
+    */
+    class PipelineCache {
+    public:
+        PipelineCache();
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache(PipelineCache&&) noexcept = delete;
+        ~PipelineCache() = default;
+
+        /**
+        * @param path Loaded if it exists and matches the device, written back by save() and destroy().
+        */
+        void create(VkPhysicalDevice physical, VkDevice logical, const fs::path& path);
+        /**
+        * @brief Save and destroy the cache, does nothing if it was never created.
+        */
+        void destroy();
+        /**
+        * @brief Write the driver's current cache data to the path given to create.
+        */
+        void save();
+
+        operator VkPipelineCache() const;
+    private:
+        bool matches(const std::vector<std::byte>& data) const;
+    private:
+        VkDevice                   m_Device;
+        VkPipelineCache            m_Cache;
+        fs::path                   m_Path;
+        VkPhysicalDeviceProperties m_Properties;
+    };
+
+}
@@ -5,8 +5,11 @@
 #include "Platform/vk/VkBuffer.h"
 #include "Platform/vk/VkShader.h"
 #include "Platform/vk/VkContext.h"
+#include "Rendering/BatchKernels.h"
+#include "Rendering/TextLayout.h"
 #include "Rendering/Vertex.h"
 #include <array>
+#include <span>
 
 namespace aby::vk {
 
@@ -15,15 +18,30 @@ namespace aby::vk {
         u32 MaxIndices;
         u32 IndicesPer;
         u32 VerticesPer;
+        u32 InstanceVertices = 0; // Non zero: every "vertex" is an instance record expanded into this many vertices by the shader.
     };
 
+    /**
+    * @brief Vertices of one primitive type for the current frame. When a batch fills up, next_batch()
+    *        closes it and continues in a fresh ring slice, every batch is drawn within the same frame.
+    *        Instanced primitives (PrimitiveDescriptor::InstanceVertices) store one record per instance instead.
+    */
     class RenderPrimitive {
     public:
         RenderPrimitive(Ref<vk::Context> ctx, const ShaderDescriptor& vertex_descriptor, const PrimitiveDescriptor& primitive_descriptor);
 
         void destroy();
         void reset();
-        void bind(VkCommandBuffer cmd, DeviceManager& manager);
+        /**
+        * @brief Select the vertex ring regions of the frame in flight, see Renderer::begin_frame.
+        *        The accumulator writes straight into them.
+        */
+        void begin_frame(u32 frame);
+        /**
+        * @brief Close the current batch and continue in a new slice, chaining another ring if the region is full.
+        */
+        void next_batch();
+        void bind(VkCommandBuffer cmd);
         void draw(VkCommandBuffer cmd);
 
         void set_index_data(const u32* indices, DeviceManager& manager);
@@ -31,8 +49,10 @@ namespace aby::vk {
         bool should_flush() const;
         bool should_flush(std::size_t requested_primitives) const;
         bool empty() const;
+        bool is_instanced() const;
         std::size_t index_count() const;
         std::size_t vertex_count() const;
+        std::size_t batch_count() const;
         const vk::PrimitiveDescriptor& descriptor() const;
 
         RenderPrimitive& operator++();
@@ -42,53 +62,126 @@ namespace aby::vk {
             m_VertexAccumulator = data;
             return *this;
         }
+
+        /**
+        * @brief Claim up to count vertices (instances) in the current batch to be written in place, rounded down
+        *        to whole primitives. Returns fewer if the batch fills up, next_batch() makes room for the rest.
+        */
+        template <typename T>
+        std::span<T> push(std::size_t count) {
+            ABY_ASSERT(sizeof(T) == m_VertexAccumulator.vertex_size(), "incompatible vertex size");
+            auto claimed = push_bytes(count);
+            return std::span<T>(reinterpret_cast<T*>(claimed.data()), claimed.size() / sizeof(T));
+        }
     protected:
-        void draw_indexed(VkCommandBuffer cmd);
-        void draw_nonindexed(VkCommandBuffer cmd);
+        struct Batch {
+            VkBuffer     buffer;
+            VkDeviceSize offset;
+            u32          vertices;
+            u32          indices;
+        };
+
+        void map_slice();
+        std::span<std::byte> push_bytes(std::size_t count);
+        void draw_indexed(VkCommandBuffer cmd, const Batch& batch);
+        void draw_nonindexed(VkCommandBuffer cmd, const Batch& batch);
+        void draw_instanced(VkCommandBuffer cmd, const Batch& batch);
     private:
-        vk::VertexClass       m_VertexClass;
-        vk::VertexAccumulator m_VertexAccumulator;
-        vk::VertexBuffer      m_VertexBuffer;
-        vk::IndexBuffer       m_IndexBuffer;
-        PrimitiveDescriptor   m_Descriptor;
-        std::size_t           m_IndexCount;
+        DeviceManager*                  m_Devices;
+        vk::VertexClass                 m_VertexClass;
+        vk::VertexAccumulator           m_VertexAccumulator;
+        std::vector<Unique<RingBuffer>> m_Rings;
+        std::size_t                     m_Ring;
+        u32                             m_Frame;
+        RingBuffer::Slice               m_Slice;
+        std::vector<Batch>              m_Batches;
+        Unique<vk::IndexBuffer>         m_IndexBuffer; // Only for primitives with IndicesPer != VerticesPer
+        PrimitiveDescriptor             m_Descriptor;
+        std::size_t                     m_IndexCount;
     };
 
     enum class ERenderPrimitive {
         TRIANGLE = 0,
-        QUAD     = 1,
-        MAX_ENUM = 2,
+        QUAD     = 1, // Instanced, see Instance.glsl
+        CUBE     = 2, // Instanced, see Instance.glsl
+        MAX_ENUM = 3,
         ALL,
     };
 
     using RenderPrimitiveArray = std::array<RenderPrimitive, static_cast<std::size_t>(ERenderPrimitive::MAX_ENUM)>;
 
+    /**
+    * @brief Triangles go through the vertex pipeline, quads, glyphs and cubes are one instance record each
+    *        and go through the instance pipeline built from the module's instance stage.
+    */
     class RenderModule {
     public:
-        RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, const std::vector<fs::path>& shaders);
-        RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, Ref<ShaderModule> module);
+        static constexpr u32 MAX_PUSH_CONSTANTS = 128; // Guaranteed by every device
+        /**
+        * @param shaders     Vertex, fragment and instance vertex stage.
+        * @param permutation Shader permutation both pipelines are built with, see Pipeline.
+        */
+        RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, const std::vector<fs::path>& shaders, std::string_view permutation = {});
+        RenderModule(Ref<vk::Context> ctx, vk::Swapchain& swapchain, Ref<ShaderModule> module, std::string_view permutation = {});
 
         void destroy();
         void reset();
+        void begin_frame(u32 frame);
+        /**
+        * @brief Start a new batch of primitive within the same frame, see RenderPrimitive::next_batch.
+        */
+        void next_batch(ERenderPrimitive primitive);
         void flush(VkCommandBuffer cmd, DeviceManager& manager, ERenderPrimitive primitive = ERenderPrimitive::ALL);
+        /**
+        * @brief Uniform block for the draws flushed from now on, see ShaderModule::set_uniforms.
+        */
         void set_uniforms(const void* data, std::size_t bytes, u32 binding = 0);
+        /**
+        * @brief Push constants for the draws flushed from now on (e.g. the view projection), pushed after every bind.
+        */
+        void push_constants(const void* data, std::size_t bytes);
         
         void draw_triangle(const Triangle& triangle);
         void draw_quad(const Quad& quad);
         void draw_cube(const Quad& quad);
+        /**
+        * @brief Lays the text out once (see TextLayoutCache), redrawing it only translates the cached glyphs.
+        */
         void draw_text(const Text& text);
+        /**
+        * @brief Batch versions of draw_quad/draw_cube, the records are written straight into the vertex ring
+        *        by the SIMD kernels (see BatchKernels.h). Textures are resolved like in Renderer::draw_quad.
+        */
+        void draw_quads(std::span<const Quad> quads);
+        void draw_cubes(std::span<const Quad> cubes);
+        void draw_glyph_run(std::span<const GlyphQuad> glyphs, const GlyphRun& run);
+        /**
+        * @brief Copy the glyphs rasterized this frame into the atlas pages of the fonts drawn this frame.
+        *        Recorded before rendering, the copies are ordered after the previous frames' draws by the queue.
+        */
+        void upload_glyphs(VkCommandBuffer cmd);
 
         Ref<ShaderModule> module() const;
         vk::Pipeline&     pipeline();
+        vk::Pipeline&     instance_pipeline();
         RenderPrimitive&  quads();
+        RenderPrimitive&  cubes();
         RenderPrimitive&  tris();
     private:
-        void init();
+        void write_quads(RenderPrimitive& prim, std::span<const Quad> quads, bool flat);
+        void resolve_textures(std::span<const Quad> quads, QuadInstance* out);
     private:
-        vk::Context*          m_Ctx;
-        Ref<ShaderModule>     m_Module;
-        vk::Pipeline          m_Pipeline;
-        RenderPrimitiveArray  m_Primitives;
+        vk::Context*           m_Ctx;
+        Ref<ShaderModule>      m_Module;
+        vk::Pipeline           m_Pipeline;
+        vk::Pipeline           m_InstancePipeline;
+        std::vector<u32>       m_UniformOffsets; // Own offsets, the module is shared with other render modules
+        std::array<std::byte, MAX_PUSH_CONSTANTS> m_PushConstants;
+        u32                    m_PushConstantBytes;
+        RenderPrimitiveArray   m_Primitives;
+        TextLayoutCache        m_TextLayouts;
+        std::vector<Ref<Font>> m_GlyphFonts;   // Drawn this frame
+        Unique<RingBuffer>     m_GlyphStaging; // Dirty atlas rectangles
     };
 
 
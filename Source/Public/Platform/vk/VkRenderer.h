@@ -2,9 +2,11 @@
 #include "Platform/vk/VkContext.h"
 #include "Platform/vk/VkCmdBuff.h"
 #include "Platform/vk/VkRenderModule.h"
+#include "Platform/vk/VkShaderReloader.h"
 #include "Rendering/Renderer.h"
 #include "Rendering/Vertex.h"
 #include <glm/glm.hpp>
+#include <array>
 
 namespace aby::vk {
 
@@ -22,14 +24,22 @@ namespace aby::vk {
         void draw_triangle(const Triangle& triangle) override;
         void draw_quad(const Quad& quad) override;
         void draw_cube(const Quad& quad) override;
+        void draw_quads(std::span<const Quad> quads) override;
+        void draw_cubes(std::span<const Quad> cubes) override;
 
         vk::RenderModule& rm2d();
         vk::RenderModule& rm3d();
     protected: 
+        /**
+        * @brief Wait until the GPU released the resources of the next frame in flight
+        *        (vertex ring regions) and hand them to the render modules.
+        */
+        void begin_frame();
         void render(u32 img);
         void start_batch(RenderModule& module);
         void flush(RenderModule& module, ERenderPrimitive primitive);
         void flush_if(RenderModule& module, bool flush, ERenderPrimitive primitive);
+        float resolve_texture(float texture) const;
     private:
         bool on_resize(WindowResizeEvent& event);
         bool on_resize(u32 w, u32 h);
@@ -42,7 +52,11 @@ namespace aby::vk {
         vk::Swapchain m_Swapchain;
         RenderModule m_2D;
         RenderModule m_3D;
+        ShaderReloader m_Reloader;
         std::vector<VkSemaphore> m_RecycledSemaphores;
+        std::array<VkFence, MAX_FRAMES_IN_FLIGHT> m_FrameFences;
+        u32 m_Frame;
+        bool m_FrameStarted;
         u32 m_Img;
     };
 
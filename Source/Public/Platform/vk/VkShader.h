@@ -3,8 +3,13 @@
 #include "Platform/vk/VkCommon.h"
 #include "Platform/vk/VkDeviceManager.h"
 #include "Rendering/Shader.h"
+#include "Rendering/UniformRing.h"
+#include <array>
 #include <map>
+#include <mutex>
 #include <filesystem>
+#include <optional>
+#include <span>
 
 namespace aby::vk {
 
@@ -34,6 +39,20 @@ namespace aby::vk {
     };
     
     struct ShaderDescriptor {
+        /**
+        * @brief Bumped whenever ShaderCompiler::reflect or the serialized layout changes, older sidecars are reflected again.
+        */
+        static constexpr u32 VERSION = 2;
+
+        /**
+        * @brief Compact binary form, stored next to the cached SPIR-V (see ShaderCompiler::compile).
+        */
+        std::vector<std::byte> serialize() const;
+        /**
+        * @return nullopt if data is truncated or from another VERSION.
+        */
+        static std::optional<ShaderDescriptor> deserialize(std::span<const std::byte> data);
+
         std::map<std::size_t, std::size_t> uniform_binding_sizes() const;
         std::map<std::size_t, std::size_t> input_binding_sizes() const;
         std::map<std::size_t, std::size_t> input_binding_stride() const;
@@ -43,6 +62,7 @@ namespace aby::vk {
         std::vector<ShaderStorage> storages;
         std::vector<ShaderSampler> samplers;
         std::vector<ShaderInput>   inputs;
+        u32                        push_constants = 0; // Bytes of the push_constant block, 0 if there is none
     };
     
     class VertexClass {
@@ -68,6 +88,25 @@ namespace aby::vk {
 
     class Context;
 
+    /**
+    * @brief Specialization constant ids, the glsl declares them with the injected <NAME>_ID macros, e.g.
+    *        layout(constant_id = MAX_TEXTURE_SLOTS_ID) const uint MAX_TEXTURE_SLOTS = 1;
+    *        Device and build dependent values are set when the pipeline is created rather than compiled in,
+    *        so the cached SPIR-V is the same on every machine and build type.
+    */
+    enum class ESpecConstant : u32 {
+        MAX_TEXTURE_SLOTS = 0, // uint, elements of the bindless array (DeviceManager::max_texture_slots())
+        DEBUG             = 1, // bool, false if NDEBUG
+        MAX_ENUM          = 2,
+    };
+
+    struct CompiledShader {
+        std::vector<u32>         spirv;
+        ShaderDescriptor         descriptor;
+        std::vector<fs::path>    sources;      // The glsl file first, then every file it includes
+        std::vector<std::string> permutations; // Keys declared by the glsl file, see ShaderCompiler::permutation_key
+    };
+
     class Shader : public aby::Shader {
     public:
         Shader(App* app, DeviceManager& devices, const fs::path& path, EShader type = EShader::FROM_EXT);
@@ -76,54 +115,164 @@ namespace aby::vk {
         static Ref<Shader> create(aby::App* app, DeviceManager& devices, const fs::path& path, EShader type);
 
         void destroy();
+        /**
+        * @brief Destroy the VkShaderModules (of every permutation) but keep the descriptor set layout, sets allocated
+        *        with it may still be updated (see ShaderModule::swap_stages).
+        */
+        void destroy_module();
 
         const ShaderDescriptor& descriptor() const;
         VkDescriptorSetLayout layout() const;
-        VkPipelineShaderStageCreateInfo stage() const;
+        /**
+        * @param permutation Key of a declared permutation, the default module if this stage does not declare it.
+        */
+        VkPipelineShaderStageCreateInfo stage(const std::string& permutation = {}) const;
+        bool has_permutation(const std::string& permutation) const;
+        /**
+        * @brief Files the SPIR-V (of every permutation) was compiled from, as of the last compile (or cache hit).
+        */
+        const std::vector<fs::path>& sources() const;
 
         operator VkShaderModule() const;
+    private:
+        Shader(DeviceManager& devices, const fs::path& path, EShader type, CompiledShader&& compiled);
+        VkShaderModule create_module(std::span<const u32> spirv) const;
     private:
         VkDevice m_Logical;
         VkShaderModule m_Module;
         VkDescriptorSetLayout m_Layout;
         ShaderDescriptor m_Descriptor;
+        std::vector<fs::path> m_Sources;
+        std::vector<std::string> m_PermutationKeys;
+        std::map<std::string, VkShaderModule> m_Permutations;
+        std::array<VkSpecializationMapEntry, static_cast<std::size_t>(ESpecConstant::MAX_ENUM)> m_SpecEntries;
+        std::array<u32, static_cast<std::size_t>(ESpecConstant::MAX_ENUM)> m_SpecData;
+        VkSpecializationInfo m_Specialization; // Points into m_SpecEntries and m_SpecData
     };
 
+    class Texture;
     class TextureResourceHandler;
 
+    /**
+    * @brief Pipeline layout and descriptor sets shared by a vertex, fragment and optional instance stage.
+    *        Uniform blocks are dynamic uniform buffers in a persistently mapped ring with one slice per frame in flight,
+    *        set_uniforms copies into the current slice and moves the dynamic offset, the descriptors are written once.
+    *        They live in set 0 (vertex stages), the update after bind bindless array in set 1 (fragment stage).
+    *        Small per-draw data (e.g. the view projection) goes through the push_constant block instead.
+    */
     class ShaderModule {
     public:
-        ShaderModule(vk::Context* ctx, const fs::path& vert, const fs::path& frag);
+        static constexpr u32 UNIFORM_WRITES_PER_FRAME = 16; // Per uniform binding
+
+        struct Stages {
+            Resource vertex;
+            Resource fragment;
+            Resource instance;
+        };
+
+        /**
+        * @param instance Optional second vertex stage whose inputs advance per instance (see Instance.glsl).
+        *        It shares the pipeline layout and descriptor sets, so it must declare the same uniforms as vert.
+        */
+        ShaderModule(vk::Context* ctx, const fs::path& vert, const fs::path& frag, const fs::path& instance = {});
 
-        static Ref<ShaderModule> create(vk::Context* ctx, const fs::path& vert, const fs::path& frag);
+        static Ref<ShaderModule> create(vk::Context* ctx, const fs::path& vert, const fs::path& frag, const fs::path& instance = {});
         void destroy();
 
+        /**
+        * @brief Select the uniform ring slice of the frame in flight, see Renderer::begin_frame.
+        */
+        void begin_frame(u32 frame);
+        /**
+        * @brief Copy the block of a vertex stage uniform binding into the frame's slice and point dynamic_offsets() at it.
+        *        Earlier writes of this frame stay intact, draws recorded with their offsets still see them.
+        */
         void set_uniforms(const void* data, std::size_t bytes, u32 binding = 0);
-        void update_descriptor_set(u32 binding, std::size_t bytes);
-        void update_uniform_memory(const void* data, std::size_t bytes);
+        /**
+        * @brief Offsets of the latest set_uniforms per uniform binding (in binding order), for vkCmdBindDescriptorSets.
+        */
+        std::span<const u32> dynamic_offsets() const;
+        /**
+        * @brief Range of the push_constant blocks of all stages, size 0 if none declares one.
+        */
+        const VkPushConstantRange& push_constants() const;
+        /**
+        * @brief Write the bindless (and ImGui) descriptors of the textures added since the last call in a single
+        *        vkUpdateDescriptorSets. Textures erased before the last MAX_FRAMES_IN_FLIGHT + 1 calls are destroyed
+        *        (with their ImGui sets) and their handles released for reuse.
+        *        Called once per frame before its commands are recorded, see Renderer::render.
+        */
+        void flush_texture_writes();
 
         Resource vert() const;
         Resource frag() const;
+        Resource instance() const;
+        bool has_instance_stage() const;
         const VertexClass& vertex_class() const;
         const ShaderDescriptor& vertex_descriptor() const;
+        const ShaderDescriptor& instance_descriptor() const;
 
         VkPipelineLayout layout() const;
         const std::vector<VkDescriptorSet>& descriptors() const;
         std::vector<VkDescriptorSet>& descriptors();
         VkDescriptorPool pool();
 
-        std::vector<VkPipelineShaderStageCreateInfo> stages() const;
+        /**
+        * @param instanced   Use the instance vertex stage in place of the vertex stage.
+        * @param permutation Key of a permutation declared by at least one of the stages, see ShaderCompiler::permutation_key.
+        */
+        std::vector<VkPipelineShaderStageCreateInfo> stages(bool instanced = false, const std::string& permutation = {}) const;
+        /**
+        * @brief Stages of from in place of the current ones, to build pipelines before swap_stages.
+        */
+        std::vector<VkPipelineShaderStageCreateInfo> stages(bool instanced, const Stages& from, const std::string& permutation = {}) const;
+        Stages stage_resources() const;
+        /**
+        * @brief Whether stages declare the same descriptors as the current ones, the pipeline layout
+        *        and descriptor sets can only be kept if they do.
+        */
+        bool compatible(const Stages& stages) const;
+        /**
+        * @brief Use stages from now on (see ShaderReloader), they must be compatible().
+        *        Pipelines are built already, the first stages only keep their descriptor set layouts until destroy(),
+        *        the sets were allocated with them.
+        * @return The replaced stages created by an earlier swap_stages (null otherwise), the caller destroys and erases
+        *         them once no pipeline in flight uses them.
+        */
+        Stages swap_stages(const Stages& stages);
     protected:
-        void create_uniform_buffer(std::size_t size);
+        void create_uniform_ring();
+    private:
+        struct TextureWrite {
+            Resource::Handle      handle; // Element of the bindless array
+            VkDescriptorImageInfo image;
+            VkDescriptorSet       imgui;
+        };
+        struct TextureRelease {
+            Ref<vk::Texture> texture; // Destroyed with the release
+            Resource::Handle handle;  // Released to Context::textures() for reuse
+            VkDescriptorSet  imgui;
+            u32              frames;  // Flushes until no frame in flight uses the texture
+        };
     private:
         vk::Context* m_Ctx;
         VkPipelineLayout m_Layout;
         Resource m_Vertex;
         Resource m_Fragment;
+        Resource m_Instance;
         VkDescriptorPool m_Pool;
         std::vector<VkDescriptorSet> m_Descriptors;
         VkBuffer m_Uniforms;
-        VkDeviceMemory m_UniformMemory;
+        Allocation m_UniformMemory;
+        std::vector<u32> m_UniformBindings; // Dynamic uniform buffers of set 0, in binding order
+        std::vector<std::size_t> m_UniformSizes;
+        std::vector<u32> m_UniformOffsets;
+        UniformRing m_Ring;
+        VkPushConstantRange m_PushConstants;
+        std::mutex m_TextureMutex; // Textures are added and erased on the loading threads
+        std::vector<TextureWrite> m_TextureWrites;
+        std::vector<TextureRelease> m_TextureReleases;
+        Stages m_Replaced; // First stages swapped out, see swap_stages
         VertexClass m_Class;
         friend class TextureResourceHandler;
     };
@@ -135,7 +284,25 @@ namespace aby::vk {
 
     class ShaderCompiler {
     public:
-        static std::vector<u32> compile(App* app, DeviceManager& devices, const fs::path& path, EShader type = EShader::FROM_EXT);
+        /**
+        * @brief Bumped whenever the cache layout or the compile options change.
+        */
+        static constexpr u32 CACHE_VERSION = 2;
+
+        /**
+        * @brief SPIR-V of a glsl file, cached in cache_dir() under a hash of the preprocessed source
+        *        (includes resolved, macros expanded), the defines, target environment and shaderc version.
+        *        Any of those changing is a cache miss and recompiles, see Cache/Shaders/manifest.
+        *        The reflected descriptor is cached in a sidecar under the same key, a hit never runs SPIRV-Cross.
+        *        Thread safe, every calling thread compiles with its own shaderc::Compiler.
+        * @param permutation Key of a "#pragma permutation" line of the file, its names are defined as 1.
+        * @throws std::runtime_error naming the file if it could not be read or compiled.
+        */
+        static CompiledShader compile(App* app, const fs::path& path, EShader type = EShader::FROM_EXT, const std::string& permutation = {});
+        /**
+        * @brief Normalized key of a '+' or space separated list of permutation names (sorted, without duplicates).
+        */
+        static std::string permutation_key(std::string_view names);
         static EShader get_type_from_ext(const fs::path& ext);
         static fs::path cache_dir(App* app, const fs::path& file = "");
         static ShaderDescriptor reflect(const std::vector<u32>& binary_data);
@@ -0,0 +1,66 @@
+#pragma once
+#include "Core/Common.h"
+#include "Core/JobSystem.h"
+#include "Platform/FileWatcher.h"
+#include "Platform/vk/VkPipeline.h"
+#include "Platform/vk/VkShader.h"
+#include <mutex>
+#include <set>
+#include <span>
+
+namespace aby::vk {
+
+    class Context;
+    class RenderModule;
+
+    /**
+    * @brief Recompiles the stages of a ShaderModule whose glsl sources (or includes) changed on disk.
+    *        The stages compile and the replacement pipelines build on the JobSystem while the old ones keep drawing,
+    *        update() swaps them in at the start of a frame and destroys the old pipelines and shaders once no frame in flight uses them.
+    *        A stage that fails to compile or changes the descriptors (uniforms, samplers, inputs) is not swapped in,
+    *        the pipeline layout and descriptor sets are shared, such edits take a restart.
+    */
+    class ShaderReloader {
+    public:
+        ShaderReloader(vk::Context* ctx, Ref<ShaderModule> module);
+
+        /**
+        * @brief Called once per frame after the frame's fence was waited on.
+        * @param modules Render modules drawing with the watched ShaderModule, their pipelines are replaced.
+        */
+        void update(std::span<RenderModule* const> modules, const Swapchain& swapchain);
+        /**
+        * @brief Wait for a rebuild in flight and destroy everything not swapped in, the device must be idle.
+        */
+        void destroy();
+    private:
+        struct Rebuild {
+            ShaderModule::Stages  stages;
+            std::vector<Resource> compiled; // New stages, a subset of stages
+            std::vector<Pipeline> pipelines; // Vertex and instance pipeline per render module
+            VkFormat              format = VK_FORMAT_UNDEFINED; // Of the swapchain when the rebuild started
+            Unique<WaitGroup>     done;
+            bool                  ok = false; // Written by the job, read once done
+        };
+        struct Retired {
+            std::vector<VkPipeline> pipelines;
+            std::vector<Resource>   stages; // Shaders the pipelines were built from
+            u32                     frames; // Frames to start before no frame in flight uses them
+        };
+
+        void watch(const ShaderModule::Stages& stages);
+        void start(std::span<RenderModule* const> modules, const Swapchain& swapchain, const std::set<fs::path>& changed);
+        void finish(std::span<RenderModule* const> modules, const Swapchain& swapchain);
+        void discard(Rebuild& rebuild);
+        void destroy(Retired& retired);
+    private:
+        vk::Context*              m_Ctx;
+        Ref<ShaderModule>         m_Module;
+        Unique<sys::FileWatcher>  m_Watcher;
+        std::mutex                m_Mutex;
+        std::set<fs::path>        m_Changed; // Guarded by m_Mutex, filled by the watcher thread
+        Unique<Rebuild>           m_Rebuild;
+        std::vector<Retired>      m_Retired;
+    };
+
+}
@@ -2,6 +2,7 @@
 #include "Platform/vk/VkCommon.h"
 #include "Platform/vk/VkBuffer.h"
 #include "Rendering/Texture.h"
+#include <functional>
 
 namespace aby::vk {
     
@@ -10,13 +11,19 @@ namespace aby::vk {
     class Texture : public aby::Texture {
     public:
         Texture(vk::Context* ctx); 
-        Texture(vk::Context* ctx, const fs::path& path);
+        Texture(vk::Context* ctx, const fs::path& path, bool retain_data = false);
         Texture(vk::Context* ctx, const glm::u32vec2& size, const glm::vec4& color);
         Texture(vk::Context* ctx, const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels);
         Texture(const Texture& other);
         Texture(Texture&& other) noexcept;
         ~Texture();
 
+        /**
+        * @brief Queue the pixel copy on the context's Uploader. The texture must not be
+        *        sampled before on_complete ran (on the upload thread).
+        */
+        void upload(vk::Context* ctx, std::function<void()>&& on_complete);
+
         VkImage img();
         VkImageView view();
         VkSampler sampler();
@@ -25,16 +32,25 @@ namespace aby::vk {
         VkDescriptorSet& imgui_descriptor();
         ImTextureID imgui_id() const override;
     protected:
-        void init(vk::Context* ctx);
+        Texture(vk::Context* ctx, const fs::path& path, const std::pair<glm::u32vec2, u32>& info, bool retain_data);
+
+        using Fill = std::function<void(std::span<std::byte>)>;
+        /**
+        * @brief Create the image, view and sampler. fill writes the pixels straight into mapped
+        *        staging memory, which is kept until upload() hands it to the Uploader.
+        */
+        void init(vk::Context* ctx, const Fill& fill);
     private:
         VkDevice m_Logical;
         VkFormat m_Format;
         VkImageLayout m_Layout;
         VkImage m_Image;
         VkImageView m_View;
-        VkDeviceMemory m_ImageMemory;
+        MemoryAllocator* m_Memory;
+        Allocation m_Allocation;
         VkSampler m_Sampler;
         VkDescriptorSet m_ImGuiID;
+        Ref<StagingBuffer> m_Staging;
     };
 
 }
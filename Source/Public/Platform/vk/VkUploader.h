@@ -0,0 +1,67 @@
+#pragma once
+#include "Platform/vk/VkCommon.h"
+#include "Platform/vk/VkBuffer.h"
+#include "Platform/vk/VkCmdPool.h"
+#include "Platform/vk/VkDeviceManager.h"
+#include "Core/Common.h"
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace aby {
+    class Thread;
+}
+
+namespace aby::vk {
+
+    /**
+    * @brief Batches staging buffer -> image copies onto the transfer queue.
+    *        Requests queued from any thread are recorded into one command buffer and
+    *        submitted together by the upload thread, which waits on a fence (not the queue)
+    *        and then runs the completion callbacks of the batch.
+    */
+    class Uploader {
+    public:
+        using OnComplete = std::function<void()>;
+
+        static constexpr std::size_t MAX_BATCH = 256;
+    public:
+        Uploader();
+        Uploader(const Uploader&) = delete;
+        Uploader(Uploader&&) noexcept = delete;
+        ~Uploader();
+
+        void create(DeviceManager& devices);
+        void destroy();
+
+        /**
+        * @brief Copy staging into image and leave it in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+        *        The staging buffer is destroyed once the batch completed, on_complete runs on the upload thread.
+        */
+        void upload(Ref<StagingBuffer> staging, VkImage image, const glm::u32vec2& size, OnComplete&& on_complete);
+        std::size_t pending() const;
+    private:
+        struct Request {
+            Ref<StagingBuffer> staging;
+            VkImage            image;
+            glm::u32vec2       size;
+            OnComplete         on_complete;
+        };
+
+        void work();
+        void submit(std::vector<Request>& batch);
+    private:
+        DeviceManager*          m_Devices;
+        CmdPool                 m_Pool;
+        VkCommandBuffer         m_Cmd;
+        VkFence                 m_Fence;
+        std::vector<Request>    m_Pending;
+        mutable std::mutex      m_Mutex;
+        std::condition_variable m_CondVar;
+        bool                    m_Stop;
+        Unique<Thread>          m_Thread;
+    };
+
+}
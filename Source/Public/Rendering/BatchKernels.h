@@ -0,0 +1,46 @@
+#pragma once
+#include "Core/Common.h"
+#include "Rendering/Vertex.h"
+#include <glm/glm.hpp>
+#include <span>
+
+namespace aby {
+
+    /**
+    * @brief One glyph of a GlyphRun, the metrics are in font units (unscaled).
+    */
+    struct GlyphQuad {
+        float     pen;     // x offset of the pen from the run origin, already scaled
+        glm::vec2 size;
+        glm::vec2 bearing;
+        glm::vec4 uv_rect; // xy = min texcoord, zw = max texcoord
+    };
+
+    /**
+    * @brief Values shared by every glyph of a run.
+    */
+    struct GlyphRun {
+        glm::vec3 origin;
+        float     scale;
+        float     height; // Measured text height the bearings are subtracted from
+        glm::vec4 color;
+        float     texture;
+        u32       flags;  // Or'ed into QuadInstance::texture, see QuadInstance::TEXTURE_SDF
+    };
+
+}
+
+/**
+* @brief Write many QuadInstance records at once. Each kernel has a scalar, SSE4.1 and AVX2 version,
+*        the one for simd_level() is picked at runtime. out needs room for one record per input
+*        and may point into mapped (write combined) memory, it is only written, never read.
+*/
+namespace aby::kernels {
+
+    /**
+    * @param flat Drop the z size, see RenderModule::draw_quad.
+    */
+    void write_quads(std::span<const Quad> quads, QuadInstance* out, bool flat);
+    void write_glyphs(std::span<const GlyphQuad> glyphs, const GlyphRun& run, QuadInstance* out);
+
+}
@@ -32,8 +32,9 @@ namespace aby {
         const ResourceClass<Texture>& textures() const;
         ResourceClass<Font>&          fonts();
         const ResourceClass<Font>&    fonts() const;
-        LoadThread&                   load_thread();
-        const LoadThread&             load_thread() const;
+        ResourceLoader&               loader();
+        const ResourceLoader&         loader() const;
+        EResourceState                state(Resource resource) const;
     protected:
         Context(App* app, Window* window);
     protected:
@@ -43,7 +44,7 @@ namespace aby {
         ResourceClass<Shader>  m_Shaders;
         ResourceClass<Texture> m_Textures;
         ResourceClass<Font>    m_Fonts;
-        LoadThread             m_LoadThread;
+        ResourceLoader         m_Loader;
     };
 
 }
\ No newline at end of file
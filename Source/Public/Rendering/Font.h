@@ -1,38 +1,95 @@
 #pragma once
 #include "Core/Common.h"
 #include "Core/Resource.h"
+#include "Rendering/GlyphAtlas.h"
+#include "Rendering/GlyphTable.h"
 #include "Rendering/Texture.h"
 
-#include <FT/abyft.h>
-
 #include <unordered_map>
 #include <fstream>
 
-
+struct FT_FaceRec_;
 
 namespace aby {
 
     class Context;
 
+    enum class EFontMode : u32 {
+        BITMAP = 0, // Coverage at the font's size
+        SDF    = 1, // Signed distance fields, sharp at any Text::scale
+    };
+
     class Font {
     public:
-        static Resource create(Context* ctx, const fs::path& path, u32 pt = 14);
+        static constexpr u32 SDF_SIZE   = 48; // Pixel size distance field glyphs are rasterized at
+        static constexpr u32 SDF_SPREAD = 8;  // Pixels of distance around the outline
+
+        /**
+        * @param pt   Size the metrics (and bitmap glyphs) are at, Text::scale scales from there.
+        * @param mode EFontMode::SDF rasterizes every glyph into atlas() as a distance field,
+        *             one font then serves all sizes through Text::scale.
+        */
+        static Resource create(Context* ctx, const fs::path& path, u32 pt = 14, EFontMode mode = EFontMode::BITMAP);
         ~Font();
         
+        /**
+        * @brief Single channel atlas of the prebaked glyphs (code points 32-127), see FontGlyph::PREBAKED.
+        */
         Resource          texture() const;
         std::string_view  name() const;
         u32               size() const;
-        const ft::Glyphs& glyphs() const;
+        /**
+        * @brief Every glyph known so far by code point.
+        */
+        const GlyphTable& glyph_table() const;
+        /**
+        * @brief Glyph of c for drawing. Code points outside the prebaked range are rasterized into
+        *        atlas() on first use (and again after their page was evicted).
+        *        Only used by the renderer while laying out text, not thread safe.
+        * @return nullptr if the face has no glyph for c or the atlas has no room this frame.
+        */
+        const FontGlyph*  glyph(char32_t c);
+        GlyphAtlas&       atlas();
+        EFontMode         mode() const;
         bool              is_mono() const;
         float             text_height() const;
         float             char_width() const;
+        /**
+        * @brief Unscaled size of UTF-8 text.
+        */
         glm::vec2         measure(const std::string& text) const;
     protected:
-        Font(Context* ctx, const fs::path& path, const glm::vec2& dpi, u32 pt = 14);
+        Font(Context* ctx, const fs::path& path, const glm::vec2& dpi, u32 pt, EFontMode mode, Resource atlas);
+    private:
+        const FontGlyph* rasterize(char32_t c);
+        /**
+        * @brief Name, line height and monospace flag from the face. Distance field fonts also get the
+        *        metrics of the prebaked range, bitmap fonts get them from prebake().
+        */
+        void describe(const fs::path& path);
+        /**
+        * @brief Rasterize the prebaked range into m_Pixels, replacing the table entries.
+        */
+        void prebake();
+        /**
+        * @brief Restore the metrics and prebaked pixels written by save() for this file, size and mode.
+        * @return false if there is no blob or it is outdated.
+        */
+        bool load(const fs::path& blob, const fs::path& source);
+        void save(const fs::path& blob, const fs::path& source) const;
     private:
         u32 m_SizePt;
-        ft::FontData  m_Data;
+        EFontMode     m_Mode;
+        float         m_SdfScale; // Font size over SDF_SIZE
+        std::string   m_Name;
+        float         m_TextHeight;
+        bool          m_IsMono;
+        GlyphTable    m_Table;
+        GlyphAtlas    m_Atlas;
+        FT_FaceRec_*  m_Face; // For glyphs outside the prebaked range
         Resource m_Texture;
+        glm::u32vec2           m_PixelsSize;
+        std::vector<std::byte> m_Pixels; // Prebaked glyphs until texture() takes them
     };
 
 
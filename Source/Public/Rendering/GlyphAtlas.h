@@ -0,0 +1,131 @@
+#pragma once
+#include "Core/Common.h"
+#include "Core/Resource.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace aby {
+
+    class Context;
+
+    /**
+    * @brief Skyline bottom-left rectangle packer. The skyline is the top edge of everything packed so far,
+    *        a rectangle goes where its top ends up lowest (ties: narrowest fit).
+    */
+    class SkylinePacker {
+    public:
+        explicit SkylinePacker(const glm::u32vec2& size);
+
+        /**
+        * @return Top left corner of the placed rectangle, nullopt if it does not fit.
+        */
+        std::optional<glm::u32vec2> pack(const glm::u32vec2& size);
+        void clear();
+    private:
+        struct Segment {
+            u32 x;
+            u32 y; // Height of the skyline over [x, x + w)
+            u32 w;
+        };
+
+        /**
+        * @return Top of a rectangle of width w placed at segment i, nullopt if it leaves the area.
+        */
+        std::optional<u32> fit(std::size_t i, u32 w, u32 h) const;
+    private:
+        glm::u32vec2         m_Size;
+        std::vector<Segment> m_Skyline;
+    };
+
+    /**
+    * @brief Single channel glyph pages filled on demand, see Font::glyph.
+    *        Every page keeps a CPU copy of its pixels and the rectangle written since the last upload,
+    *        the renderer only copies that rectangle (see upload()).
+    *        Once the memory budget is used up, the least recently used page is cleared and reused,
+    *        pages used in the current frame are never evicted.
+    */
+    class GlyphAtlas {
+    public:
+        static constexpr glm::u32vec2 PAGE_SIZE      = { 512, 512 };
+        static constexpr u32          PADDING        = 1; // Between glyphs, linear filtering must not bleed
+        static constexpr std::size_t  DEFAULT_BUDGET = 16 * PAGE_SIZE.x * PAGE_SIZE.y;
+
+        struct Region {
+            u32          page;
+            glm::u32vec2 offset;
+            glm::u32vec2 size;
+            glm::vec4    uv_rect;
+        };
+
+        /**
+        * @param offset, size Dirty rectangle of the page.
+        * @param pixels       Page pixels starting at offset, rows are PAGE_SIZE.x bytes apart.
+        * @return false to keep the rectangle dirty (e.g. the texture is not ready yet).
+        */
+        using Upload  = std::function<bool(Resource texture, const glm::u32vec2& offset, const glm::u32vec2& size, std::span<const std::byte> pixels)>;
+        using OnEvict = std::function<void(u32 page)>;
+    public:
+        GlyphAtlas(Context* ctx, std::size_t budget = DEFAULT_BUDGET);
+
+        /**
+        * @brief Reserve size pixels (plus padding), adding or evicting a page if none has room.
+        * @return nullopt if size exceeds a page or every page was used this frame and the budget is spent.
+        */
+        std::optional<Region> allocate(const glm::u32vec2& size);
+        /**
+        * @brief Copy an 8 bit coverage bitmap into region, rows are pitch bytes apart.
+        */
+        void write(const Region& region, const std::byte* pixels, i32 pitch);
+        /**
+        * @brief Mark page as used in the current frame.
+        */
+        void touch(u32 page);
+        /**
+        * @brief Hand the dirty rectangle of every page to upload.
+        */
+        void upload(const Upload& upload);
+        /**
+        * @brief Start a new frame for touch(), called by the renderer after upload().
+        */
+        void next_frame();
+        /**
+        * @brief Called before an evicted page is reused, the glyphs it held must not be drawn anymore.
+        */
+        void on_evict(OnEvict&& callback);
+
+        Resource    texture(u32 page) const;
+        std::size_t pages() const;
+        std::size_t bytes() const;
+        /**
+        * @brief Incremented on every eviction, layouts from an older generation may point at cleared pixels.
+        */
+        u64         generation() const;
+    private:
+        struct Page {
+            Resource               texture;
+            std::vector<std::byte> pixels;
+            SkylinePacker          packer;
+            glm::u32vec2           dirty_min;
+            glm::u32vec2           dirty_max; // Exclusive, nothing is dirty if not greater than dirty_min
+            u64                    last_used;
+        };
+
+        u32  add_page();
+        /**
+        * @return The least recently used page not used in this frame, nullopt if there is none.
+        */
+        std::optional<u32> evict();
+        void mark_dirty(Page& page, const glm::u32vec2& min, const glm::u32vec2& max);
+    private:
+        Context*          m_Ctx;
+        std::size_t       m_Budget;
+        std::vector<Page> m_Pages;
+        u64               m_Frame;
+        u64               m_Generation;
+        OnEvict           m_OnEvict;
+    };
+
+}
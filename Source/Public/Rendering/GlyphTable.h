@@ -0,0 +1,111 @@
+#pragma once
+#include "Core/Common.h"
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+
+namespace aby {
+
+    /**
+    * @brief Metrics of one glyph in pixels at the font's size, and where it lives in the font's atlases.
+    */
+    struct FontGlyph {
+        static constexpr u32 PREBAKED = ~0u;     // In Font::texture()
+        static constexpr u32 EVICTED  = ~0u - 1; // Metrics only, rasterized again on next use
+        static constexpr u32 MISSING  = ~0u - 2; // Not in the face
+        static constexpr u32 EMPTY    = ~0u - 3; // Nothing to draw (whitespace)
+
+        glm::vec2 size;
+        glm::vec2 bearing;
+        float     advance;
+        glm::vec4 uv_rect; // xy = min texcoord, zw = max texcoord
+        u32       page;    // GlyphAtlas page or one of the values above
+
+        /**
+        * @brief Has pixels in a texture right now.
+        */
+        bool resident() const { return page != EVICTED && page != MISSING; }
+    };
+
+    /**
+    * @brief Dense glyph metrics of a font for layout. Latin-1 is indexed directly,
+    *        the rest goes through a small open addressing table (linear probing, at most half full).
+    *        Glyphs are only ever added, pointers returned by find are invalidated by insert.
+    */
+    class GlyphTable {
+    public:
+        GlyphTable();
+
+        /**
+        * @return nullptr if the font has no glyph for c.
+        */
+        const FontGlyph* find(char32_t c) const;
+        FontGlyph*       find(char32_t c);
+        /**
+        * @throws std::out_of_range if the font has no glyph for c.
+        */
+        const FontGlyph& at(char32_t c) const;
+        /**
+        * @brief Add or replace the glyph of c.
+        */
+        FontGlyph&       insert(char32_t c, const FontGlyph& glyph);
+        std::size_t      size() const;
+
+        auto begin() { return m_Glyphs.begin(); }
+        auto end() { return m_Glyphs.end(); }
+    private:
+        static constexpr u32 DIRECT_RANGE = 256;
+        static constexpr u32 NONE         = ~0u;
+
+        struct Slot {
+            char32_t code;  // 0 marks an empty slot, code points below DIRECT_RANGE never get here
+            u32      index;
+        };
+
+        u32  slot(char32_t c) const;
+        u32  index(char32_t c) const;
+        void rehash(std::size_t capacity);
+        void place(char32_t c, u32 index);
+    private:
+        std::vector<FontGlyph>        m_Glyphs;
+        std::array<u32, DIRECT_RANGE> m_Direct;
+        std::vector<Slot>             m_Slots;
+        std::size_t                   m_Wide; // Used slots
+        u32                           m_Shift;
+    };
+
+    inline u32 GlyphTable::slot(char32_t c) const {
+        // Fibonacci hashing, the top bits index the power of two sized table.
+        return static_cast<u32>((static_cast<u64>(c) * 0x9E3779B97F4A7C15ull) >> m_Shift);
+    }
+
+    inline u32 GlyphTable::index(char32_t c) const {
+        if (c < DIRECT_RANGE) {
+            return m_Direct[c];
+        }
+        if (m_Slots.empty()) {
+            return NONE;
+        }
+        const u32 mask = static_cast<u32>(m_Slots.size() - 1);
+        for (u32 i = slot(c);; i = (i + 1) & mask) {
+            const Slot& s = m_Slots[i];
+            if (s.code == c) {
+                return s.index;
+            }
+            if (s.code == 0) {
+                return NONE;
+            }
+        }
+    }
+
+    inline const FontGlyph* GlyphTable::find(char32_t c) const {
+        const u32 i = index(c);
+        return i == NONE ? nullptr : &m_Glyphs[i];
+    }
+
+    inline FontGlyph* GlyphTable::find(char32_t c) {
+        const u32 i = index(c);
+        return i == NONE ? nullptr : &m_Glyphs[i];
+    }
+
+}
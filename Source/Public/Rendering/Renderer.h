@@ -4,6 +4,7 @@
 #include "Core/Event.h"
 #include "Rendering/Context.h"
 #include "Rendering/Vertex.h"
+#include <span>
 
 namespace aby {
 
@@ -23,6 +24,8 @@ namespace aby {
 		virtual void draw_quad(const Quad& quad) = 0;
 		virtual void draw_cube(const Quad& quad) = 0;
 		virtual void draw_text(const Text& text) = 0;
+		virtual void draw_quads(std::span<const Quad> quads) = 0;
+		virtual void draw_cubes(std::span<const Quad> cubes) = 0;
 	};
 
 }
\ No newline at end of file
@@ -22,7 +22,7 @@ namespace aby {
 		EShader type() const;
 		std::span<const u32> data() const;
 	protected:
-		Shader(const std::vector<u32>& data, EShader type);
+		Shader(std::vector<u32> data, EShader type);
 	protected:
 		EShader m_Type = EShader::MAX_ENUM;
 		std::vector<u32> m_Data;
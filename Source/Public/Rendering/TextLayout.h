@@ -0,0 +1,72 @@
+#pragma once
+#include "Core/Common.h"
+#include "Rendering/BatchKernels.h"
+#include "Rendering/Font.h"
+#include "Rendering/Vertex.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aby {
+
+    /**
+    * @brief Pre-positioned glyphs and highlights of a Text, relative to the text position.
+    *        Drawing it only translates them, see RenderModule::draw_text.
+    */
+    struct TextLayout {
+        /**
+        * @brief Glyphs sampling the same texture, drawn as one GlyphRun.
+        */
+        struct Run {
+            u32 page;  // FontGlyph::PREBAKED or a GlyphAtlas page
+            u32 first;
+            u32 count;
+        };
+
+        std::vector<GlyphQuad> glyphs; // Grouped by page
+        std::vector<Run>       runs;
+        std::vector<Quad>      highlights;
+        glm::vec2              size;       // Measured and scaled, the y is GlyphRun::height
+        u64                    generation = STALE; // GlyphAtlas::generation() of the font, STALE if a glyph did not fit
+
+        static constexpr u64 STALE = ~0ull;
+    };
+
+    /**
+    * @brief Lay out prefix + text with font: strip the tags, measure and look up every glyph.
+    *        Glyphs missing from the font's atlas are rasterized, see Font::glyph.
+    */
+    TextLayout layout_text(Font& font, const Text& text);
+
+    /**
+    * @brief Layouts of recently drawn texts, keyed by (prefix, text, font, scale).
+    *        The decorations are tags within the text, so they are part of the key.
+    *        A layout is redone once the font's atlas evicted a page, its glyphs may be gone.
+    *        Entries that were not drawn for MAX_IDLE_FRAMES frames are dropped by next_frame().
+    */
+    class TextLayoutCache {
+    public:
+        static constexpr u64 MAX_IDLE_FRAMES = 120;
+
+        /**
+        * @brief Cached layout of text, laid out on a miss. Valid until the next get() or next_frame().
+        */
+        const TextLayout& get(const Ref<Font>& font, const Text& text);
+        void next_frame();
+        void clear();
+
+        std::size_t size() const;
+    private:
+        struct Entry {
+            std::weak_ptr<Font> font; // A reloaded font is a new object, its layouts are stale
+            std::string         prefix;
+            std::string         text;
+            float               scale;
+            u64                 last_used;
+            TextLayout          layout;
+        };
+        std::unordered_map<u64, Entry> m_Entries;
+        u64                            m_Frame = 0;
+    };
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "Core/Common.h"
 #include "Core/Resource.h"
+#include "Core/Thread.h"
 #include <span>
 #include <glm/glm.hpp>
 #include <imgui/imgui.h>
@@ -12,24 +13,49 @@ namespace aby {
     class Texture {
     public:
         static Resource create(Context* ctx);
-        static Resource create(Context* ctx, const fs::path& path);
+        /**
+        * @param retain_data Keep a CPU copy of the pixels after upload (see Texture::data()).
+        */
+        static Resource create(Context* ctx, const fs::path& path, bool retain_data = false);
         static Resource create(Context* ctx, const glm::u32vec2& size, const glm::vec4& color);
         static Resource create(Context* ctx, const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels);
+        /**
+        * @brief Load an image into a handle reserved through ResourceLoader::reserve. Decodes on the calling thread,
+        *        the texture is added and done(true) called once the GPU copy finished.
+        */
+        static void     load(Context* ctx, Resource reserved, const fs::path& path, ResourceLoader::Done done, bool retain_data = false);
+        /**
+        * @brief Same as above for pixels already in memory (size.x * size.y * channels bytes), nothing is decoded.
+        */
+        static void     load(Context* ctx, Resource reserved, const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels, ResourceLoader::Done done);
 
         virtual ~Texture() = default;
         
         const glm::u32vec2& size() const;
         u32 channels() const;
         u64 bytes() const;
+        /**
+        * @brief CPU copy of the pixels. Empty once uploaded unless the texture was created to retain it.
+        */
         std::span<const std::byte> data() const;
         virtual ImTextureID imgui_id() const = 0;
     protected:
         Texture();
-        Texture(const fs::path& path);
-        Texture(const glm::u32vec2& size, const glm::vec4& color = glm::vec4(1.0f));
-        Texture(const glm::u32vec2& size, const std::vector<std::byte>& data, u32 channels);
+        Texture(const glm::u32vec2& size, u32 channels);
         Texture(const Texture& other);
         Texture(Texture&& other) noexcept;
+
+        /**
+        * @brief Read the image header only. 3 channel images report 4 channels, they are expanded while decoding.
+        */
+        static std::pair<glm::u32vec2, u32> read_info(const fs::path& path);
+        /**
+        * @brief Decode an image into dst (size.x * size.y * channels bytes), usually mapped staging memory.
+        */
+        static void decode(const fs::path& path, const glm::u32vec2& size, u32 channels, std::span<std::byte> dst);
+        void retain(std::span<const std::byte> data);
+    private:
+        static void upload(Context* ctx, Resource reserved, Ref<Texture> texture, ResourceLoader::Done done);
     private:
         glm::u32vec2 m_Size;
         u32 m_Channels;
@@ -0,0 +1,48 @@
+#pragma once
+#include "Core/Common.h"
+#include <span>
+
+namespace aby {
+
+    /**
+    * @brief Offsets of uniform blocks in a buffer with one slice per frame in flight (see vk::ShaderModule::set_uniforms).
+    *        Only the arithmetic, the owner maps the buffer and copies the blocks to the returned offsets.
+    */
+    class UniformRing {
+    public:
+        UniformRing();
+        /**
+        * @param sizes     Block size of every uniform binding.
+        * @param alignment Required alignment of an offset (minUniformBufferOffsetAlignment).
+        * @param writes    Writes per binding and frame before the slice wraps.
+        * @param frames    Frames in flight, one slice each.
+        */
+        UniformRing(std::span<const std::size_t> sizes, std::size_t alignment, u32 writes, u32 frames);
+
+        /**
+        * @brief Write into the slice of frame from now on, starting at its first byte.
+        */
+        void begin_frame(u32 frame);
+        /**
+        * @brief Whether a block of bytes still fits into the current slice without wrapping.
+        */
+        bool fits(std::size_t bytes) const;
+        /**
+        * @brief Reserve an aligned block of bytes in the current slice. If it does not fit(), the slice
+        *        wraps and the block overwrites the first blocks of this frame.
+        * @return Offset of the block from the start of the buffer.
+        */
+        std::size_t push(std::size_t bytes);
+
+        std::size_t align(std::size_t bytes) const;
+        std::size_t slice() const; // Bytes per frame in flight
+        std::size_t size() const;  // Bytes of the whole buffer
+    private:
+        std::size_t m_Alignment;
+        std::size_t m_Slice;
+        std::size_t m_Head; // Next free byte of the current slice
+        u32 m_Frame;
+        u32 m_Frames;
+    };
+
+}
@@ -27,6 +27,19 @@ namespace aby {
         Vertex v1, v2, v3;
     };
 
+    /**
+    * @brief GPU side record of a Vertex (32 instead of 48 bytes), see the packed inputs of Vertex.glsl.
+    */
+    struct PackedVertex {
+        explicit PackedVertex(const Vertex& vertex);
+
+        glm::vec3 pos;
+        u32       col;      // R8G8B8A8_UNORM
+        glm::vec2 texcoord;
+        u32       texture;
+        u32       uvs;      // R16G16_SFLOAT
+    };
+
     struct Quad {
         Quad(const glm::vec2& size, const glm::vec2& pos = {}, const glm::vec4& col = { 1, 1, 1, 1 }, float texture = 0.f, const glm::vec2& uvs = { 1, 1 });
         Quad(const glm::vec3& size = {}, const glm::vec3& pos = {}, const glm::vec4& col = { 1, 1, 1, 1 }, float texture = 0.f, const glm::vec2& uvs = { 1, 1 });
@@ -38,6 +51,38 @@ namespace aby {
         glm::vec3 size;
     };
 
+    /**
+    * @brief Per instance record of the instanced quad, glyph and cube path (56 bytes).
+    *        The vertex shader (Instance.glsl) expands it into the corners of one quad or six cube faces.
+    *        The texture coordinates stay 32 bit floats, half floats can not address every texel of a large atlas.
+    */
+    struct QuadInstance {
+        static constexpr u32 TEXTURE_SDF = 1u << 31; // Flag in texture: the texture is a signed distance field
+
+        QuadInstance(const glm::vec3& pos, const glm::vec3& size, const glm::vec4& col, const glm::vec4& uv_rect = { 0, 0, 1, 1 }, float texture = 0.f, const glm::vec2& uvs = { 1, 1 }, float rotation = 0.f);
+
+        glm::vec3 pos;      // center
+        glm::vec3 size;
+        u32       col;      // R8G8B8A8_UNORM
+        glm::vec4 uv_rect;  // xy = min texcoord, zw = max texcoord
+        u32       uvs;      // R16G16_SFLOAT
+        float     rotation; // around z, in radians
+        u32       texture;  // Bindless index, or'ed with TEXTURE_SDF
+    };
+
+    /**
+    * @brief Color to R8G8B8A8_UNORM, clamped and rounded to nearest.
+    */
+    u32 pack_unorm8(const glm::vec4& v);
+    /**
+    * @brief Float to IEEE half, rounded to nearest even like the F16C conversion.
+    */
+    u16 pack_half(float v);
+    /**
+    * @brief vec2 to R16G16_SFLOAT.
+    */
+    u32 pack_half2(const glm::vec2& v);
+
     struct Text {
         Text(const std::string& text, const glm::vec2& pos, const glm::vec4& color = { 1, 1, 1, 1 }, float scale = 1.f, u32 font = 0);
 
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Core/Common.h"
+#include <functional>
+#include <ostream>
+#include <system_error>
+
+namespace aby::util {
+
+    /**
+    * @brief Let write fill a file next to path and rename it over path. Readers (also other threads writing
+    *        the same path) see the old file or the complete new one, never half of it.
+    *        The temporary file is removed if anything fails.
+    * @return Empty on success.
+    */
+    std::error_code write_atomic(const fs::path& path, const std::function<void(std::ostream&)>& write);
+
+}
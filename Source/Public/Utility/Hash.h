@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Core/Common.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace aby::util {
+
+    /**
+    * @brief Incremental 64 bit FNV-1a. Unlike std::hash the result is the same on every run and platform,
+    *        so it can name files on disk.
+    */
+    class Hasher {
+    public:
+        Hasher& update(std::span<const std::byte> bytes);
+        /**
+        * @brief Length prefixed, ("ab", "c") and ("a", "bc") hash differently.
+        */
+        Hasher& update_string(std::string_view text);
+
+        template <typename T> requires std::is_trivially_copyable_v<T>
+        Hasher& update_value(const T& value) {
+            return update(std::as_bytes(std::span(&value, 1)));
+        }
+
+        u64         digest() const;
+        /**
+        * @brief digest() as 16 lowercase hex digits.
+        */
+        std::string hex() const;
+    private:
+        u64 m_State = 0xCBF29CE484222325ull;
+    };
+
+}
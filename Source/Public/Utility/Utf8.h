@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Core/Common.h"
+#include <string>
+#include <string_view>
+
+namespace aby::util {
+
+    inline constexpr char32_t REPLACEMENT_CHARACTER = U'\uFFFD';
+
+    /**
+    * @brief Decode the code point starting at text[pos] and advance pos past it.
+    *        Invalid, overlong, truncated and surrogate sequences decode to REPLACEMENT_CHARACTER and skip one byte.
+    */
+    char32_t decode_utf8(std::string_view text, std::size_t& pos);
+
+    /**
+    * @brief Number of leading ASCII bytes, 16 at a time with SSE2 (8 elsewhere).
+    */
+    std::size_t ascii_run(std::string_view text);
+
+    /**
+    * @brief Number of code points, see decode_utf8 for invalid sequences.
+    */
+    std::size_t utf8_length(std::string_view text);
+
+    std::u32string decode_utf8(std::string_view text);
+
+    /**
+    * @brief Call f(char32_t) for every code point, ASCII runs are passed through without decoding.
+    */
+    template <typename F>
+    void for_each_codepoint(std::string_view text, F&& f) {
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            const std::size_t ascii_end = pos + ascii_run(text.substr(pos));
+            for (; pos < ascii_end; pos++) {
+                f(static_cast<char32_t>(text[pos]));
+            }
+            if (pos < text.size()) {
+                f(decode_utf8(text, pos));
+            }
+        }
+    }
+
+}
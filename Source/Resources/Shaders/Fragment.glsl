@@ -2,9 +2,16 @@
 #extension GL_EXT_nonuniform_qualifier : enable
 #extension GL_EXT_debug_printf : enable
 
+// Distance field text, requested by the 2D render module. The default is plain coverage.
+#pragma permutation SDF
+
+layout(constant_id = MAX_TEXTURE_SLOTS_ID) const uint MAX_TEXTURE_SLOTS = 1;
+layout(constant_id = DEBUG_ID) const bool DEBUG = false;
+
 layout(location = 0) in vec4 v_color;
 layout(location = 1) in vec3 v_texinfo;
 layout(location = 2) in vec2 v_uvs;
+layout(location = 3) flat in uint v_sdf; // Non zero: the red channel is a signed distance, the outline is at 0.5
 
 layout(set = 1, binding = BINDLESS_TEXTURE_BINDING) uniform sampler2D textures[];
 
@@ -12,11 +19,26 @@ layout(location = 0) out vec4 out_color;
 
 void main() {
     int tex_idx  = int(nonuniformEXT(v_texinfo.z));
-    vec4 sampled = texture(textures[tex_idx], v_texinfo.xy * v_uvs); 
-    
+    // Debug builds draw an index past the bindless array in magenta instead of sampling out of bounds.
+    bool out_of_range = DEBUG && uint(tex_idx) >= MAX_TEXTURE_SLOTS;
+    if (out_of_range) {
+        tex_idx = 0;
+    }
+    vec4 sampled = texture(textures[nonuniformEXT(tex_idx)], v_texinfo.xy * v_uvs);
+
     // Use the red channel of the texture as the alpha value
     float alpha = sampled.r;
-    
+#ifdef SDF
+    // Half a screen pixel on either side of the outline at any scale, the derivative is taken before branching.
+    float width = max(0.5 * fwidth(sampled.r), 1e-4);
+    if (v_sdf != 0u) {
+        alpha = smoothstep(0.5 - width, 0.5 + width, sampled.r);
+    }
+#endif
+
     // Preserve the color but apply the sampled alpha
     out_color = vec4(v_color.rgb, v_color.a * alpha);
-}
\ No newline at end of file
+    if (out_of_range) {
+        out_color = vec4(1.0, 0.0, 1.0, 1.0);
+    }
+}
@@ -0,0 +1,71 @@
+#version 450 core
+#extension GL_EXT_debug_printf : enable
+
+// One record per quad, glyph or cube, the corners are expanded from gl_VertexIndex.
+// Every face takes 6 vertices: quads are drawn with 6 vertices per instance, cubes with 36.
+layout(location = 0) in vec3  i_position; // Center
+layout(location = 1) in vec3  i_size;
+layout(location = 2) in vec4  i_color_unorm8;
+layout(location = 3) in vec4  i_uv_rect;  // xy = min texcoord, zw = max texcoord
+layout(location = 4) in vec2  i_uvs_half;
+layout(location = 5) in float i_rotation; // Around z, in radians
+layout(location = 6) in uint  i_texture;  // Bindless index, bit 31 marks a signed distance field
+
+layout(push_constant) uniform Camera {
+    mat4 view_proj;
+};
+
+layout(location = 0) out vec4 v_color;
+layout(location = 1) out vec3 v_texinfo;
+layout(location = 2) out vec2 v_uvs;
+layout(location = 3) flat out uint v_sdf;
+
+const uint TEXTURE_SDF = 0x80000000u;
+
+const float PI      = 3.14159265359;
+const float HALF_PI = 1.57079632679;
+
+// Same winding as the quad index buffer (0, 1, 2, 2, 3, 0).
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0)
+);
+
+mat3 rotate_x(float a) {
+    float c = cos(a), s = sin(a);
+    return mat3(1.0, 0.0, 0.0,  0.0, c, s,  0.0, -s, c);
+}
+
+mat3 rotate_y(float a) {
+    float c = cos(a), s = sin(a);
+    return mat3(c, 0.0, -s,  0.0, 1.0, 0.0,  s, 0.0, c);
+}
+
+mat3 rotate_z(float a) {
+    float c = cos(a), s = sin(a);
+    return mat3(c, s, 0.0,  -s, c, 0.0,  0.0, 0.0, 1.0);
+}
+
+void main() {
+    int  face      = gl_VertexIndex / 6;
+    vec2 corner    = CORNERS[gl_VertexIndex % 6];
+    vec3 half_size = i_size * 0.5;
+
+    // Quad in the xy plane, the faces of a cube are rotated onto and pushed out to its sides.
+    vec3 local = vec3((corner - 0.5) * i_size.xy, 0.0);
+    switch (face) {
+        case 0: local = local                      + vec3(0.0, 0.0,  half_size.z); break; // Front  (+Z)
+        case 1: local = rotate_y(PI) * local       + vec3(0.0, 0.0, -half_size.z); break; // Back   (-Z)
+        case 2: local = rotate_y(-HALF_PI) * local + vec3(-half_size.x, 0.0, 0.0); break; // Left   (-X)
+        case 3: local = rotate_y(HALF_PI) * local  + vec3( half_size.x, 0.0, 0.0); break; // Right  (+X)
+        case 4: local = rotate_x(-HALF_PI) * local + vec3(0.0,  half_size.y, 0.0); break; // Top    (+Y)
+        case 5: local = rotate_x(HALF_PI) * local  + vec3(0.0, -half_size.y, 0.0); break; // Bottom (-Y)
+    }
+    vec3 position = i_position + rotate_z(i_rotation) * local;
+
+    gl_Position = view_proj * vec4(position, 1.0);
+    v_color     = i_color_unorm8;
+    v_texinfo   = vec3(mix(i_uv_rect.xy, i_uv_rect.zw, corner), float(i_texture & ~TEXTURE_SDF));
+    v_uvs       = i_uvs_half;
+    v_sdf       = i_texture & TEXTURE_SDF;
+}
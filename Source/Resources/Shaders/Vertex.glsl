@@ -1,24 +1,28 @@
 #version 450 core
 #extension GL_EXT_debug_printf : enable
 
+// PackedVertex, the _unorm8 and _half suffixes select the packed formats (see ShaderCompiler::reflect).
 layout(location = 0) in vec3  a_position;
-layout(location = 1) in vec4  a_color;
-layout(location = 2) in vec3  a_texinfo;
-layout(location = 3) in vec2  a_uvs;
+layout(location = 1) in vec4  a_color_unorm8;
+layout(location = 2) in vec2  a_texcoord;
+layout(location = 3) in uint  a_texture;
+layout(location = 4) in vec2  a_uvs_half;
 
 
-layout(std140, binding = 0) uniform Camera {
+layout(push_constant) uniform Camera {
     mat4 view_proj;
 };
 
 layout(location = 0) out vec4 v_color;
 layout(location = 1) out vec3 v_texinfo;
 layout(location = 2) out vec2 v_uvs;
+layout(location = 3) flat out uint v_sdf;
 
 void main() {
     gl_Position = view_proj * vec4(a_position, 1.0);
-    v_color     = a_color;
-    v_texinfo   = a_texinfo;
-    v_uvs       = a_uvs;
+    v_color     = a_color_unorm8;
+    v_texinfo   = vec3(a_texcoord, float(a_texture));
+    v_uvs       = a_uvs_half;
+    v_sdf       = 0u;
     // debugPrintfEXT("VERT: [v_color] = (%f, %f, %f, %f)\n", EXPAND_VEC4(v_color));
 }
\ No newline at end of file
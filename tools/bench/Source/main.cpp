@@ -0,0 +1,135 @@
+/**
+* @brief Time the batch kernels against the per item paths they replace.
+* @param argc 1 or 2
+* @param argv bench [count]
+*/
+
+#include "Core/Simd.h"
+#include "Rendering/BatchKernels.h"
+#include "Rendering/Vertex.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace aby {
+
+    static constexpr int ITERATIONS = 50;
+
+    // Quad corners and texcoords of the per vertex path that predates instancing.
+    static const glm::vec4 VERTEX_POSITIONS[4] = {
+        { -0.5f, -0.5f, 0.0f, 1.0f },
+        {  0.5f, -0.5f, 0.0f, 1.0f },
+        {  0.5f,  0.5f, 0.0f, 1.0f },
+        { -0.5f,  0.5f, 0.0f, 1.0f },
+    };
+    static const glm::vec2 COORDS[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+    template <typename F>
+    static double time_ms(F&& f) {
+        f(); // Warm up, faults the output pages in
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            f();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+    }
+
+    static void report(const std::string& name, double ms, double baseline) {
+        std::cout << std::format("  {:<24} {:>9.3f} ms {:>7.2f}x\n", name, ms, baseline / ms);
+    }
+
+    static void bench_quads(std::size_t count) {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> dist(0.f, 1000.f);
+
+        std::vector<Quad> quads;
+        quads.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            quads.emplace_back(glm::vec3(dist(rng), dist(rng), 0.f), glm::vec3(dist(rng), dist(rng), 0.f), glm::vec4(1.f), 0.f);
+        }
+        // Uninitialized, like mapped vertex memory
+        auto vertices  = std::make_unique_for_overwrite<std::byte[]>(count * 4 * sizeof(Vertex));
+        auto instances = std::make_unique_for_overwrite<std::byte[]>(count * sizeof(QuadInstance));
+        auto* v_out = reinterpret_cast<Vertex*>(vertices.get());
+        auto* i_out = reinterpret_cast<QuadInstance*>(instances.get());
+
+        std::cout << std::format("Quads ({}):\n", count);
+        double vertex = time_ms([&]() {
+            const glm::mat4 unit(1.f);
+            for (std::size_t i = 0; i < count; i++) {
+                const Quad& quad      = quads[i];
+                glm::mat4   transform = glm::translate(unit, quad.pos) * glm::scale(unit, quad.size);
+                for (std::size_t c = 0; c < 4; c++) {
+                    glm::vec3 pos(transform * VERTEX_POSITIONS[c]);
+                    std::construct_at(&v_out[i * 4 + c], pos, quad.col, glm::vec3(COORDS[c], quad.texinfo.z), quad.uvs);
+                }
+            }
+        });
+        report("per vertex", vertex, vertex);
+
+        double instance = time_ms([&]() {
+            const glm::vec4 unit_rect(0.f, 0.f, 1.f, 1.f);
+            for (std::size_t i = 0; i < count; i++) {
+                const Quad& quad = quads[i];
+                std::construct_at(&i_out[i], quad.pos, glm::vec3(quad.size.x, quad.size.y, 0.f), quad.col, unit_rect, quad.texinfo.z, quad.uvs);
+            }
+        });
+        report("per instance", instance, vertex);
+
+        for (u32 level = 0; level <= static_cast<u32>(simd_support()); level++) {
+            set_simd_level(static_cast<ESimd>(level));
+            double ms = time_ms([&]() { kernels::write_quads(quads, i_out, true); });
+            report("kernel " + std::to_string(static_cast<ESimd>(level)), ms, vertex);
+        }
+    }
+
+    static void bench_glyphs(std::size_t count) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> dist(0.f, 32.f);
+
+        std::vector<GlyphQuad> glyphs;
+        glyphs.reserve(count);
+        float pen = 0.f;
+        for (std::size_t i = 0; i < count; i++) {
+            glyphs.push_back(GlyphQuad{
+                .pen     = pen,
+                .size    = { dist(rng), dist(rng) },
+                .bearing = { dist(rng) * 0.1f, dist(rng) },
+                .uv_rect = { 0.f, 0.f, 0.5f, 0.5f },
+            });
+            pen += 16.f;
+        }
+        GlyphRun run{ .origin = { 10.f, 20.f, 0.f }, .scale = 0.75f, .height = 32.f, .color = { 1, 1, 1, 1 }, .texture = 1.f, .flags = 0 };
+        auto  instances = std::make_unique_for_overwrite<std::byte[]>(count * sizeof(QuadInstance));
+        auto* out       = reinterpret_cast<QuadInstance*>(instances.get());
+
+        std::cout << std::format("Glyphs ({}):\n", count);
+        double scalar = 0.0;
+        for (u32 level = 0; level <= static_cast<u32>(simd_support()); level++) {
+            set_simd_level(static_cast<ESimd>(level));
+            double ms = time_ms([&]() { kernels::write_glyphs(glyphs, run, out); });
+            if (level == 0) {
+                scalar = ms;
+            }
+            report("kernel " + std::to_string(static_cast<ESimd>(level)), ms, scalar);
+        }
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    aby::bench_quads(count);
+    aby::bench_glyphs(count);
+    aby::set_simd_level(aby::simd_support());
+    return 0;
+}
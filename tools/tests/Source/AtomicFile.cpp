@@ -0,0 +1,59 @@
+#include "Framework.h"
+#include "Utility/AtomicFile.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+    std::string read_all(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    /**
+    * @brief Nothing but path in its directory, no temporary file was left behind.
+    */
+    bool only_file(const fs::path& path) {
+        std::size_t files = 0;
+        for (const auto& entry : fs::directory_iterator(path.parent_path())) {
+            if (entry.path() != path) {
+                return false;
+            }
+            files++;
+        }
+        return files == 1;
+    }
+
+}
+
+TEST(atomic_file_write) {
+    const fs::path dir = fs::temp_directory_path() / "aby_atomic_file_write";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path path = dir / "file.bin";
+
+    bool ok = !aby::util::write_atomic(path, [](std::ostream& out) { out << "first"; }) &&
+        read_all(path) == "first" &&
+        !aby::util::write_atomic(path, [](std::ostream& out) { out << "second"; }) &&
+        read_all(path) == "second" &&
+        only_file(path);
+    fs::remove_all(dir);
+    return ok;
+}
+
+TEST(atomic_file_failure) {
+    const fs::path dir = fs::temp_directory_path() / "aby_atomic_file_failure";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path path = dir / "file.bin";
+
+    // A failed write keeps the old contents and removes its temporary file.
+    bool ok = !aby::util::write_atomic(path, [](std::ostream& out) { out << "kept"; }) &&
+        aby::util::write_atomic(path, [](std::ostream& out) { out << "lost"; out.setstate(std::ios::badbit); }) &&
+        read_all(path) == "kept" &&
+        only_file(path) &&
+        aby::util::write_atomic(dir / "missing" / "file.bin", [](std::ostream&) {});
+    fs::remove_all(dir);
+    return ok;
+}
@@ -0,0 +1,147 @@
+#include "Framework.h"
+#include "Core/Simd.h"
+#include "Rendering/BatchKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // Odd counts cover the tails the wide kernels finish one record at a time.
+    constexpr std::size_t COUNTS[] = { 0, 1, 2, 3, 7, 8, 33 };
+
+    using Records = std::vector<std::byte>;
+
+    std::vector<aby::Quad> random_quads(std::mt19937& rng, std::size_t count) {
+        std::uniform_real_distribution<float> value(-1000.f, 1000.f);
+        std::uniform_real_distribution<float> color(-0.2f, 1.2f); // Out of range channels are clamped
+        std::vector<aby::Quad> quads;
+        for (std::size_t i = 0; i < count; i++) {
+            aby::Quad quad(
+                glm::vec3(value(rng), value(rng), value(rng)),
+                glm::vec3(value(rng), value(rng), value(rng)),
+                glm::vec4(color(rng), color(rng), color(rng), color(rng)),
+                std::abs(value(rng)),
+                glm::vec2(value(rng), value(rng))
+            );
+            quads.push_back(quad);
+        }
+        return quads;
+    }
+
+    std::vector<aby::GlyphQuad> random_glyphs(std::mt19937& rng, std::size_t count) {
+        std::uniform_real_distribution<float> value(-100.f, 100.f);
+        std::uniform_real_distribution<float> uv(0.f, 1.f);
+        std::vector<aby::GlyphQuad> glyphs;
+        for (std::size_t i = 0; i < count; i++) {
+            glyphs.push_back(aby::GlyphQuad{
+                .pen     = value(rng),
+                .size    = { value(rng), value(rng) },
+                .bearing = { value(rng), value(rng) },
+                .uv_rect = { uv(rng), uv(rng), uv(rng), uv(rng) },
+            });
+        }
+        return glyphs;
+    }
+
+    /**
+    * @brief Run write at every level the CPU supports, with room for one record more than count.
+    * @return The records written at each level, scalar first.
+    */
+    template <typename F>
+    std::vector<Records> run_levels(std::size_t count, F&& write) {
+        std::vector<Records> results;
+        for (aby::ESimd level : { aby::ESimd::SCALAR, aby::ESimd::SSE4_1, aby::ESimd::AVX2 }) {
+            aby::set_simd_level(level);
+            if (aby::simd_level() != level) {
+                continue;
+            }
+            Records records((count + 1) * sizeof(aby::QuadInstance), std::byte{ 0xCD });
+            write(reinterpret_cast<aby::QuadInstance*>(records.data()));
+            results.push_back(std::move(records));
+        }
+        aby::set_simd_level(aby::simd_support());
+        return results;
+    }
+
+    bool untouched_tail(const Records& records, std::size_t count) {
+        return std::all_of(records.begin() + count * sizeof(aby::QuadInstance), records.end(), [](std::byte b) {
+            return b == std::byte{ 0xCD };
+        });
+    }
+
+    bool close(float a, float b) {
+        return std::abs(a - b) <= 1e-4f * std::max(1.f, std::abs(a));
+    }
+
+    bool same_instance(const aby::QuadInstance& a, const aby::QuadInstance& b) {
+        for (int i = 0; i < 3; i++) {
+            if (!close(a.pos[i], b.pos[i]) || !close(a.size[i], b.size[i])) {
+                return false;
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            if (!close(a.uv_rect[i], b.uv_rect[i])) {
+                return false;
+            }
+        }
+        return a.col == b.col && a.uvs == b.uvs && close(a.rotation, b.rotation) && a.texture == b.texture;
+    }
+
+}
+
+TEST(batch_kernels_quads) {
+    std::mt19937 rng(11);
+    for (std::size_t count : COUNTS) {
+        auto quads = random_quads(rng, count);
+        for (bool flat : { false, true }) {
+            auto results = run_levels(count, [&](aby::QuadInstance* out) {
+                aby::kernels::write_quads(quads, out, flat);
+            });
+            // Quads are copied and packed, not computed, every level writes the same bytes.
+            for (const Records& records : results) {
+                if (records != results.front() || !untouched_tail(records, count)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+TEST(batch_kernels_glyphs) {
+    std::mt19937 rng(14);
+    const aby::GlyphRun run{
+        .origin  = { 12.f, 34.f, 0.5f },
+        .scale   = 1.5f,
+        .height  = 18.f,
+        .color   = { 0.1f, 0.2f, 0.3f, 0.4f },
+        .texture = 7.f,
+        .flags   = aby::QuadInstance::TEXTURE_SDF,
+    };
+    for (std::size_t count : COUNTS) {
+        auto glyphs  = random_glyphs(rng, count);
+        auto results = run_levels(count, [&](aby::QuadInstance* out) {
+            aby::kernels::write_glyphs(glyphs, run, out);
+        });
+        const Records& scalar = results.front();
+        for (const Records& records : results) {
+            // Fused multiply adds may round the positions differently, the packed words must match exactly.
+            for (std::size_t i = 0; i < count; i++) {
+                aby::QuadInstance a(glm::vec3(0.f), glm::vec3(0.f), glm::vec4(0.f));
+                aby::QuadInstance b(a);
+                std::memcpy(&a, scalar.data() + i * sizeof(aby::QuadInstance), sizeof(aby::QuadInstance));
+                std::memcpy(&b, records.data() + i * sizeof(aby::QuadInstance), sizeof(aby::QuadInstance));
+                if (!same_instance(a, b)) {
+                    return false;
+                }
+            }
+            if (!untouched_tail(records, count)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#include "Framework.h"
+#include "Rendering/GlyphTable.h"
+#include <stdexcept>
+
+namespace {
+
+    // The advance identifies the glyph a lookup returned.
+    aby::FontGlyph glyph(char32_t c) {
+        return aby::FontGlyph{
+            .size    = { 1.f, 1.f },
+            .bearing = { 0.f, 0.f },
+            .advance = static_cast<float>(c),
+            .uv_rect = { 0.f, 0.f, 1.f, 1.f },
+            .page    = aby::FontGlyph::EVICTED,
+        };
+    }
+
+    bool holds(const aby::GlyphTable& table, char32_t c) {
+        const aby::FontGlyph* found = table.find(c);
+        return found && found->advance == static_cast<float>(c);
+    }
+
+}
+
+TEST(glyph_table_insert) {
+    aby::GlyphTable table;
+    // Direct range (ASCII and Latin-1) and the hashed rest.
+    const char32_t codes[] = { U'A', U'\u00E9', U'\u00FF', U'\u0100', U'\u20AC', U'\U0001F600' };
+    for (char32_t c : codes) {
+        table.insert(c, glyph(c));
+    }
+    for (char32_t c : codes) {
+        if (!holds(table, c)) {
+            return false;
+        }
+    }
+    if (table.size() != std::size(codes) || table.find(U'B') || table.find(U'\u4E00')) {
+        return false;
+    }
+
+    // Replacing keeps the size.
+    aby::FontGlyph wider = glyph(U'\u20AC');
+    wider.size.x = 2.f;
+    table.insert(U'\u20AC', wider);
+    if (table.size() != std::size(codes) || table.at(U'\u20AC').size.x != 2.f) {
+        return false;
+    }
+
+    try {
+        (void)table.at(U'\u4E00');
+        return false;
+    }
+    catch (const std::out_of_range&) {
+        return true;
+    }
+}
+
+TEST(glyph_table_rehash) {
+    aby::GlyphTable table;
+    // Grows from 16 slots through several rehashes, a dense block (CJK) then sparse code points.
+    constexpr char32_t FIRST = 0x4E00;
+    constexpr aby::u32 COUNT = 3000;
+    for (char32_t c = FIRST; c < FIRST + COUNT; c++) {
+        table.insert(c, glyph(c));
+        // Everything inserted so far survives the rehash this insert may have done.
+        for (char32_t d = FIRST; d <= c; d++) {
+            if (!holds(table, d)) {
+                return false;
+            }
+        }
+    }
+    for (char32_t c = 0x10000; c < 0x10000 + 64 * 1024; c += 1024) {
+        table.insert(c, glyph(c));
+    }
+    for (char32_t c = FIRST; c < FIRST + COUNT; c++) {
+        if (!holds(table, c)) {
+            return false;
+        }
+    }
+    for (char32_t c = 0x10000; c < 0x10000 + 64 * 1024; c += 1024) {
+        if (!holds(table, c)) {
+            return false;
+        }
+    }
+    return table.size() == COUNT + 64 && !table.find(FIRST + COUNT) && !table.find(0x10001);
+}
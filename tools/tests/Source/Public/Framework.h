@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <string>
 #include <string_view>
 #include <iostream>
 
@@ -10,9 +11,6 @@ namespace test_name {
     class test_name;                                                             \
     class test_name : public aby::Test {                                         \
     public:                                                                      \
-        test_name() {                                                            \
-            aby::TestFramework::get().add(std::make_unique<test_name>());        \
-        }                                                                        \
         auto operator()() -> bool override {                                     \
             return eval();                                                       \
         }                                                                        \
@@ -20,7 +18,8 @@ namespace test_name {
             return #test_name;                                                   \
         }                                                                        \
     };                                                                           \
-    static test_name Instance;                                                   \
+    static const bool Registered = aby::TestFramework::get().add(                \
+        std::make_unique<test_name>());                                          \
 }                                                                                \
 auto test_name::eval() -> bool        
 
@@ -47,8 +46,9 @@ namespace aby {
             return fw;
         }
 
-        void add(std::unique_ptr<Test> test) {
+        bool add(std::unique_ptr<Test> test) {
             m_Tests.push_back(std::move(test));
+            return true;
         }
 
         bool run() {
@@ -57,7 +57,7 @@ namespace aby {
                 bool result = (*test)();
                 success &= result;
                 std::string result_str = result ? "Success" : "Failure";
-                std::cout << "[test] [" << test->name() << "] " << result << '\n';
+                std::cout << "[test] [" << test->name() << "] " << result_str << '\n';
             }
             return success;
         }
@@ -66,8 +66,3 @@ namespace aby {
     };
 
 }
-
-TEST(foo) {
-    return false;
-}
-
@@ -0,0 +1,102 @@
+#include "Framework.h"
+#include "Rendering/GlyphAtlas.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+    struct Rect {
+        glm::u32vec2 pos;
+        glm::u32vec2 size;
+    };
+
+    bool overlap(const Rect& a, const Rect& b) {
+        return a.pos.x < b.pos.x + b.size.x && b.pos.x < a.pos.x + a.size.x &&
+            a.pos.y < b.pos.y + b.size.y && b.pos.y < a.pos.y + a.size.y;
+    }
+
+    bool packs_at(aby::SkylinePacker& packer, const glm::u32vec2& size, const glm::u32vec2& expected) {
+        auto pos = packer.pack(size);
+        return pos && *pos == expected;
+    }
+
+}
+
+TEST(skyline_packer_fit) {
+    aby::SkylinePacker packer({ 100, 100 });
+    if (packer.pack({ 101, 1 }) || packer.pack({ 1, 101 })) {
+        return false;
+    }
+    // Lowest top first: the second wide rectangle does not fit next to the first and goes on top of it,
+    // the narrow one still fits on the floor.
+    if (!packs_at(packer, { 60, 10 }, { 0, 0 }) ||
+        !packs_at(packer, { 60, 10 }, { 0, 10 }) ||
+        !packs_at(packer, { 40, 5 }, { 60, 0 })) {
+        return false;
+    }
+    // The rest of the page, then nothing.
+    if (!packs_at(packer, { 100, 80 }, { 0, 20 }) || packer.pack({ 1, 1 }) || !packs_at(packer, { 0, 0 }, { 0, 0 })) {
+        return false;
+    }
+    packer.clear();
+    return packs_at(packer, { 100, 100 }, { 0, 0 }) && !packer.pack({ 1, 1 });
+}
+
+TEST(skyline_packer_tie) {
+    // Equal tops go to the narrower segment, the wider one stays free for wider rectangles.
+    aby::SkylinePacker packer({ 30, 100 });
+    return packs_at(packer, { 10, 5 }, { 0, 0 }) &&
+        packs_at(packer, { 4, 9 }, { 10, 0 }) &&
+        packs_at(packer, { 16, 5 }, { 14, 0 }) && // Skyline: 10 wide at 5, 4 at 9, 16 at 5
+        packs_at(packer, { 6, 3 }, { 0, 5 });
+}
+
+TEST(skyline_packer_merge) {
+    aby::SkylinePacker packer({ 40, 100 });
+    // The first two rectangles leave one segment 20 wide at height 5, not two of 10.
+    // With the 16 wide segment at the same height, a tie now goes to the latter.
+    if (!packs_at(packer, { 10, 5 }, { 0, 0 }) ||
+        !packs_at(packer, { 10, 5 }, { 10, 0 }) ||
+        !packs_at(packer, { 4, 9 }, { 20, 0 }) ||
+        !packs_at(packer, { 16, 5 }, { 24, 0 }) ||
+        !packs_at(packer, { 6, 3 }, { 24, 5 })) {
+        return false;
+    }
+    // A row filled piece by piece is flat again, a full width rectangle rests right on it.
+    packer.clear();
+    return packs_at(packer, { 10, 5 }, { 0, 0 }) &&
+        packs_at(packer, { 25, 5 }, { 10, 0 }) &&
+        packs_at(packer, { 5, 5 }, { 35, 0 }) &&
+        packs_at(packer, { 40, 95 }, { 0, 5 });
+}
+
+TEST(skyline_packer_random) {
+    std::mt19937 rng(15);
+    std::uniform_int_distribution<aby::u32> side(1, 40);
+    const glm::u32vec2 page(256, 256);
+    aby::SkylinePacker packer(page);
+    std::vector<Rect> placed;
+    for (int i = 0; i < 2000; i++) {
+        const glm::u32vec2 size(side(rng), side(rng));
+        auto pos = packer.pack(size);
+        if (!pos) {
+            continue;
+        }
+        const Rect rect{ *pos, size };
+        if (rect.pos.x + size.x > page.x || rect.pos.y + size.y > page.y) {
+            return false;
+        }
+        for (const Rect& other : placed) {
+            if (overlap(rect, other)) {
+                return false;
+            }
+        }
+        placed.push_back(rect);
+    }
+    // Bottom left packing of small rectangles fills most of the page.
+    std::size_t area = 0;
+    for (const Rect& rect : placed) {
+        area += rect.size.x * rect.size.y;
+    }
+    return area * 10 > static_cast<std::size_t>(page.x) * page.y * 7;
+}
@@ -0,0 +1,73 @@
+#include "Framework.h"
+#include "Rendering/UniformRing.h"
+#include <array>
+#include <set>
+
+namespace {
+
+    constexpr std::size_t ALIGNMENT = 256;
+    constexpr aby::u32    WRITES    = 4;
+    constexpr aby::u32    FRAMES    = 2;
+
+}
+
+TEST(uniform_ring_slices) {
+    const std::array<std::size_t, 2> sizes{ 64, 300 };
+    aby::UniformRing ring(sizes, ALIGNMENT, WRITES, FRAMES);
+    // 64 -> 256 and 300 -> 512 bytes per write
+    if (ring.slice() != (256 + 512) * WRITES || ring.size() != ring.slice() * FRAMES) {
+        return false;
+    }
+    for (aby::u32 frame = 0; frame < FRAMES; frame++) {
+        ring.begin_frame(frame);
+        std::size_t first = ring.push(64);
+        std::size_t next  = ring.push(300);
+        if (first != frame * ring.slice() || next != first + 256) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(uniform_ring_alignment) {
+    const std::array<std::size_t, 1> sizes{ 80 };
+    aby::UniformRing ring(sizes, ALIGNMENT, WRITES, FRAMES);
+    ring.begin_frame(1);
+    for (aby::u32 i = 0; i < WRITES; i++) {
+        std::size_t offset = ring.push(80);
+        if (offset % ALIGNMENT != 0 || offset + 80 > ring.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(uniform_ring_shared_frame) {
+    // The 2D and 3D render modules share a ShaderModule, each write of a frame keeps its own block.
+    const std::array<std::size_t, 1> sizes{ 64 };
+    aby::UniformRing ring(sizes, ALIGNMENT, WRITES, FRAMES);
+    ring.begin_frame(0);
+    std::set<std::size_t> offsets;
+    for (aby::u32 i = 0; i < WRITES; i++) {
+        offsets.insert(ring.push(64));
+    }
+    return offsets.size() == WRITES;
+}
+
+TEST(uniform_ring_wrap) {
+    const std::array<std::size_t, 1> sizes{ 64 };
+    aby::UniformRing ring(sizes, ALIGNMENT, WRITES, FRAMES);
+    ring.begin_frame(1);
+    for (aby::u32 i = 0; i < WRITES; i++) {
+        if (!ring.fits(64)) {
+            return false;
+        }
+        ring.push(64);
+    }
+    // Past the writes of a frame the slice wraps, it never spills into the next frame's slice.
+    if (ring.fits(64) || ring.push(64) != ring.slice()) {
+        return false;
+    }
+    ring.begin_frame(0);
+    return ring.fits(64) && ring.push(64) == 0;
+}
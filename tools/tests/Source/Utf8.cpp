@@ -0,0 +1,86 @@
+#include "Framework.h"
+#include "Utility/Utf8.h"
+#include <string>
+#include <string_view>
+
+namespace {
+
+    /**
+    * @brief Decode one sequence at a time, every call must make progress and stay inside text.
+    */
+    std::u32string decode_each(std::string_view text) {
+        std::u32string out;
+        std::size_t    pos = 0;
+        while (pos < text.size()) {
+            const std::size_t before = pos;
+            out.push_back(aby::util::decode_utf8(text, pos));
+            if (pos <= before || pos > text.size()) {
+                return U"<stuck>";
+            }
+        }
+        return out;
+    }
+
+    /**
+    * @brief Both decoders and utf8_length agree on text and decode it to expected.
+    */
+    bool decodes_to(std::string_view text, std::u32string_view expected) {
+        return decode_each(text) == expected &&
+            aby::util::decode_utf8(text) == expected &&
+            aby::util::utf8_length(text) == expected.size();
+    }
+
+}
+
+TEST(utf8_valid) {
+    return decodes_to("abc", U"abc") &&
+        decodes_to("\xC3\xA9", U"\u00E9") &&             // Two bytes
+        decodes_to("\xE2\x82\xAC", U"\u20AC") &&         // Three bytes
+        decodes_to("\xF0\x9F\x98\x80", U"\U0001F600") && // Four bytes
+        decodes_to("\xF4\x8F\xBF\xBF", U"\U0010FFFF") && // Highest code point
+        decodes_to("a\xC3\xA9z\xE2\x82\xAC", U"a\u00E9z\u20AC");
+}
+
+TEST(utf8_invalid) {
+    // A byte that can not start a sequence is replaced on its own, decoding resumes at the next byte.
+    return decodes_to("\x80", U"\uFFFD") &&
+        decodes_to("\xBF" "a", U"\uFFFDa") &&
+        decodes_to("\xFF\xFE", U"\uFFFD\uFFFD") &&
+        decodes_to("\xF5\x80\x80\x80", U"\uFFFD\uFFFD\uFFFD\uFFFD") && // Lead byte above U+10FFFF
+        decodes_to("\xF4\x90\x80\x80", U"\uFFFD\uFFFD\uFFFD\uFFFD") && // U+110000
+        decodes_to("\xED\xA0\x80", U"\uFFFD\uFFFD\uFFFD") &&           // Surrogate U+D800
+        decodes_to("\xC3" "a", U"\uFFFDa");                            // Continuation missing
+}
+
+TEST(utf8_overlong) {
+    // Longer encodings of '/' and U+007F than needed, next to the shortest multi byte forms.
+    return decodes_to("\xC0\xAF", U"\uFFFD\uFFFD") &&
+        decodes_to("\xC1\xBF", U"\uFFFD\uFFFD") &&
+        decodes_to("\xE0\x80\xAF", U"\uFFFD\uFFFD\uFFFD") &&
+        decodes_to("\xF0\x80\x80\xAF", U"\uFFFD\uFFFD\uFFFD\uFFFD") &&
+        decodes_to("\xE0\xA0\x80", U"\u0800") &&       // Shortest three byte form
+        decodes_to("\xF0\x90\x80\x80", U"\U00010000"); // Shortest four byte form
+}
+
+TEST(utf8_truncated) {
+    // The view ends inside the sequence, the bytes after it must not be read.
+    const std::string euro  = "\xE2\x82\xAC";
+    const std::string emoji = "\xF0\x9F\x98\x80";
+    return decodes_to(std::string_view(euro).substr(0, 1), U"\uFFFD") &&
+        decodes_to(std::string_view(euro).substr(0, 2), U"\uFFFD\uFFFD") &&
+        decodes_to(std::string_view(emoji).substr(0, 3), U"\uFFFD\uFFFD\uFFFD") &&
+        decodes_to("\xF0\x9F\x98" "a", U"\uFFFD\uFFFD\uFFFDa");
+}
+
+TEST(utf8_ascii_run) {
+    // A non ASCII byte at every offset of the 16 and 8 byte blocks and the byte wise tail.
+    const std::string ascii(40, 'x');
+    for (std::size_t i = 0; i < ascii.size(); i++) {
+        std::string text = ascii;
+        text[i] = '\xC3';
+        if (aby::util::ascii_run(text) != i) {
+            return false;
+        }
+    }
+    return aby::util::ascii_run(ascii) == ascii.size() && aby::util::ascii_run({}) == 0;
+}